@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "Coordinator.h"
+
+using std::cout;
+
+// Runs every job of a manifest, see BatchRunner::ParseManifest, and prints one result per job as it finishes.
+// With a number of processes the jobs are spread over that many worker processes with the given threads each,
+// see Coordinator
+int main(const int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <manifest> [json|csv] [threads] [processes] [memory limit per process in MiB]" << std::endl;
+        return 1;
+    }
+
+    const string format = argc >= 3 ? argv[2] : "json";
+    if (format != "json" && format != "csv") {
+        std::cerr << "Unknown format: " << format << std::endl;
+        return 1;
+    }
+    unsigned threads = 0;
+    if (argc >= 4) {
+        threads = static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10));
+    }
+    unsigned processes = 0;
+    if (argc >= 5) {
+        processes = static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10));
+    }
+    uint64_t memoryLimit = 0;
+    if (argc >= 6) {
+        memoryLimit = std::strtoull(argv[5], nullptr, 10) << 20;
+    }
+
+    const std::filesystem::path manifestPath = argv[1];
+    std::ifstream manifest(manifestPath);
+    if (!manifest) {
+        std::cerr << "Error opening file: " << manifestPath.string() << std::endl;
+        return 1;
+    }
+    vector<BatchJob> jobs;
+    size_t errorLine = 0;
+    if (!BatchRunner::ParseManifest(manifest, manifestPath.parent_path(), jobs, errorLine)) {
+        std::cerr << "Line " << errorLine << ": Invalid job" << std::endl;
+        return 1;
+    }
+
+    if (format == "csv") {
+        cout << BatchRunner::GetCsvHeader() << "\n";
+    }
+    const auto report = [&](const BatchResult& result) {
+        const BatchJob& job = jobs[result.index];
+        cout << (format == "csv" ? BatchRunner::ToCsv(job, result) : BatchRunner::ToJson(job, result)) << "\n";
+    };
+    if (processes > 0) {
+        Coordinator(processes, threads, memoryLimit).Run(jobs, report);
+    }
+    else {
+        BatchRunner::Run(jobs, threads, report);
+    }
+    cout.flush();
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "../parser/Parser.h"
+#include "../simulator/CommandLine.h"
+#include "WorkStealingQueue.h"
+
+static std::string_view GetStatus(const BatchResult& result)
+{
+    if (result.jobError.empty() || result.run.reason == StopReason::WORKER_CRASHED) {
+        return toString(result.run.reason);
+    }
+    return "Not run";
+}
+
+static string GetError(const BatchResult& result)
+{
+    return result.jobError.empty() ? string(toString(result.run.error)) : result.jobError;
+}
+
+static string EscapeJson(const std::string_view text)
+{
+    string escaped;
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static string EscapeCsv(const std::string_view text)
+{
+    string escaped = "\"";
+    for (const char c : text) {
+        escaped += c;
+        if (c == '"') {
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+bool BatchRunner::ParseManifest(std::istream& manifest, const std::filesystem::path& directory,
+                                vector<BatchJob>& jobs, size_t& errorLine)
+{
+    string line;
+    for (size_t lineNumber = 1; std::getline(manifest, line); lineNumber++) {
+        std::istringstream fields(line);
+        string path;
+        if (!(fields >> path) || path.starts_with('#')) {
+            continue;
+        }
+
+        BatchJob job{(directory / path).string(), DEFAULT_JOB_INSTRUCTIONS, DEFAULT_JOB_MEMORY, DEFAULT_JOB_TIME};
+        string maxInstructions;
+        string memorySize;
+        string maxTime;
+        string rest;
+        if ((fields >> maxInstructions && !CommandLine::ParseNumber(maxInstructions, job.maxInstructions)) ||
+            (fields >> memorySize && !CommandLine::ParseNumber(memorySize, job.memorySize)) ||
+            (fields >> maxTime && !CommandLine::ParseNumber(maxTime, job.maxTime)) ||
+            job.memorySize > ADDRESS_SPACE_SIZE || fields >> rest) {
+            errorLine = lineNumber;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+static bool IsElfFile(const string& path)
+{
+    char magic[4] = {};
+    std::ifstream(path, std::ios::binary).read(magic, sizeof(magic));
+    return std::string_view(magic, sizeof(magic)) == "\x7F" "ELF";
+}
+
+bool BatchRunner::LoadProgram(const string& path, Simulator& simulator, string& error)
+{
+    if (IsElfFile(path)) {
+        const ElfError elfError = simulator.LoadElf(path);
+        if (elfError != ElfError::NONE) {
+            error = string(toString(elfError)) + ": " + path;
+            return false;
+        }
+        return true;
+    }
+
+    vector<uint32_t> instructions;
+    if (path.ends_with(".bin")) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            error = "Error opening file: " + path;
+            return false;
+        }
+        const auto size = static_cast<size_t>(file.tellg());
+        if (size % sizeof(uint32_t) != 0) {
+            error = "Not a whole number of instructions: " + path;
+            return false;
+        }
+        instructions.resize(size / sizeof(uint32_t));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(instructions.data()), static_cast<std::streamsize>(size))) {
+            error = "Error reading file: " + path;
+            return false;
+        }
+        simulator.SetInstructions(instructions);
+        return true;
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        error = "Error opening file: " + path;
+        return false;
+    }
+    vector<string> lines;
+    string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    const ParsingResult result = Parser::Parse(lines);
+    if (!result.success) {
+        error = "Line " + std::to_string(result.errorLine) + ": " + string(toString(result.errorType));
+        return false;
+    }
+    simulator.SetInstructions(result.instructions);
+    return true;
+}
+
+BatchResult BatchRunner::RunJob(const BatchJob& job, const size_t index)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BatchResult result{index, "", {0, ExecutionError::NONE, 0, 0, StopReason::HALTED}, {}, 0};
+    Simulator simulator(job.memorySize, ExecutionEngine::JIT);
+    if (LoadProgram(job.path, simulator, result.jobError)) {
+        // a job looping forever gives up its worker once its time is up
+        simulator.SetLimits({0, std::min(job.maxTime, UINT64_MAX / 1'000'000) * 1'000'000, 0});
+        result.run = simulator.Run(job.maxInstructions);
+        const CpuStatus status = simulator.GetCpuStatus();
+        std::ranges::copy(status.registers, result.hart.registers.begin());
+        result.hart.registers[PC] = status.pc;
+        result.hart.retired = status.retired;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    result.wallTime = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return result;
+}
+
+void BatchRunner::Run(const vector<BatchJob>& jobs, unsigned threads,
+                      const std::function<void(const BatchResult&)>& report)
+{
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, jobs.size()));
+
+    WorkStealingQueue queue(jobs.size(), threads);
+    std::mutex reportMutex;
+    vector<std::thread> workers;
+    for (unsigned worker = 0; worker < threads; worker++) {
+        workers.emplace_back([&, worker] {
+            size_t index;
+            while (queue.Take(worker, index)) {
+                const BatchResult result = RunJob(jobs[index], index);
+                std::lock_guard lock(reportMutex);
+                report(result);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+string BatchRunner::ToJson(const BatchJob& job, const BatchResult& result)
+{
+    std::ostringstream json;
+    json << "{\"index\":" << result.index << ",\"path\":\"" << EscapeJson(job.path) << "\",\"status\":\""
+         << GetStatus(result) << "\",\"error\":\"" << EscapeJson(GetError(result))
+         << "\",\"instructions\":" << result.run.instructions << ",\"retired\":" << result.hart.retired
+         << ",\"pc\":" << result.hart.registers[PC] << ",\"registers\":[";
+    for (uint8_t reg = 0; reg < PC; reg++) {
+        json << (reg == 0 ? "" : ",") << result.hart.registers[reg];
+    }
+    json << "],\"wall_time_ns\":" << result.wallTime << "}";
+    return json.str();
+}
+
+string BatchRunner::GetCsvHeader()
+{
+    string header = "index,path,status,error,instructions,retired,pc";
+    for (int reg = 0; reg < PC; reg++) {
+        header += ",x" + std::to_string(reg);
+    }
+    return header + ",wall_time_ns";
+}
+
+string BatchRunner::ToCsv(const BatchJob& job, const BatchResult& result)
+{
+    std::ostringstream csv;
+    csv << result.index << "," << EscapeCsv(job.path) << "," << GetStatus(result) << ","
+        << EscapeCsv(GetError(result)) << "," << result.run.instructions << "," << result.hart.retired << ","
+        << result.hart.registers[PC];
+    for (uint8_t reg = 0; reg < PC; reg++) {
+        csv << "," << result.hart.registers[reg];
+    }
+    csv << "," << result.wallTime;
+    return csv.str();
+}
@@ -0,0 +1,63 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "../simulator/Simulator.h"
+
+using std::string;
+using std::vector;
+
+constexpr uint64_t DEFAULT_JOB_INSTRUCTIONS = 1'000'000'000;
+constexpr uint64_t DEFAULT_JOB_MEMORY = 1 << 20;
+constexpr uint64_t DEFAULT_JOB_TIME = 10'000;
+
+struct BatchJob
+{
+    // an RV32 ELF executable, little-endian instruction words for files ending in .bin or else assembly
+    string path;
+    uint64_t maxInstructions;
+    uint64_t memorySize;
+    // milliseconds the job may spend executing, 0 for no limit
+    uint64_t maxTime;
+};
+
+struct BatchResult
+{
+    size_t index;
+    // why the job was not run, such as a program that does not assemble, empty if it was
+    string jobError;
+    RunResult run;
+    HartState hart;
+    // nanoseconds spent loading and running the job
+    uint64_t wallTime;
+};
+
+// Runs many independent programs, each in a simulator of its own, on all cores
+class BatchRunner
+{
+public:
+    // One job per line: path [max instructions] [memory size] [max time in ms]. Empty lines and lines starting
+    // with # are skipped, relative paths are relative to directory. False with the 1-based line if a line is invalid
+    static bool ParseManifest(std::istream& manifest, const std::filesystem::path& directory, vector<BatchJob>& jobs,
+                              size_t& errorLine);
+    // loads and runs the job on the calling thread
+    static BatchResult RunJob(const BatchJob& job, size_t index);
+    // Runs the jobs on up to threads workers, 0 for one per core. Report is called with every result as soon as
+    // it is there, in no particular order, but never by two workers at once
+    static void Run(const vector<BatchJob>& jobs, unsigned threads,
+                    const std::function<void(const BatchResult&)>& report);
+    // one object per line
+    static string ToJson(const BatchJob& job, const BatchResult& result);
+    static string GetCsvHeader();
+    static string ToCsv(const BatchJob& job, const BatchResult& result);
+
+private:
+    static bool LoadProgram(const string& path, Simulator& simulator, string& error);
+};
+
+#endif // BATCHRUNNER_H
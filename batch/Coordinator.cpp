@@ -0,0 +1,263 @@
+#include "Coordinator.h"
+
+#include <algorithm>
+
+#ifdef COORDINATOR_PROCESSES
+#include <cerrno>
+#include <csignal>
+#include <deque>
+#include <numeric>
+#include <poll.h>
+#include <ranges>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../simulator/Pipe.h"
+
+// jobs a worker gets at a time for each of its threads
+static constexpr size_t CHUNK_JOBS_PER_THREAD = 4;
+
+// fixed part of a result sent by a worker, followed by the error
+struct ResultMessage
+{
+    uint64_t index;
+    RunResult run;
+    HartState hart;
+    uint64_t wallTime;
+    uint64_t errorLength;
+};
+
+struct Worker
+{
+    pid_t pid;
+    // coordinator ends of the pipes
+    int commands;
+    int results;
+    // jobs the worker has been given and not reported yet
+    vector<size_t> running;
+    // start of a result that has not been received completely
+    vector<uint8_t> received;
+};
+
+// Runs chunks of job indices, each a count followed by the indices, until the coordinator closes the pipe
+static void RunWorker(const vector<BatchJob>& jobs, const int commands, const int results, const unsigned threads,
+                      const uint64_t memoryLimit)
+{
+    if (memoryLimit != 0) {
+        const rlimit limit{memoryLimit, memoryLimit};
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    uint64_t count;
+    while (Pipe::ReadAll(commands, &count, sizeof(count))) {
+        vector<uint64_t> indices(count);
+        if (!Pipe::ReadAll(commands, indices.data(), count * sizeof(uint64_t))) {
+            return;
+        }
+        vector<BatchJob> chunk;
+        for (const uint64_t index : indices) {
+            chunk.push_back(jobs[index]);
+        }
+
+        bool connected = true;
+        BatchRunner::Run(chunk, threads, [&](const BatchResult& result) {
+            const ResultMessage message{indices[result.index], result.run, result.hart, result.wallTime,
+                                        result.jobError.size()};
+            connected = connected && Pipe::WriteAll(results, &message, sizeof(message)) &&
+                Pipe::WriteAll(results, result.jobError.data(), result.jobError.size());
+        });
+        if (!connected) {
+            return;
+        }
+    }
+}
+
+static bool StartWorker(const vector<BatchJob>& jobs, vector<Worker>& workers, const unsigned threads,
+                        const uint64_t memoryLimit)
+{
+    int commands[2];
+    int results[2];
+    if (pipe(commands) != 0) {
+        return false;
+    }
+    if (pipe(results) != 0) {
+        close(commands[0]);
+        close(commands[1]);
+        return false;
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(commands[1]);
+        close(results[0]);
+        // the pipes of the other workers must only be held by the coordinator, so it sees them close
+        for (const Worker& worker : workers) {
+            close(worker.commands);
+            close(worker.results);
+        }
+        RunWorker(jobs, commands[0], results[1], threads, memoryLimit);
+        // for the same reason as the children of ForkServer::Run
+        _exit(0);
+    }
+
+    close(commands[0]);
+    close(results[1]);
+    if (pid < 0) {
+        close(commands[1]);
+        close(results[0]);
+        return false;
+    }
+    workers.push_back({pid, commands[1], results[0], {}, {}});
+    return true;
+}
+
+static void StopWorker(const Worker& worker)
+{
+    close(worker.commands);
+    close(worker.results);
+    int status;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+    }
+}
+
+// Sends the next chunk, or a single job that has been in a crashing worker before
+static void SendChunk(Worker& worker, std::deque<size_t>& pending, const vector<unsigned>& attempts,
+                      const size_t chunkSize)
+{
+    vector<uint64_t> chunk;
+    while (!pending.empty() && chunk.size() < chunkSize) {
+        const bool retry = attempts[pending.front()] > 0;
+        if (retry && !chunk.empty()) {
+            break;
+        }
+        chunk.push_back(pending.front());
+        worker.running.push_back(pending.front());
+        pending.pop_front();
+        if (retry) {
+            break;
+        }
+    }
+    // a failed write shows up as the worker closing its results
+    const uint64_t count = chunk.size();
+    if (Pipe::WriteAll(worker.commands, &count, sizeof(count))) {
+        Pipe::WriteAll(worker.commands, chunk.data(), chunk.size() * sizeof(uint64_t));
+    }
+}
+
+// Reports the complete results received so far, false once the worker has closed its end
+static bool ReceiveResults(Worker& worker, const std::function<void(const BatchResult&)>& report, size_t& remaining)
+{
+    uint8_t buffer[1 << 16];
+    const ssize_t count = read(worker.results, buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) {
+        return true;
+    }
+    if (count <= 0) {
+        return false;
+    }
+    worker.received.insert(worker.received.end(), buffer, buffer + count);
+
+    size_t offset = 0;
+    ResultMessage message;
+    while (worker.received.size() - offset >= sizeof(message)) {
+        std::copy_n(worker.received.data() + offset, sizeof(message), reinterpret_cast<uint8_t*>(&message));
+        if (worker.received.size() - offset - sizeof(message) < message.errorLength) {
+            break;
+        }
+        const auto* error = reinterpret_cast<const char*>(worker.received.data() + offset + sizeof(message));
+        report({message.index, string(error, message.errorLength), message.run, message.hart, message.wallTime});
+        std::erase(worker.running, message.index);
+        remaining--;
+        offset += sizeof(message) + message.errorLength;
+    }
+    worker.received.erase(worker.received.begin(), worker.received.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+#endif
+
+Coordinator::Coordinator(const unsigned workers, const unsigned threadsPerWorker, const uint64_t memoryLimit,
+                         const unsigned maxAttempts) :
+    m_workers(std::max(workers, 1u)), m_threadsPerWorker(std::max(threadsPerWorker, 1u)),
+    m_memoryLimit(memoryLimit), m_maxAttempts(std::max(maxAttempts, 1u))
+{
+}
+
+void Coordinator::Run(const vector<BatchJob>& jobs, const std::function<void(const BatchResult&)>& report) const
+{
+#ifdef COORDINATOR_PROCESSES
+    // writing to a worker that just died must not take the coordinator down with it
+    struct sigaction ignore{};
+    ignore.sa_handler = SIG_IGN;
+    struct sigaction previous{};
+    sigaction(SIGPIPE, &ignore, &previous);
+
+    std::deque<size_t> pending(jobs.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    vector<unsigned> attempts(jobs.size(), 0);
+    vector<Worker> workers;
+    const size_t chunkSize = m_threadsPerWorker * CHUNK_JOBS_PER_THREAD;
+    size_t remaining = jobs.size();
+
+    while (remaining > 0) {
+        while (workers.size() < m_workers && !pending.empty() &&
+               StartWorker(jobs, workers, m_threadsPerWorker, m_memoryLimit)) {
+            SendChunk(workers.back(), pending, attempts, chunkSize);
+        }
+        if (workers.empty()) {
+            // no worker could be started, the rest runs here
+            for (const size_t index : pending) {
+                report(BatchRunner::RunJob(jobs[index], index));
+            }
+            break;
+        }
+
+        vector<pollfd> descriptors;
+        for (const Worker& worker : workers) {
+            descriptors.push_back({worker.results, POLLIN, 0});
+        }
+        if (poll(descriptors.data(), descriptors.size(), -1) < 0) {
+            continue;
+        }
+
+        // backwards so stopped workers can be removed on the way
+        for (size_t i = workers.size(); i-- > 0;) {
+            Worker& worker = workers[i];
+            if (descriptors[i].revents == 0) {
+                continue;
+            }
+            if (!ReceiveResults(worker, report, remaining)) {
+                // crashed, or was killed for going over the memory limit
+                StopWorker(worker);
+                for (const size_t index : worker.running | std::views::reverse) {
+                    if (++attempts[index] >= m_maxAttempts) {
+                        const RunResult crashed{0, ExecutionError::NONE, 0, 0, StopReason::WORKER_CRASHED};
+                        report({index, "Worker crashed", crashed, {}, 0});
+                        remaining--;
+                    }
+                    else {
+                        pending.push_front(index);
+                    }
+                }
+                workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+            else if (worker.running.empty()) {
+                if (pending.empty()) {
+                    StopWorker(worker);
+                    workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+                else {
+                    SendChunk(worker, pending, attempts, chunkSize);
+                }
+            }
+        }
+    }
+
+    for (const Worker& worker : workers) {
+        StopWorker(worker);
+    }
+    sigaction(SIGPIPE, &previous, nullptr);
+#else
+    BatchRunner::Run(jobs, m_workers * m_threadsPerWorker, report);
+#endif
+}
@@ -0,0 +1,33 @@
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+#include <cstdint>
+#include <functional>
+
+#include "BatchRunner.h"
+
+#if !defined(_WIN32)
+#define COORDINATOR_PROCESSES
+#endif
+
+// Runs a batch across worker processes, for batches that need more memory than one process may use or that
+// should not take each other down. The workers are forked, so they already hold the jobs, and each runs the
+// chunks of jobs it is given with BatchRunner on several threads, streaming the results back over a pipe.
+// The unfinished jobs of a worker that died are run again by new workers, one at a time so a job that keeps
+// crashing can be told apart from the rest. Without fork, everything runs in this process
+class Coordinator
+{
+public:
+    // memoryLimit is the address space each worker may use in bytes, 0 for no limit
+    Coordinator(unsigned workers, unsigned threadsPerWorker, uint64_t memoryLimit = 0, unsigned maxAttempts = 3);
+    // Same as BatchRunner::Run. A job that was running in a crashing worker maxAttempts times is reported
+    // with an error instead
+    void Run(const vector<BatchJob>& jobs, const std::function<void(const BatchResult&)>& report) const;
+
+private:
+    unsigned m_workers;
+    unsigned m_threadsPerWorker;
+    uint64_t m_memoryLimit;
+    unsigned m_maxAttempts;
+};
+
+#endif // COORDINATOR_H
@@ -0,0 +1,46 @@
+#include "WorkStealingQueue.h"
+
+#include <algorithm>
+
+WorkStealingQueue::WorkStealingQueue(const size_t count, const size_t workers) :
+    m_queues(std::max<size_t>(workers, 1))
+{
+    for (size_t item = 0; item < count; item++) {
+        m_queues[item * m_queues.size() / count].items.push_back(item);
+    }
+}
+
+bool WorkStealingQueue::Take(const size_t worker, size_t& item)
+{
+    if (TakeFront(m_queues[worker], item)) {
+        return true;
+    }
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        if (TakeBack(m_queues[(worker + i) % m_queues.size()], item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingQueue::TakeFront(Queue& queue, size_t& item)
+{
+    std::lock_guard lock(queue.mutex);
+    if (queue.items.empty()) {
+        return false;
+    }
+    item = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+bool WorkStealingQueue::TakeBack(Queue& queue, size_t& item)
+{
+    std::lock_guard lock(queue.mutex);
+    if (queue.items.empty()) {
+        return false;
+    }
+    item = queue.items.back();
+    queue.items.pop_back();
+    return true;
+}
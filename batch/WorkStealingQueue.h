@@ -0,0 +1,34 @@
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using std::vector;
+
+// Indices of work items split between a fixed number of workers. Each worker takes its own items from the front
+// and steals from the back of the others once it runs out, so long items on one worker do not leave the rest idle.
+// The queues are only filled before the workers start
+class WorkStealingQueue
+{
+public:
+    // items 0 to count - 1 in contiguous ranges, one per worker
+    WorkStealingQueue(size_t count, size_t workers);
+    // the next item for the worker, false once there is none left anywhere
+    bool Take(size_t worker, size_t& item);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    bool TakeFront(Queue& queue, size_t& item);
+    bool TakeBack(Queue& queue, size_t& item);
+
+    vector<Queue> m_queues;
+};
+
+#endif // WORKSTEALINGQUEUE_H
@@ -0,0 +1,275 @@
+#include "Compressor.h"
+
+static constexpr uint32_t OP = 0b0110011;
+static constexpr uint32_t OP_IMM = 0b0010011;
+static constexpr uint32_t LOAD = 0b0000011;
+static constexpr uint32_t STORE = 0b0100011;
+static constexpr uint32_t BRANCH = 0b1100011;
+static constexpr uint32_t JAL = 0b1101111;
+static constexpr uint32_t JALR = 0b1100111;
+static constexpr uint32_t LUI = 0b0110111;
+
+static constexpr uint32_t SP = 2;
+static constexpr uint32_t RA = 1;
+
+static uint32_t Field(const uint32_t value, const int hi, const int lo)
+{
+    return value >> lo & ((1u << (hi - lo + 1)) - 1);
+}
+
+// bits hi to lo of value moved to start at bit to
+static uint16_t Place(const int32_t value, const int hi, const int lo, const int to)
+{
+    return static_cast<uint16_t>(Field(static_cast<uint32_t>(value), hi, lo) << to);
+}
+
+static bool Fits(const int32_t value, const int bits)
+{
+    return value >= -(1 << (bits - 1)) && value < 1 << (bits - 1);
+}
+
+// x8 to x15, the registers the three-bit fields reach
+static bool IsCompressedRegister(const uint32_t reg)
+{
+    return reg >= 8 && reg <= 15;
+}
+
+static uint16_t EncodeCI(const uint32_t funct3, const int32_t imm, const uint32_t rd, const uint32_t quadrant)
+{
+    return static_cast<uint16_t>(funct3 << 13 | Place(imm, 5, 5, 12) | rd << 7 | Place(imm, 4, 0, 2) | quadrant);
+}
+
+static uint16_t EncodeCR(const uint32_t funct4, const uint32_t rd, const uint32_t rs2)
+{
+    return static_cast<uint16_t>(funct4 << 12 | rd << 7 | rs2 << 2 | 0b10);
+}
+
+// c.lw and c.sw
+static uint16_t EncodeCL(const uint32_t funct3, const int32_t imm, const uint32_t rs1, const uint32_t reg)
+{
+    return static_cast<uint16_t>(funct3 << 13 | Place(imm, 5, 3, 10) | (rs1 - 8) << 7 | Place(imm, 2, 2, 6) |
+                                 Place(imm, 6, 6, 5) | (reg - 8) << 2);
+}
+
+bool Compressor::Compress(const uint32_t instruction, uint16_t& compressed)
+{
+    switch (Field(instruction, 6, 0)) {
+    case OP_IMM:
+    case LUI:
+        return CompressImmediate(instruction, compressed);
+    case OP:
+        return CompressRegister(instruction, compressed);
+    case LOAD:
+    case STORE:
+        return CompressMemory(instruction, compressed);
+    case BRANCH:
+    case JAL:
+    case JALR:
+        return CompressControlFlow(instruction, compressed);
+    default:
+        return false;
+    }
+}
+
+bool Compressor::CompressImmediate(const uint32_t instruction, uint16_t& compressed)
+{
+    const uint32_t rd = Field(instruction, 11, 7);
+    const uint32_t funct3 = Field(instruction, 14, 12);
+    const uint32_t rs1 = Field(instruction, 19, 15);
+    const uint32_t funct7 = Field(instruction, 31, 25);
+    const int32_t imm = static_cast<int32_t>(instruction) >> 20;
+    const int32_t shamt = imm & 0x1F;
+
+    if (Field(instruction, 6, 0) == LUI) {
+        // c.lui with the stack pointer is c.addi16sp
+        const int32_t upper = static_cast<int32_t>(instruction) >> 12;
+        if (rd == 0 || rd == SP || upper == 0 || !Fits(upper, 6)) {
+            return false;
+        }
+        compressed = EncodeCI(0b011, upper, rd, 0b01);
+        return true;
+    }
+
+    switch (funct3) {
+    case 0b000:
+        if (rd == 0 && rs1 == 0 && imm == 0) {
+            compressed = COMPRESSED_NOP;
+            return true;
+        }
+        if (rd != 0 && rd == rs1 && imm != 0 && Fits(imm, 6)) {
+            compressed = EncodeCI(0b000, imm, rd, 0b01);
+            return true;
+        }
+        if (rd != 0 && rs1 == 0 && Fits(imm, 6)) {
+            compressed = EncodeCI(0b010, imm, rd, 0b01);
+            return true;
+        }
+        if (rd == SP && rs1 == SP && imm != 0 && imm % 16 == 0 && Fits(imm, 10)) {
+            compressed = static_cast<uint16_t>(0b011 << 13 | Place(imm, 9, 9, 12) | SP << 7 | Place(imm, 4, 4, 6) |
+                                               Place(imm, 6, 6, 5) | Place(imm, 8, 7, 3) | Place(imm, 5, 5, 2) | 0b01);
+            return true;
+        }
+        if (IsCompressedRegister(rd) && rs1 == SP && imm > 0 && imm % 4 == 0 && imm < 1024) {
+            compressed = static_cast<uint16_t>(Place(imm, 5, 4, 11) | Place(imm, 9, 6, 7) | Place(imm, 2, 2, 6) |
+                                               Place(imm, 3, 3, 5) | (rd - 8) << 2);
+            return true;
+        }
+        // addi rd, rs1, 0 is a move
+        if (rd != 0 && rs1 != 0 && imm == 0) {
+            compressed = EncodeCR(0b1000, rd, rs1);
+            return true;
+        }
+        return false;
+    case 0b001:
+        if (rd == 0 || rd != rs1 || funct7 != 0 || shamt == 0) {
+            return false;
+        }
+        compressed = EncodeCI(0b000, shamt, rd, 0b10);
+        return true;
+    case 0b101:
+        if (!IsCompressedRegister(rd) || rd != rs1 || (funct7 != 0 && funct7 != 0b0100000) || shamt == 0) {
+            return false;
+        }
+        compressed = static_cast<uint16_t>(0b100 << 13 | (funct7 == 0 ? 0b00 : 0b01) << 10 | (rd - 8) << 7 |
+                                           shamt << 2 | 0b01);
+        return true;
+    case 0b111:
+        if (!IsCompressedRegister(rd) || rd != rs1 || !Fits(imm, 6)) {
+            return false;
+        }
+        compressed = static_cast<uint16_t>(0b100 << 13 | Place(imm, 5, 5, 12) | 0b10 << 10 | (rd - 8) << 7 |
+                                           Place(imm, 4, 0, 2) | 0b01);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Compressor::CompressRegister(const uint32_t instruction, uint16_t& compressed)
+{
+    const uint32_t rd = Field(instruction, 11, 7);
+    const uint32_t funct3 = Field(instruction, 14, 12);
+    const uint32_t rs1 = Field(instruction, 19, 15);
+    const uint32_t rs2 = Field(instruction, 24, 20);
+    const uint32_t funct7 = Field(instruction, 31, 25);
+
+    if (funct7 == 0 && funct3 == 0b000) {
+        if (rd == 0) {
+            return false;
+        }
+        // c.add and c.mv, x0 can only be a source of c.mv
+        if (rs1 != 0 && rs2 != 0 && (rd == rs1 || rd == rs2)) {
+            compressed = EncodeCR(0b1001, rd, rd == rs1 ? rs2 : rs1);
+            return true;
+        }
+        if ((rs1 == 0) != (rs2 == 0)) {
+            compressed = EncodeCR(0b1000, rd, rs1 == 0 ? rs2 : rs1);
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t funct2;
+    if (funct7 == 0b0100000 && funct3 == 0b000) {
+        funct2 = 0b00;
+    }
+    else if (funct7 == 0 && funct3 == 0b100) {
+        funct2 = 0b01;
+    }
+    else if (funct7 == 0 && funct3 == 0b110) {
+        funct2 = 0b10;
+    }
+    else if (funct7 == 0 && funct3 == 0b111) {
+        funct2 = 0b11;
+    }
+    else {
+        return false;
+    }
+    // all but sub are commutative, so rd may be either source
+    const bool commutative = funct2 != 0b00;
+    if (!IsCompressedRegister(rd) || (rd != rs1 && (!commutative || rd != rs2))) {
+        return false;
+    }
+    const uint32_t source = rd == rs1 ? rs2 : rs1;
+    if (!IsCompressedRegister(source)) {
+        return false;
+    }
+    compressed = static_cast<uint16_t>(0b100011 << 10 | (rd - 8) << 7 | funct2 << 5 | (source - 8) << 2 | 0b01);
+    return true;
+}
+
+bool Compressor::CompressMemory(const uint32_t instruction, uint16_t& compressed)
+{
+    // only words have compressed loads and stores
+    if (Field(instruction, 14, 12) != 0b010) {
+        return false;
+    }
+    const uint32_t rs1 = Field(instruction, 19, 15);
+    const bool load = Field(instruction, 6, 0) == LOAD;
+    // the register loaded or stored
+    const uint32_t reg = load ? Field(instruction, 11, 7) : Field(instruction, 24, 20);
+    const int32_t upper = load ? static_cast<int32_t>(instruction) >> 20 : static_cast<int32_t>(instruction) >> 25;
+    const int32_t imm = load ? upper : upper * 32 | static_cast<int32_t>(Field(instruction, 11, 7));
+    if (imm < 0 || imm % 4 != 0) {
+        return false;
+    }
+
+    if (rs1 == SP && imm < 256 && (!load || reg != 0)) {
+        compressed = load ? static_cast<uint16_t>(0b010 << 13 | Place(imm, 5, 5, 12) | reg << 7 | Place(imm, 4, 2, 4) |
+                                                  Place(imm, 7, 6, 2) | 0b10)
+                          : static_cast<uint16_t>(0b110 << 13 | Place(imm, 5, 2, 9) | Place(imm, 7, 6, 7) | reg << 2 |
+                                                  0b10);
+        return true;
+    }
+    if (IsCompressedRegister(rs1) && IsCompressedRegister(reg) && imm < 128) {
+        compressed = EncodeCL(load ? 0b010 : 0b110, imm, rs1, reg);
+        return true;
+    }
+    return false;
+}
+
+bool Compressor::CompressControlFlow(const uint32_t instruction, uint16_t& compressed)
+{
+    const uint32_t rd = Field(instruction, 11, 7);
+    const uint32_t funct3 = Field(instruction, 14, 12);
+    const uint32_t rs1 = Field(instruction, 19, 15);
+    const uint32_t rs2 = Field(instruction, 24, 20);
+    const int32_t sign = static_cast<int32_t>(instruction) >> 31;
+
+    switch (Field(instruction, 6, 0)) {
+    case BRANCH: {
+        // c.beqz and c.bnez compare against x0
+        const uint32_t reg = rs2 == 0 ? rs1 : rs2;
+        const int32_t offset = sign * 4096 | static_cast<int32_t>(Field(instruction, 7, 7) << 11 |
+                                                                  Field(instruction, 30, 25) << 5 |
+                                                                  Field(instruction, 11, 8) << 1);
+        if (funct3 > 0b001 || (rs1 != 0 && rs2 != 0) || !IsCompressedRegister(reg) || !Fits(offset, 9)) {
+            return false;
+        }
+        compressed = static_cast<uint16_t>((funct3 == 0b000 ? 0b110 : 0b111) << 13 | Place(offset, 8, 8, 12) |
+                                           Place(offset, 4, 3, 10) | (reg - 8) << 7 | Place(offset, 7, 6, 5) |
+                                           Place(offset, 2, 1, 3) | Place(offset, 5, 5, 2) | 0b01);
+        return true;
+    }
+    case JAL: {
+        const int32_t offset = sign * (1 << 20) | static_cast<int32_t>(Field(instruction, 19, 12) << 12 |
+                                                                       Field(instruction, 20, 20) << 11 |
+                                                                       Field(instruction, 30, 21) << 1);
+        if ((rd != 0 && rd != RA) || !Fits(offset, 12)) {
+            return false;
+        }
+        compressed = static_cast<uint16_t>((rd == 0 ? 0b101 : 0b001) << 13 | Place(offset, 11, 11, 12) |
+                                           Place(offset, 4, 4, 11) | Place(offset, 9, 8, 9) | Place(offset, 10, 10, 8) |
+                                           Place(offset, 6, 6, 7) | Place(offset, 7, 7, 6) | Place(offset, 3, 1, 3) |
+                                           Place(offset, 5, 5, 2) | 0b01);
+        return true;
+    }
+    default:
+        // c.jr and c.jalr jump to the register itself
+        if (funct3 != 0 || static_cast<int32_t>(instruction) >> 20 != 0 || rs1 == 0 || (rd != 0 && rd != RA)) {
+            return false;
+        }
+        compressed = EncodeCR(rd == 0 ? 0b1000 : 0b1001, rs1, 0);
+        return true;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+#include <cstdint>
+
+// c.nop, which pads compressed code to whole words
+constexpr uint16_t COMPRESSED_NOP = 0x0001;
+
+// Finds the 16-bit RVC form of encoded 32-bit instructions
+class Compressor
+{
+public:
+    // False if the instruction has no compressed form with the same effect, such as one whose registers or
+    // immediate do not fit
+    static bool Compress(uint32_t instruction, uint16_t& compressed);
+
+private:
+    static bool CompressImmediate(uint32_t instruction, uint16_t& compressed);
+    static bool CompressRegister(uint32_t instruction, uint16_t& compressed);
+    static bool CompressMemory(uint32_t instruction, uint16_t& compressed);
+    static bool CompressControlFlow(uint32_t instruction, uint16_t& compressed);
+};
+
+#endif // COMPRESSOR_H
@@ -45,3 +45,50 @@ const string OpCodes::DIV = "div";
 const string OpCodes::DIVU = "divu";
 const string OpCodes::REM = "rem";
 const string OpCodes::REMU = "remu";
+const string OpCodes::SH1ADD = "sh1add";
+const string OpCodes::SH2ADD = "sh2add";
+const string OpCodes::SH3ADD = "sh3add";
+const string OpCodes::ANDN = "andn";
+const string OpCodes::ORN = "orn";
+const string OpCodes::XNOR = "xnor";
+const string OpCodes::MIN = "min";
+const string OpCodes::MINU = "minu";
+const string OpCodes::MAX = "max";
+const string OpCodes::MAXU = "maxu";
+const string OpCodes::ROL = "rol";
+const string OpCodes::ROR = "ror";
+const string OpCodes::RORI = "rori";
+const string OpCodes::CLZ = "clz";
+const string OpCodes::CTZ = "ctz";
+const string OpCodes::CPOP = "cpop";
+const string OpCodes::SEXT_B = "sext.b";
+const string OpCodes::SEXT_H = "sext.h";
+const string OpCodes::ZEXT_H = "zext.h";
+const string OpCodes::ORC_B = "orc.b";
+const string OpCodes::REV8 = "rev8";
+const string OpCodes::C_ADDI = "c.addi";
+const string OpCodes::C_LI = "c.li";
+const string OpCodes::C_ADDI16SP = "c.addi16sp";
+const string OpCodes::C_ADDI4SPN = "c.addi4spn";
+const string OpCodes::C_LUI = "c.lui";
+const string OpCodes::C_SLLI = "c.slli";
+const string OpCodes::C_SRLI = "c.srli";
+const string OpCodes::C_SRAI = "c.srai";
+const string OpCodes::C_ANDI = "c.andi";
+const string OpCodes::C_MV = "c.mv";
+const string OpCodes::C_ADD = "c.add";
+const string OpCodes::C_SUB = "c.sub";
+const string OpCodes::C_XOR = "c.xor";
+const string OpCodes::C_OR = "c.or";
+const string OpCodes::C_AND = "c.and";
+const string OpCodes::C_LW = "c.lw";
+const string OpCodes::C_SW = "c.sw";
+const string OpCodes::C_LWSP = "c.lwsp";
+const string OpCodes::C_SWSP = "c.swsp";
+const string OpCodes::C_J = "c.j";
+const string OpCodes::C_JAL = "c.jal";
+const string OpCodes::C_JR = "c.jr";
+const string OpCodes::C_JALR = "c.jalr";
+const string OpCodes::C_BEQZ = "c.beqz";
+const string OpCodes::C_BNEZ = "c.bnez";
+const string OpCodes::C_NOP = "c.nop";
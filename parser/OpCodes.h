@@ -68,6 +68,53 @@ public:
     static const string DIVU;
     static const string REM;
     static const string REMU;
+    static const string SH1ADD;
+    static const string SH2ADD;
+    static const string SH3ADD;
+    static const string ANDN;
+    static const string ORN;
+    static const string XNOR;
+    static const string MIN;
+    static const string MINU;
+    static const string MAX;
+    static const string MAXU;
+    static const string ROL;
+    static const string ROR;
+    static const string RORI;
+    static const string CLZ;
+    static const string CTZ;
+    static const string CPOP;
+    static const string SEXT_B;
+    static const string SEXT_H;
+    static const string ZEXT_H;
+    static const string ORC_B;
+    static const string REV8;
+    static const string C_ADDI;
+    static const string C_LI;
+    static const string C_ADDI16SP;
+    static const string C_ADDI4SPN;
+    static const string C_LUI;
+    static const string C_SLLI;
+    static const string C_SRLI;
+    static const string C_SRAI;
+    static const string C_ANDI;
+    static const string C_MV;
+    static const string C_ADD;
+    static const string C_SUB;
+    static const string C_XOR;
+    static const string C_OR;
+    static const string C_AND;
+    static const string C_LW;
+    static const string C_SW;
+    static const string C_LWSP;
+    static const string C_SWSP;
+    static const string C_J;
+    static const string C_JAL;
+    static const string C_JR;
+    static const string C_JALR;
+    static const string C_BEQZ;
+    static const string C_BNEZ;
+    static const string C_NOP;
 };
 
 static const map<string, string> RTypeOpcodes = {
@@ -77,7 +124,7 @@ static const map<string, string> MTypeOpcodes = {
     {OpCodes::ADDI, "000"}, {OpCodes::SLLI, "001"}, {OpCodes::SLTI, "010"}, {OpCodes::SLTIU, "011"},
     {OpCodes::XORI, "100"}, {OpCodes::SRLI, "101"}, {OpCodes::SRAI, "101"}, {OpCodes::ORI, "110"},
     {OpCodes::ANDI, "111"}, {OpCodes::LB, "000"},   {OpCodes::LH, "001"},   {OpCodes::LW, "010"},
-    {OpCodes::LBU, "100"},  {OpCodes::LHU, "101"},  {OpCodes::JALR, "000"}};
+    {OpCodes::LBU, "100"},  {OpCodes::LHU, "101"},  {OpCodes::JALR, "000"}, {OpCodes::RORI, "101"}};
 static const map<string, string> STypeOpcodes = {{OpCodes::SB, "000"}, {OpCodes::SH, "001"}, {OpCodes::SW, "010"}};
 static const map<string, string> BTypeOpcodes = {{OpCodes::BEQ, "000"}, {OpCodes::BNE, "001"},  {OpCodes::BLT, "100"},
                                                  {OpCodes::BGE, "101"}, {OpCodes::BLTU, "110"}, {OpCodes::BGEU, "111"}};
@@ -86,6 +133,19 @@ static const map<string, string> UTypeOpcodes = {{OpCodes::LUI, "000"}, {OpCodes
 static const map<string, string> Rv32mExtensionOpcodes = {
     {OpCodes::MUL, "000"}, {OpCodes::MULH, "001"}, {OpCodes::MULHSU, "010"}, {OpCodes::MULHU, "011"},
     {OpCodes::DIV, "100"}, {OpCodes::DIVU, "101"}, {OpCodes::REM, "110"},    {OpCodes::REMU, "111"}};
+// Zba and Zbb, funct7 and funct3 of the register ones. The unary ones have a fixed upper 12 bits in place of
+// funct7 and rs2
+static const map<string, std::pair<string, string>> BitManipulationOpcodes = {
+    {OpCodes::SH1ADD, {"0010000", "010"}},      {OpCodes::SH2ADD, {"0010000", "100"}},
+    {OpCodes::SH3ADD, {"0010000", "110"}},      {OpCodes::ANDN, {"0100000", "111"}},
+    {OpCodes::ORN, {"0100000", "110"}},         {OpCodes::XNOR, {"0100000", "100"}},
+    {OpCodes::MIN, {"0000101", "100"}},         {OpCodes::MINU, {"0000101", "101"}},
+    {OpCodes::MAX, {"0000101", "110"}},         {OpCodes::MAXU, {"0000101", "111"}},
+    {OpCodes::ROL, {"0110000", "001"}},         {OpCodes::ROR, {"0110000", "101"}},
+    {OpCodes::CLZ, {"011000000000", "001"}},    {OpCodes::CTZ, {"011000000001", "001"}},
+    {OpCodes::CPOP, {"011000000010", "001"}},   {OpCodes::SEXT_B, {"011000000100", "001"}},
+    {OpCodes::SEXT_H, {"011000000101", "001"}}, {OpCodes::ZEXT_H, {"000010000000", "100"}},
+    {OpCodes::ORC_B, {"001010000111", "101"}},  {OpCodes::REV8, {"011010011000", "101"}}};
 
 static const map<string, vector<ParameterData>> InstructionParameters = {
     {OpCodes::ADD, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
@@ -132,6 +192,57 @@ static const map<string, vector<ParameterData>> InstructionParameters = {
     {OpCodes::DIV, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
     {OpCodes::DIVU, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
     {OpCodes::REM, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
-    {OpCodes::REMU, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}}};
+    {OpCodes::REMU, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::SH1ADD, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::SH2ADD, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::SH3ADD, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ANDN, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ORN, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::XNOR, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::MIN, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::MINU, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::MAX, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::MAXU, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ROL, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ROR, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::RORI, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}, {ParameterType::IMMEDIATE, 7}}},
+    {OpCodes::CLZ, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::CTZ, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::CPOP, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::SEXT_B, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::SEXT_H, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ZEXT_H, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::ORC_B, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}},
+    {OpCodes::REV8, {{ParameterType::REGISTER, 5}, {ParameterType::REGISTER, 5}}}};
+
+// Compressed instructions are written like the base instruction they stand for, with some operands fixed,
+// $n is the n-th operand given
+static const map<string, std::pair<string, vector<string>>> CompressedOpcodes = {
+    {OpCodes::C_ADDI, {OpCodes::ADDI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_LI, {OpCodes::ADDI, {"$0", "x0", "$1"}}},
+    {OpCodes::C_ADDI16SP, {OpCodes::ADDI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_ADDI4SPN, {OpCodes::ADDI, {"$0", "$1", "$2"}}},
+    {OpCodes::C_LUI, {OpCodes::LUI, {"$0", "$1"}}},
+    {OpCodes::C_SLLI, {OpCodes::SLLI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_SRLI, {OpCodes::SRLI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_SRAI, {OpCodes::SRAI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_ANDI, {OpCodes::ANDI, {"$0", "$0", "$1"}}},
+    {OpCodes::C_MV, {OpCodes::ADD, {"$0", "x0", "$1"}}},
+    {OpCodes::C_ADD, {OpCodes::ADD, {"$0", "$0", "$1"}}},
+    {OpCodes::C_SUB, {OpCodes::SUB, {"$0", "$0", "$1"}}},
+    {OpCodes::C_XOR, {OpCodes::XOR, {"$0", "$0", "$1"}}},
+    {OpCodes::C_OR, {OpCodes::OR, {"$0", "$0", "$1"}}},
+    {OpCodes::C_AND, {OpCodes::AND, {"$0", "$0", "$1"}}},
+    {OpCodes::C_LW, {OpCodes::LW, {"$0", "$1", "$2"}}},
+    {OpCodes::C_SW, {OpCodes::SW, {"$0", "$1", "$2"}}},
+    {OpCodes::C_LWSP, {OpCodes::LW, {"$0", "$1", "$2"}}},
+    {OpCodes::C_SWSP, {OpCodes::SW, {"$0", "$1", "$2"}}},
+    {OpCodes::C_J, {OpCodes::JAL, {"x0", "$0"}}},
+    {OpCodes::C_JAL, {OpCodes::JAL, {"x1", "$0"}}},
+    {OpCodes::C_JR, {OpCodes::JALR, {"x0", "0", "$0"}}},
+    {OpCodes::C_JALR, {OpCodes::JALR, {"x1", "0", "$0"}}},
+    {OpCodes::C_BEQZ, {OpCodes::BEQ, {"$0", "x0", "$1"}}},
+    {OpCodes::C_BNEZ, {OpCodes::BNE, {"$0", "x0", "$1"}}},
+    {OpCodes::C_NOP, {OpCodes::ADDI, {"x0", "x0", "0"}}}};
 
 #endif // OPCODES_H
@@ -1,4 +1,5 @@
 #include "Parser.h"
+#include "Compressor.h"
 #include "OpCodes.h"
 
 #include <algorithm>
@@ -11,11 +12,39 @@ using std::stoi;
 const std::regex Parser::m_labelRegex = std::regex(R"(^\s*[a-z_][a-z0-9_]*:\s*$)");
 
 
-ParsingResult Parser::Parse(const vector<string>& instructions)
+ParsingResult Parser::Parse(const vector<string>& instructions, const bool compress)
+{
+    // Compressing an instruction only brings the labels after it closer, so what has been compressed stays
+    // compressible and laying the code out again until nothing more fits ends with offsets that are all right
+    vector<uint8_t> sizes;
+    while (true) {
+        vector<bool> required;
+        ParsingResult result = Assemble(instructions, sizes, required);
+        if (!result.success) {
+            return result;
+        }
+        sizes.resize(result.instructions.size(), sizeof(uint32_t));
+        bool changed = false;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            uint16_t compressed;
+            if (sizes[i] == sizeof(uint32_t) && (compress || required[i]) &&
+                Compressor::Compress(result.instructions[i], compressed)) {
+                sizes[i] = sizeof(uint16_t);
+                changed = true;
+            }
+        }
+        if (!changed) {
+            return Pack(result, sizes, required, instructions);
+        }
+    }
+}
+
+ParsingResult Parser::Assemble(const vector<string>& instructions, const vector<uint8_t>& sizes,
+                               vector<bool>& required)
 {
     vector<uint32_t> parsedInstructions;
     vector<uint32_t> instructionMap;
-    const auto [preprocessedInstructions, error] = Preprocess(instructions);
+    const auto [preprocessedInstructions, error] = Preprocess(instructions, sizes);
     if (error.errorType != ParsingError::NONE) {
         return error;
     }
@@ -42,23 +71,34 @@ ParsingResult Parser::Parse(const vector<string>& instructions)
         }
         const size_t index = instruction.find(' ');
         string opcode = instruction.substr(0, index);
-        string operands = RemoveSpaces(instruction.substr(index + 1));
-        if (!InstructionParameters.contains(opcode)) {
+        string operands = index == string::npos ? "" : RemoveSpaces(instruction.substr(index + 1));
+        const bool compressed = CompressedOpcodes.contains(opcode);
+        if (!InstructionParameters.contains(opcode) && !compressed) {
             return ParsingResult{false, parsedInstructions,          opcode, instructionMap,
                                  i + 1, ParsingError::INVALID_OPCODE};
         }
-        if (operands.empty()) {
+        if (operands.empty() && opcode != OpCodes::C_NOP) {
             return ParsingResult{
                 false, parsedInstructions, "", instructionMap, i + 1, ParsingError::INVALID_OPERAND_COUNT};
         }
 
+        const string mnemonic = opcode;
+        if (compressed) {
+            auto [expandedOperands, expansionError] = ExpandCompressed(opcode, operands);
+            if (ParsingError::NONE != expansionError) {
+                return ParsingResult{false, parsedInstructions, mnemonic, instructionMap, i + 1, expansionError};
+            }
+            opcode = CompressedOpcodes.at(mnemonic).first;
+            operands = expandedOperands;
+        }
         auto [parsedInstruction, parsingError] = ParseInstruction(opcode, operands);
         if (ParsingError::NONE != parsingError) {
-            return ParsingResult{false, parsedInstructions, opcode, instructionMap, i + 1, parsingError};
+            return ParsingResult{false, parsedInstructions, mnemonic, instructionMap, i + 1, parsingError};
         }
 
         parsedInstructions.push_back(parsedInstruction);
         instructionMap.push_back(i);
+        required.push_back(compressed);
     }
     if (parsedInstructions.empty()) {
         return ParsingResult{false, parsedInstructions, "", instructionMap, 0, ParsingError::EMPTY_INPUT};
@@ -67,8 +107,53 @@ ParsingResult Parser::Parse(const vector<string>& instructions)
     return ParsingResult{true, parsedInstructions, "", instructionMap, -1, ParsingError::NONE};
 }
 
-std::pair<vector<string>, ParsingResult> Parser::Preprocess(const vector<string>& instructions)
+ParsingResult Parser::Pack(const ParsingResult& assembled, const vector<uint8_t>& sizes, const vector<bool>& required,
+                           const vector<string>& instructions)
+{
+    vector<uint16_t> halves;
+    vector<uint32_t> addresses;
+    for (size_t i = 0; i < assembled.instructions.size(); i++) {
+        const uint32_t instruction = assembled.instructions[i];
+        addresses.push_back(halves.size() * sizeof(uint16_t));
+        uint16_t compressed;
+        if (sizes[i] == sizeof(uint16_t) && Compressor::Compress(instruction, compressed)) {
+            halves.push_back(compressed);
+            continue;
+        }
+        if (required[i]) {
+            const int line = static_cast<int>(assembled.instructionMap[i]);
+            const string text = ToLowerCase(instructions[line]);
+            const size_t start = text.find_first_not_of(" \t");
+            const string opcode = text.substr(start, text.find_first_of(" \t", start) - start);
+            return ParsingResult{false, {}, opcode, {}, line + 1, ParsingError::NOT_COMPRESSIBLE};
+        }
+        halves.push_back(static_cast<uint16_t>(instruction));
+        halves.push_back(static_cast<uint16_t>(instruction >> 16));
+    }
+    if (halves.size() % 2 != 0) {
+        halves.push_back(COMPRESSED_NOP);
+    }
+
+    vector<uint32_t> words;
+    for (size_t i = 0; i < halves.size(); i += 2) {
+        words.push_back(halves[i] | static_cast<uint32_t>(halves[i + 1]) << 16);
+    }
+    return ParsingResult{true, words, "", assembled.instructionMap, -1, ParsingError::NONE, addresses};
+}
+
+std::pair<vector<string>, ParsingResult> Parser::Preprocess(const vector<string>& instructions,
+                                                            const vector<uint8_t>& sizes)
 {
+    // address of the code instruction with the index, the ones without a size yet are taken to be 32-bit
+    vector<int32_t> addresses{0};
+    const auto addressOf = [&](const size_t index) {
+        while (addresses.size() <= index) {
+            const size_t previous = addresses.size() - 1;
+            addresses.push_back(addresses.back() + (previous < sizes.size() ? sizes[previous] : sizeof(uint32_t)));
+        }
+        return addresses[index];
+    };
+
     map<string, int32_t> labelMap;
     vector<string> preprocessedInstructions;
     int nonCodeLines = 0;
@@ -89,7 +174,7 @@ std::pair<vector<string>, ParsingResult> Parser::Preprocess(const vector<string>
             if (labelMap.contains(label)) {
                 return {{}, {false, {}, label, {}, i + 1, ParsingError::DUPLICATE_LABEL_DEFINITION}};
             }
-            labelMap[label] = (preprocessedInstructions.size() - nonCodeLines) * 4;
+            labelMap[label] = addressOf(preprocessedInstructions.size() - nonCodeLines);
             nonCodeLines++;
         }
         preprocessedInstructions.push_back(instruction);
@@ -108,7 +193,7 @@ std::pair<vector<string>, ParsingResult> Parser::Preprocess(const vector<string>
         for (const auto& [label, address] : labelMap) {
             const string labelRegex = R"(\b)" + label + R"(\b(?!:))";
             instruction = std::regex_replace(instruction, std::regex(labelRegex),
-                                             std::to_string(address - (i - nonCodeLines) * 4));
+                                             std::to_string(address - addressOf(i - nonCodeLines)));
         }
     }
     return {preprocessedInstructions, {true, {}, "", {}, -1, ParsingError::NONE}};
@@ -141,6 +226,9 @@ std::pair<uint32_t, ParsingError> Parser::ParseInstruction(const string& opcode,
     if (Rv32mExtensionOpcodes.contains(opcode)) {
         return ParseMExtension(opcode, operands);
     }
+    if (BitManipulationOpcodes.contains(opcode)) {
+        return ParseBitManipulation(opcode, operands);
+    }
 
     return {0, ParsingError::OPCODE_NOT_FOUND};
 }
@@ -159,7 +247,8 @@ std::pair<uint32_t, ParsingError> Parser::ParseRType(const string& opcode, const
 
 std::pair<uint32_t, ParsingError> Parser::ParseIType(const string& opcode, const string& operands)
 {
-    const bool isSigned = !(opcode == OpCodes::SRAI || opcode == OpCodes::SLLI || opcode == OpCodes::SRLI);
+    const bool isSigned = !(opcode == OpCodes::SRAI || opcode == OpCodes::SLLI || opcode == OpCodes::SRLI ||
+                            opcode == OpCodes::RORI);
     auto [args, error] = ParseArguments(opcode, operands);
     if (error != ParsingError::NONE) {
         return {0, error};
@@ -168,7 +257,13 @@ std::pair<uint32_t, ParsingError> Parser::ParseIType(const string& opcode, const
     string parsedInstruction;
     if (!isSigned) // shift instructions
     {
-        const string funct7 = (opcode == OpCodes::SRAI) ? "01000" : "00000";
+        string funct7 = "00000";
+        if (opcode == OpCodes::SRAI) {
+            funct7 = "01000";
+        }
+        else if (opcode == OpCodes::RORI) {
+            funct7 = "01100";
+        }
         parsedInstruction = funct7 + args[2] + args[1] + MTypeOpcodes.at(opcode) + args[0] + "0010011";
     }
     else if (opcode == OpCodes::JALR) {
@@ -249,6 +344,26 @@ std::pair<uint32_t, ParsingError> Parser::ParseMExtension(const string& opcode,
     return {stoul(parsedInstruction, nullptr, 2), ParsingError::NONE};
 }
 
+std::pair<uint32_t, ParsingError> Parser::ParseBitManipulation(const string& opcode, const string& operands)
+{
+    auto [args, error] = ParseArguments(opcode, operands);
+    if (error != ParsingError::NONE) {
+        return {0, error};
+    }
+
+    const auto& [upper, funct3] = BitManipulationOpcodes.at(opcode);
+    string parsedInstruction;
+    if (args.size() == 2) {
+        // zext.h is the one unary instruction among the register ones
+        parsedInstruction =
+            upper + args[1] + funct3 + args[0] + (opcode == OpCodes::ZEXT_H ? "0110011" : "0010011");
+    }
+    else {
+        parsedInstruction = upper + args[2] + args[1] + funct3 + args[0] + "0110011";
+    }
+    return {stoul(parsedInstruction, nullptr, 2), ParsingError::NONE};
+}
+
 vector<string> SplitOperands(const string& operands)
 {
     vector<string> args;
@@ -282,6 +397,27 @@ std::pair<vector<string>, ParsingError> Parser::ParseArguments(const string& opc
     return {args, ParsingError::NONE};
 }
 
+std::pair<string, ParsingError> Parser::ExpandCompressed(const string& opcode, const string& operands)
+{
+    const auto& pattern = CompressedOpcodes.at(opcode).second;
+    const auto parameters = SplitOperands(operands);
+    size_t count = 0;
+    for (const string& part : pattern) {
+        if (part[0] == '$') {
+            count = std::max<size_t>(count, part[1] - '0' + 1);
+        }
+    }
+    if (parameters.size() != count) {
+        return {"", ParsingError::INVALID_OPERAND_COUNT};
+    }
+
+    string expanded;
+    for (const string& part : pattern) {
+        expanded += (expanded.empty() ? "" : ",") + (part[0] == '$' ? parameters[part[1] - '0'] : part);
+    }
+    return {expanded, ParsingError::NONE};
+}
+
 std::pair<int, ParsingError> Parser::RegisterToNumber(const string& reg)
 {
     // Extract the register number (e.g., x5 -> 5).
@@ -14,12 +14,22 @@ class Parser
 {
 public:
     // Parse instructions from a vector of strings to a vector of 32-bit unsigned integers
-    // Each string is a single instruction
-    static ParsingResult Parse(const vector<string>& instructions);
+    // Each string is a single instruction. c. mnemonics are encoded in 16 bits and with compress, so is every
+    // other instruction that has a compressed form. The halves are packed into the words little-endian first,
+    // with a c.nop at the end if their number is odd
+    static ParsingResult Parse(const vector<string>& instructions, bool compress = false);
 
 private:
+    // encodes every instruction in 32 bits, with labels resolved for the sizes given so far
+    static ParsingResult Assemble(const vector<string>& instructions, const vector<uint8_t>& sizes,
+                                  vector<bool>& required);
+    static ParsingResult Pack(const ParsingResult& assembled, const vector<uint8_t>& sizes,
+                              const vector<bool>& required, const vector<string>& instructions);
+    // the operands of the base instruction a c. mnemonic stands for
+    static std::pair<string, ParsingError> ExpandCompressed(const string& opcode, const string& operands);
     static std::pair<uint32_t, ParsingError> ParseInstruction(const string& opcode, const string& operands);
-    static std::pair<vector<string>, ParsingResult> Preprocess(const vector<string>& instructions);
+    static std::pair<vector<string>, ParsingResult> Preprocess(const vector<string>& instructions,
+                                                                     const vector<uint8_t>& sizes);
     static std::pair<uint32_t, ParsingError> ParseRType(const string& opcode, const string& operands);
     static std::pair<uint32_t, ParsingError> ParseIType(const string& opcode, const string& operands);
     static std::pair<uint32_t, ParsingError> ParseSType(const string& opcode, const string& operands);
@@ -27,6 +37,7 @@ private:
     static std::pair<uint32_t, ParsingError> ParseJType(const string& opcode, const string& operands);
     static std::pair<uint32_t, ParsingError> ParseUType(const string& opcode, const string& operands);
     static std::pair<uint32_t, ParsingError> ParseMExtension(const string& opcode, const string& operands);
+    static std::pair<uint32_t, ParsingError> ParseBitManipulation(const string& opcode, const string& operands);
     static std::pair<vector<string>, ParsingError> ParseArguments(const string& opcode, const string& operands);
     static string ToLowerCase(const string& input);
     static string RemoveSpaces(const string& input);
@@ -8,16 +8,19 @@ using std::cout;
 
 int main(const int argc, char* argv[])
 {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <in> [out]" << std::endl;
+    // -c compresses every instruction that has a 16-bit form
+    const bool compress = argc >= 2 && string(argv[1]) == "-c";
+    const int first = compress ? 2 : 1;
+    if (argc < first + 1) {
+        std::cerr << "Usage: " << argv[0] << " [-c] <in> [out]" << std::endl;
         return 1;
     }
 
-    const string in = argv[1];
+    const string in = argv[first];
     string out;
 
-    if (argc >= 3) {
-        out = argv[2];
+    if (argc >= first + 2) {
+        out = argv[first + 1];
     }
 
     std::ifstream inputFile(in);
@@ -33,7 +36,7 @@ int main(const int argc, char* argv[])
     }
     inputFile.close();
 
-    ParsingResult result = Parser::Parse(lines);
+    ParsingResult result = Parser::Parse(lines, compress);
     if (!result.success) {
         cout << "Line " << result.errorLine << ": Error while parsing instruction: " << lines[result.errorLine]
              << std::endl;
@@ -21,6 +21,7 @@ enum class ParsingError : uint8_t
     OPCODE_NOT_FOUND = 9,
     EMPTY_INPUT = 10,
     DUPLICATE_LABEL_DEFINITION = 11,
+    NOT_COMPRESSIBLE = 12,
 };
 
 constexpr std::string_view toString(const ParsingError error)
@@ -50,6 +51,8 @@ constexpr std::string_view toString(const ParsingError error)
         return "Empty input";
     case ParsingError::DUPLICATE_LABEL_DEFINITION:
         return "Duplicate label definition";
+    case ParsingError::NOT_COMPRESSIBLE:
+        return "Instruction not compressible";
     default:
         return "Unknown error";
     }
@@ -65,6 +68,8 @@ struct ParsingResult
     vector<uint32_t> instructionMap;
     int errorLine;
     ParsingError errorType;
+    // byte address of each instruction, compressed ones take 2 bytes
+    vector<uint32_t> instructionAddresses;
 };
 
 #endif // PARSINGERROR_H
@@ -0,0 +1,50 @@
+#ifndef BITMANIPULATION_H
+#define BITMANIPULATION_H
+#include <bit>
+#include <cstdint>
+
+// The Zba and Zbb operations, shared by the engines so they all compute the same results. Most of them
+// compile to a single host instruction
+class BitManipulation
+{
+public:
+    static uint32_t AndNot(const uint32_t a, const uint32_t b) { return a & ~b; }
+    static uint32_t OrNot(const uint32_t a, const uint32_t b) { return a | ~b; }
+    static uint32_t XorNot(const uint32_t a, const uint32_t b) { return ~(a ^ b); }
+    // sh1add, sh2add and sh3add, for indexing arrays of 2, 4 and 8 byte elements
+    template <int Shift>
+    static uint32_t ShiftAdd(const uint32_t a, const uint32_t b)
+    {
+        return (a << Shift) + b;
+    }
+    static uint32_t Min(const uint32_t a, const uint32_t b)
+    {
+        return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? a : b;
+    }
+    static uint32_t MinUnsigned(const uint32_t a, const uint32_t b) { return a < b ? a : b; }
+    static uint32_t Max(const uint32_t a, const uint32_t b)
+    {
+        return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? b : a;
+    }
+    static uint32_t MaxUnsigned(const uint32_t a, const uint32_t b) { return a < b ? b : a; }
+    // only the low 5 bits of the amount count
+    static uint32_t RotateLeft(const uint32_t a, const uint32_t b) { return std::rotl(a, static_cast<int>(b & 31)); }
+    static uint32_t RotateRight(const uint32_t a, const uint32_t b) { return std::rotr(a, static_cast<int>(b & 31)); }
+    // 32 for 0
+    static uint32_t CountLeadingZeros(const uint32_t a) { return std::countl_zero(a); }
+    static uint32_t CountTrailingZeros(const uint32_t a) { return std::countr_zero(a); }
+    static uint32_t PopCount(const uint32_t a) { return std::popcount(a); }
+    static uint32_t SignExtendByte(const uint32_t a) { return static_cast<uint32_t>(static_cast<int8_t>(a)); }
+    static uint32_t SignExtendHalf(const uint32_t a) { return static_cast<uint32_t>(static_cast<int16_t>(a)); }
+    static uint32_t ZeroExtendHalf(const uint32_t a) { return static_cast<uint16_t>(a); }
+    // orc.b, every byte that is not zero becomes 0xFF
+    static uint32_t OrCombineBytes(const uint32_t a)
+    {
+        // adding 0x7F to the low 7 bits of a byte carries into its top bit unless they are all zero
+        const uint32_t nonZero = (((a & 0x7F7F7F7F) + 0x7F7F7F7F) | a) & 0x80808080;
+        return (nonZero >> 7) * 0xFF;
+    }
+    static uint32_t ReverseBytes(const uint32_t a) { return std::byteswap(a); }
+};
+
+#endif // BITMANIPULATION_H
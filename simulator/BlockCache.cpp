@@ -0,0 +1,150 @@
+#include "BlockCache.h"
+
+BlockCache::BlockCache(CPU* cpu) : ThreadedInterpreter(cpu) {}
+
+void BlockCache::Load()
+{
+    ThreadedInterpreter::Load();
+    m_blocks.clear();
+    m_blockIndex.assign(m_ops.size() - 1, -1);
+}
+
+RunResult BlockCache::Run(const uint64_t maxInstructions)
+{
+    SyncCode();
+    const uint32_t index = GetIndex(m_cpu->m_registers.GetPC());
+    if (index >= m_ops.size() - 1) {
+        return {0, ExecutionError::PC_OUT_OF_BOUNDS, m_cpu->m_registers.GetPC(), 0, StopReason::HALTED};
+    }
+
+    ThreadedContext context = CreateContext();
+    const ThreadedOp* op = &m_ops[index];
+    int32_t block = GetBlock(index);
+    uint64_t executed = 0;
+    while (maxInstructions - executed >= m_blocks[block].length) {
+        const ThreadedOp* first = op;
+        op = ExecuteBlock(block, context, op);
+        if (context.error != ExecutionError::NONE) {
+            return Failed(context, executed + CountInstructions(first, context.errorOp));
+        }
+        if (context.codeChange != nullptr) {
+            // the block may be gone, go on with the one starting after the change
+            executed += CountInstructions(first, context.codeChange) + 1;
+            op = Resume(context);
+            if (op == context.end) {
+                return Finished(context, op, executed);
+            }
+            block = GetBlock(static_cast<uint32_t>(op - context.base));
+            continue;
+        }
+        executed += m_blocks[block].length;
+        if (op == context.end) {
+            return Finished(context, op, executed);
+        }
+        block = GetSuccessor(block, context, op);
+    }
+
+    // not enough instructions left for the whole block
+    op = Dispatch(context, op, maxInstructions, executed);
+    if (context.error != ExecutionError::NONE) {
+        return Failed(context, executed - 1);
+    }
+    return Finished(context, op, executed);
+}
+
+const ThreadedOp* BlockCache::ExecuteBlock(const int32_t block, ThreadedContext& context, const ThreadedOp* op)
+{
+    const ThreadedOp* terminator = context.base + m_blocks[block].last;
+    while (op < terminator) {
+        op = op->handler(context, op);
+    }
+    if (op == terminator) {
+        op = op->handler(context, op);
+    }
+    return op;
+}
+
+void BlockCache::Invalidate(const uint32_t first, const uint32_t last)
+{
+    ThreadedInterpreter::Invalidate(first, last);
+    for (size_t block = 0; block < m_blocks.size(); block++) {
+        if (m_blocks[block].start <= last && m_blocks[block].last >= first) {
+            Retranslate(static_cast<int32_t>(block));
+        }
+    }
+}
+
+bool BlockCache::EndsBlock(const Operation operation)
+{
+    switch (operation) {
+    case Operation::BEQ:
+    case Operation::BNE:
+    case Operation::BLT:
+    case Operation::BGE:
+    case Operation::BLTU:
+    case Operation::BGEU:
+    case Operation::JAL:
+    case Operation::JALR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void BlockCache::FindExtent(Block& block) const
+{
+    block.last = block.start;
+    block.length = 1;
+    while (!EndsBlock(m_ops[block.last].instruction.operation)) {
+        const uint32_t next = block.last + m_ops[block.last].instruction.size / INSTRUCTION_ALIGNMENT;
+        if (next >= m_blockIndex.size()) {
+            break;
+        }
+        block.last = next;
+        block.length++;
+    }
+}
+
+void BlockCache::Retranslate(const int32_t block)
+{
+    Block& info = m_blocks[block];
+    FindExtent(info);
+    info.taken = -1;
+    info.fallthrough = -1;
+}
+
+int32_t BlockCache::GetBlock(const uint32_t index)
+{
+    if (m_blockIndex[index] >= 0) {
+        return m_blockIndex[index];
+    }
+
+    Block info{index, index, 0, -1, -1};
+    FindExtent(info);
+    m_blocks.push_back(info);
+    m_blockIndex[index] = static_cast<int32_t>(m_blocks.size() - 1);
+    return m_blockIndex[index];
+}
+
+int32_t BlockCache::GetSuccessor(const int32_t block, const ThreadedContext& context, const ThreadedOp* op)
+{
+    const uint32_t index = static_cast<uint32_t>(op - context.base);
+    const uint32_t terminator = m_blocks[block].last;
+
+    if (index == terminator + m_ops[terminator].instruction.size / INSTRUCTION_ALIGNMENT) {
+        if (m_blocks[block].fallthrough < 0) {
+            const int32_t successor = GetBlock(index);
+            m_blocks[block].fallthrough = successor;
+        }
+        return m_blocks[block].fallthrough;
+    }
+    if (op == m_ops[terminator].next) {
+        if (m_blocks[block].taken < 0) {
+            const int32_t successor = GetBlock(index);
+            m_blocks[block].taken = successor;
+        }
+        return m_blocks[block].taken;
+    }
+    // target of JALR is only known at runtime
+    return GetBlock(index);
+}
@@ -0,0 +1,51 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+#include <cstdint>
+#include <vector>
+
+#include "ThreadedInterpreter.h"
+
+using std::vector;
+
+// Straight-line run of instructions ending with a branch or jump
+struct Block
+{
+    // op of the first instruction
+    uint32_t start;
+    // op of the terminating branch or jump, or of the instruction before the end of the program
+    uint32_t last;
+    // number of instructions including the terminating branch or jump
+    uint32_t length;
+    // successors once they have been looked up, -1 until then
+    int32_t taken;
+    int32_t fallthrough;
+};
+
+// Threaded interpreter that executes whole blocks per dispatch and chains them
+// together, so pc and instruction count are only updated once per block.
+// A change to the code translates the blocks holding it again in place, so the links to them stay valid
+class BlockCache : public ThreadedInterpreter
+{
+public:
+    explicit BlockCache(CPU* cpu);
+    void Load() override;
+    RunResult Run(uint64_t maxInstructions) override;
+
+protected:
+    // Executes the block starting at op, returns the op to continue with
+    virtual const ThreadedOp* ExecuteBlock(int32_t block, ThreadedContext& context, const ThreadedOp* op);
+    void Invalidate(uint32_t first, uint32_t last) override;
+    static bool EndsBlock(Operation operation);
+    // the last op and the length of a block starting at its start
+    void FindExtent(Block& block) const;
+    // finds the extent of the block again and drops its successors
+    virtual void Retranslate(int32_t block);
+    int32_t GetBlock(uint32_t index);
+    int32_t GetSuccessor(int32_t block, const ThreadedContext& context, const ThreadedOp* op);
+
+    vector<Block> m_blocks;
+    // block starting at each instruction, -1 if it has not been translated yet
+    vector<int32_t> m_blockIndex;
+};
+
+#endif // BLOCKCACHE_H
@@ -1,576 +1,624 @@
-#include <map>
-
 #include "CPU.h"
+#include "BitManipulation.h"
+#include "MultiplyDivide.h"
 #include "Opcodes.h"
 
-using std::map;
 
+CPU::CPU(Memory* memory) :
+    m_programBegin(0), m_programEnd(0), m_codeChangeBegin(UINT64_MAX), m_codeChangeEnd(0), m_memory(memory) {}
+
+CPU::~CPU() = default;
+
+void CPU::LoadInstructions(const std::vector<uint32_t>& instructions)
+{
+    m_memory->WriteRange(0, span(reinterpret_cast<const uint8_t*>(instructions.data()),
+                                 instructions.size() * sizeof(uint32_t)));
+    SetProgramRange(0, instructions.size() * sizeof(uint32_t));
+}
+
+void CPU::SetProgramRange(const uint32_t begin, const uint64_t end)
+{
+    m_programBegin = begin;
+    m_programEnd = std::max<uint64_t>(begin, end);
+    m_memory->SetCodeRange(m_programBegin, m_programEnd);
+    m_program.resize((m_programEnd - m_programBegin + INSTRUCTION_ALIGNMENT - 1) / INSTRUCTION_ALIGNMENT);
+    for (size_t i = 0; i < m_program.size(); i++) {
+        m_program[i] = Decode(static_cast<uint32_t>(m_programBegin + i * INSTRUCTION_ALIGNMENT));
+    }
+    m_codeChangeBegin = UINT64_MAX;
+    m_codeChangeEnd = 0;
+}
+
+uint32_t CPU::GetProgramBegin() const { return m_programBegin; }
+
+uint64_t CPU::GetProgramEnd() const { return m_programEnd; }
+
+bool CPU::CollectCodeChanges(uint64_t& begin, uint64_t& end)
+{
+    SyncCode();
+    if (m_codeChangeBegin >= m_codeChangeEnd) {
+        return false;
+    }
+    begin = m_codeChangeBegin;
+    end = m_codeChangeEnd;
+    m_codeChangeBegin = UINT64_MAX;
+    m_codeChangeEnd = 0;
+    return true;
+}
+
+bool CPU::IsInProgram(const uint32_t pc) const { return pc >= m_programBegin && pc < m_programEnd; }
+
+DecodedInstruction CPU::Fetch(const uint32_t pc) const
+{
+    if (m_memory->HasCodeChanges()) {
+        SyncCode();
+    }
+    return m_program[(pc - m_programBegin) / INSTRUCTION_ALIGNMENT];
+}
+
+DecodedInstruction CPU::Decode(const uint32_t pc) const
+{
+    // outside the memory reads as 0, which does not decode
+    uint32_t word = 0;
+    m_memory->Fetch(pc, word);
+    DecodedInstruction instruction = Decoder::Decode(word, pc);
+    if (static_cast<uint64_t>(pc) + instruction.size > m_programEnd) {
+        // the rest of it is not part of the program
+        instruction.operation = Operation::UNSUPPORTED;
+    }
+    return instruction;
+}
+
+void CPU::SyncCode() const
+{
+    uint64_t begin;
+    uint64_t end;
+    if (!m_memory->CollectCodeChanges(begin, end)) {
+        return;
+    }
+    m_codeChangeBegin = std::min(m_codeChangeBegin, begin);
+    m_codeChangeEnd = std::max(m_codeChangeEnd, end);
+    // the memory only reports changes inside the program, an instruction starting in front of one may reach into it
+    const uint64_t first = std::max<uint64_t>((begin - m_programBegin) / INSTRUCTION_ALIGNMENT, 1) - 1;
+    const uint64_t last = (end - m_programBegin + INSTRUCTION_ALIGNMENT - 1) / INSTRUCTION_ALIGNMENT;
+    for (uint64_t i = first; i < std::min<uint64_t>(last, m_program.size()); i++) {
+        m_program[i] = Decode(static_cast<uint32_t>(m_programBegin + i * INSTRUCTION_ALIGNMENT));
+    }
+}
+
+void CPU::Reset() { m_registers.Reset(); }
 
-CPU::CPU(Memory* memory) : m_memory(memory) { m_registers = new Registers(); }
+HartState CPU::GetState() const { return m_registers.GetState(); }
 
-CPU::~CPU() { delete m_registers; }
+void CPU::SetState(const HartState& state) { m_registers.SetState(state); }
 
-void CPU::LoadInstructions(const std::vector<uint32_t>& instructions) { this->m_instructions = instructions; }
+bool CPU::GetPendingStore(uint32_t& address, uint8_t& width) const
+{
+    const uint32_t pc = m_registers.GetPC();
+    if (!IsInProgram(pc)) {
+        return false;
+    }
 
-void CPU::Reset() const { m_registers->Reset(); }
+    const DecodedInstruction instruction = Fetch(pc);
+    switch (instruction.operation) {
+    case Operation::SB:
+        width = 1;
+        break;
+    case Operation::SH:
+        width = 2;
+        break;
+    case Operation::SW:
+        width = 4;
+        break;
+    default:
+        return false;
+    }
+    address = m_registers.GetRegister(instruction.rs1) + instruction.imm;
+    return true;
+}
 
 CpuStatus CPU::GetStatus() const
 {
-    CpuStatus status;
-    status.registers = m_registers->GetRegisters();
-    status.pc = m_registers->GetPC();
-    return status;
+    return {m_registers.GetRegisters(), m_registers.GetPC(), m_registers.GetRetired()};
 }
 
-ExecutionResult CPU::Step() const
+ExecutionResult CPU::Step()
 {
-    const uint32_t pc = m_registers->GetPC() / 4;
-    if (pc >= m_instructions.size()) {
+    const uint32_t pc = m_registers.GetPC();
+    if (!IsInProgram(pc)) {
         return CPUUtil::ExecutionErrorResult(ExecutionError::PC_OUT_OF_BOUNDS);
     }
 
-    const uint32_t instruction = m_instructions[pc];
-    ExecutionResult result = ExecuteInstruction(instruction);
+    ExecutionResult result = ExecuteInstruction(Fetch(pc));
     if (result.error != ExecutionError::NONE) {
-        result.errorInstruction = pc + 1;
+        result.errorPc = pc;
         Reset();
     }
-    result.pc = m_registers->GetPC();
+    else {
+        m_registers.AddRetired(1);
+    }
+    result.pc = m_registers.GetPC();
     return result;
 }
 
-ExecutionResult CPU::ExecuteInstruction(const uint32_t instruction) const
+RunResult CPU::Run(const uint64_t maxInstructions)
+{
+    uint64_t executed = 0;
+    uint32_t pc = m_registers.GetPC();
+    while (IsInProgram(pc) && executed < maxInstructions) {
+        const ExecutionError error = ExecuteInstruction(Fetch(pc)).error;
+        if (error != ExecutionError::NONE) {
+            Reset();
+            return {executed, error, m_registers.GetPC(), pc, StopReason::INSTRUCTION_FAILED};
+        }
+        executed++;
+        pc = m_registers.GetPC();
+    }
+
+    m_registers.AddRetired(executed);
+    if (!IsInProgram(pc)) {
+        return {executed, ExecutionError::PC_OUT_OF_BOUNDS, m_registers.GetPC(), 0, StopReason::HALTED};
+    }
+    return {executed, ExecutionError::NONE, m_registers.GetPC(), 0, StopReason::LIMIT_REACHED};
+}
+
+ExecutionResult CPU::StoreResult(const uint32_t address) const
+{
+    // reported per word, the one holding the first stored byte
+    const uint32_t word = address & ~3u;
+    return {true, ExecutionError::NONE, true, {word, m_memory->Read(word)}};
+}
+
+ExecutionResult CPU::ExecuteInstruction(const DecodedInstruction& instruction)
 {
-    switch (CPUUtil::GetOpcode(instruction)) {
-    case R_Type:
+    const uint8_t rd = instruction.rd;
+    const uint8_t rs1 = instruction.rs1;
+    const uint8_t rs2 = instruction.rs2;
+    const int32_t imm = instruction.imm;
+
+    switch (instruction.operation) {
+    case Operation::ADD:
         {
-            const ExecutionResult result = ExecuteRType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) + m_registers.GetRegister(rs2));
+            break;
         }
-    case I_Type:
+    case Operation::SUB:
         {
-            const ExecutionResult result = ExecuteIType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) - m_registers.GetRegister(rs2));
+            break;
         }
-    case Load_Type:
+    case Operation::SLL:
         {
-            const ExecutionResult result = ExecuteLoadType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) << (m_registers.GetRegister(rs2) & 31));
+            break;
         }
-    case S_Type:
+    case Operation::SLT:
         {
-            const ExecutionResult result = ExecuteSType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd,
+                                     static_cast<int32_t>(m_registers.GetRegister(rs1)) <
+                                         static_cast<int32_t>(m_registers.GetRegister(rs2)));
+            break;
         }
-    case B_Type:
+    case Operation::SLTU:
         {
-            return ExecuteBType(instruction);
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) < m_registers.GetRegister(rs2));
+            break;
         }
-    case LUI_Type:
+    case Operation::XOR:
         {
-            const ExecutionResult result = ExecuteLUIType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) ^ m_registers.GetRegister(rs2));
+            break;
         }
-    case AUIPC_Type:
+    case Operation::SRL:
         {
-            const ExecutionResult result = ExecuteAUIPCType(instruction);
-            m_registers->IncrementPC();
-            return result;
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) >> (m_registers.GetRegister(rs2) & 31));
+            break;
         }
-    case JAL_Type:
+    case Operation::SRA:
         {
-            return ExecuteJALType(instruction);
+            m_registers.SetRegister(rd, static_cast<int32_t>(m_registers.GetRegister(rs1)) >>
+                                        (m_registers.GetRegister(rs2) & 31));
+            break;
         }
-    case JALR_Type:
+    case Operation::OR:
         {
-            return ExecuteJALRType(instruction);
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) | m_registers.GetRegister(rs2));
+            break;
         }
-    default:
+    case Operation::AND:
         {
-            return {false, ExecutionError::UNSUPPORTED_OPCODE, false, {0, 0}, false, {0, 0}, 0};
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) & m_registers.GetRegister(rs2));
+            break;
         }
-    }
-}
-
-ExecutionResult CPU::ExecuteRType(const uint32_t instruction) const
-{
-    const uint8_t funct7 = CPUUtil::GetFunct7(instruction);
-    const uint8_t funct3 = CPUUtil::GetFunct3(instruction);
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    const uint8_t rs2 = CPUUtil::GetRS2(instruction);
-    if (!CPUUtil::IsValidRegister(rd) || !CPUUtil::IsValidRegister(rs1) || !CPUUtil::IsValidRegister(rs2)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-
-    if (funct7 == 0x1) {
-        return ExecuteMExtension(funct3, rd, rs1, rs2);
-    }
-
-    if (funct7 == 0x2) {
-        if (funct3 == SUB) {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) - m_registers->GetRegister(rs2));
+    case Operation::ADDI:
+        {
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) + imm);
+            break;
         }
-        else if (funct3 == SRA) {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) >> m_registers->GetRegister(rs2));
+    case Operation::SLTI:
+        {
+            m_registers.SetRegister(rd, static_cast<int32_t>(m_registers.GetRegister(rs1)) < imm);
+            break;
         }
-        else {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+    case Operation::SLTIU:
+        {
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) < static_cast<uint32_t>(imm));
+            break;
         }
-        return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}, 0};
-    }
-
-    switch (funct3) {
-    case ADD:
+    case Operation::XORI:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) + m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) ^ imm);
             break;
         }
-    case SLL:
+    case Operation::ORI:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) << m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) | imm);
             break;
         }
-    case SLT:
+    case Operation::ANDI:
         {
-            m_registers->SetRegister(rd,
-                                     static_cast<int32_t>(m_registers->GetRegister(rs1)) <
-                                         static_cast<int32_t>(m_registers->GetRegister(rs2)));
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) & imm);
             break;
         }
-    case SLTU:
+    case Operation::SLLI:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) < m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) << imm);
             break;
         }
-    case XOR:
+    case Operation::SRLI:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) ^ m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, m_registers.GetRegister(rs1) >> imm);
             break;
         }
-    case SRL:
+    case Operation::SRAI:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) >> m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, static_cast<int32_t>(m_registers.GetRegister(rs1)) >> imm);
             break;
         }
-    case OR:
+    case Operation::LB:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) | m_registers->GetRegister(rs2));
+            int8_t value;
+            if (!m_memory->Load(m_registers.GetRegister(rs1) + imm, value)) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.SetRegister(rd, static_cast<int32_t>(value));
             break;
         }
-    case AND:
+    case Operation::LH:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) & m_registers->GetRegister(rs2));
+            int16_t value;
+            if (!m_memory->Load(m_registers.GetRegister(rs1) + imm, value)) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.SetRegister(rd, static_cast<int32_t>(value));
             break;
         }
-    default:
+    case Operation::LW:
         {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+            uint32_t value;
+            if (!m_memory->Load(m_registers.GetRegister(rs1) + imm, value)) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.SetRegister(rd, value);
+            break;
         }
-    }
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}, 0};
-}
-
-ExecutionResult CPU::ExecuteIType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    if (!CPUUtil::IsValidRegister(rd) || !CPUUtil::IsValidRegister(rs1)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const int16_t immediate12 = CPUUtil::GetImm12(instruction);
-    const uint8_t immediate5 = CPUUtil::GetImm5(instruction);
-
-    switch (CPUUtil::GetFunct3(instruction)) {
-    case ADDI:
+    case Operation::LBU:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) + immediate12);
+            uint8_t value;
+            if (!m_memory->Load(m_registers.GetRegister(rs1) + imm, value)) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.SetRegister(rd, value);
             break;
         }
-    case SLTI:
+    case Operation::LHU:
         {
-            m_registers->SetRegister(rd, static_cast<int32_t>(m_registers->GetRegister(rs1)) < immediate12);
+            uint16_t value;
+            if (!m_memory->Load(m_registers.GetRegister(rs1) + imm, value)) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.SetRegister(rd, value);
             break;
         }
-    case SLTIU:
+    case Operation::SB:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) < static_cast<uint32_t>(immediate12));
+            const uint32_t address = m_registers.GetRegister(rs1) + imm;
+            if (!m_memory->Store(address, static_cast<uint8_t>(m_registers.GetRegister(rs2)))) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.IncrementPC(instruction.size);
+            return StoreResult(address);
+        }
+    case Operation::SH:
+        {
+            const uint32_t address = m_registers.GetRegister(rs1) + imm;
+            if (!m_memory->Store(address, static_cast<uint16_t>(m_registers.GetRegister(rs2)))) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.IncrementPC(instruction.size);
+            return StoreResult(address);
+        }
+    case Operation::SW:
+        {
+            const uint32_t address = m_registers.GetRegister(rs1) + imm;
+            if (!m_memory->Store(address, static_cast<uint32_t>(m_registers.GetRegister(rs2)))) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
+            }
+            m_registers.IncrementPC(instruction.size);
+            return StoreResult(address);
+        }
+    case Operation::BEQ:
+        {
+            if (m_registers.GetRegister(rs1) == m_registers.GetRegister(rs2)) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::BNE:
+        {
+            if (m_registers.GetRegister(rs1) != m_registers.GetRegister(rs2)) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::BLT:
+        {
+            if (static_cast<int32_t>(m_registers.GetRegister(rs1)) <
+                static_cast<int32_t>(m_registers.GetRegister(rs2))) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::BGE:
+        {
+            if (static_cast<int32_t>(m_registers.GetRegister(rs1)) >=
+                static_cast<int32_t>(m_registers.GetRegister(rs2))) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::BLTU:
+        {
+            if (m_registers.GetRegister(rs1) < m_registers.GetRegister(rs2)) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::BGEU:
+        {
+            if (m_registers.GetRegister(rs1) >= m_registers.GetRegister(rs2)) {
+                m_registers.SetPC(instruction.target);
+            }
+            else {
+                m_registers.IncrementPC(instruction.size);
+            }
+            return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+        }
+    case Operation::JAL:
+        {
+            m_registers.SetRegister(rd, m_registers.GetPC() + instruction.size);
+            m_registers.SetPC(instruction.target);
+            return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers.GetRegister(rd)}};
+        }
+    case Operation::JALR:
+        {
+            // the lowest bit is dropped, any other target is aligned to INSTRUCTION_ALIGNMENT. Read before rd is
+            // written, which can be rs1
+            const uint32_t target = (m_registers.GetRegister(rs1) + imm) & ~1u;
+            m_registers.SetRegister(rd, m_registers.GetPC() + instruction.size);
+            m_registers.SetPC(target);
+            return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers.GetRegister(rd)}};
+        }
+    case Operation::LUI:
+        {
+            m_registers.SetRegister(rd, imm);
             break;
         }
-    case XORI:
+    case Operation::AUIPC:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) ^ immediate12);
+            m_registers.SetRegister(rd, instruction.target);
             break;
         }
-    case ORI:
+    case Operation::MUL:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) | immediate12);
+            m_registers.SetRegister(
+                rd, MultiplyDivide::Mul(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case ANDI:
+    case Operation::MULH:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) & immediate12);
+            m_registers.SetRegister(
+                rd, MultiplyDivide::MulHigh(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case SLLI:
+    case Operation::MULHSU:
         {
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) << immediate5);
+            m_registers.SetRegister(
+                rd, MultiplyDivide::MulHighSignedUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case SRLI_SRAI:
+    case Operation::MULHU:
         {
-            // bit 30 determines if it's SRLI or SRAI
-            if (instruction & (1 << 30)) {
-                // SRAI
-                m_registers->SetRegister(rd, static_cast<int32_t>(m_registers->GetRegister(rs1)) >> immediate5);
-            }
-            else {
-                // SRLI
-                m_registers->SetRegister(rd, m_registers->GetRegister(rs1) >> immediate5);
-            }
+            m_registers.SetRegister(
+                rd, MultiplyDivide::MulHighUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    default:
+    case Operation::DIV:
         {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+            if (m_registers.GetRegister(rs2) == 0) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
+            }
+            m_registers.SetRegister(
+                rd, MultiplyDivide::Div(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
+            break;
         }
-    }
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}, 0};
-}
-
-ExecutionResult CPU::ExecuteLoadType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    if (!CPUUtil::IsValidRegister(rd) || !CPUUtil::IsValidRegister(rs1)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const int32_t immediate12 = CPUUtil::GetImm12(instruction);
-    const uint32_t address = m_registers->GetRegister(rs1) + immediate12;
-    if (m_memory->GetSize() <= address) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
-    }
-
-    switch (CPUUtil::GetFunct3(instruction)) {
-    case LB:
+    case Operation::DIVU:
         {
-            const int32_t value = static_cast<int8_t>(m_memory->ReadByte(address));
-            m_registers->SetRegister(rd, value);
+            if (m_registers.GetRegister(rs2) == 0) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
+            }
+            m_registers.SetRegister(
+                rd, MultiplyDivide::DivUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
+        }
+    case Operation::REM:
+        {
+            if (m_registers.GetRegister(rs2) == 0) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
+            }
+            m_registers.SetRegister(
+                rd, MultiplyDivide::Rem(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case LH:
+    case Operation::REMU:
         {
-            const int32_t value = static_cast<int16_t>(m_memory->ReadHalfWord(address));
-            m_registers->SetRegister(rd, value);
+            if (m_registers.GetRegister(rs2) == 0) {
+                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
+            }
+            m_registers.SetRegister(
+                rd, MultiplyDivide::RemUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case LW:
+    case Operation::SH1ADD:
         {
-            const uint32_t value = m_memory->ReadHalfWord(address);
-            m_registers->SetRegister(rd, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::ShiftAdd<1>(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case LBU:
+    case Operation::SH2ADD:
         {
-            const uint32_t value = m_memory->ReadByte(address);
-            m_registers->SetRegister(rd, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::ShiftAdd<2>(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case LHU:
+    case Operation::SH3ADD:
         {
-            const uint32_t value = m_memory->ReadHalfWord(address);
-            m_registers->SetRegister(rd, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::ShiftAdd<3>(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    default:
+    case Operation::ANDN:
         {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+            m_registers.SetRegister(
+                rd, BitManipulation::AndNot(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
+            break;
         }
-    }
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}};
-}
-
-ExecutionResult CPU::ExecuteSType(const uint32_t instruction) const
-{
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    const uint8_t rs2 = CPUUtil::GetRS2(instruction);
-    if (!CPUUtil::IsValidRegister(rs1) || !CPUUtil::IsValidRegister(rs2)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const uint16_t upperImm = CPUUtil::GetFunct7(instruction);
-    const uint16_t lowerImm = CPUUtil::GetRD(instruction);
-    const uint16_t imm = upperImm << 5 | lowerImm;
-    const uint32_t address = m_registers->GetRegister(rs1) + imm;
-    if (m_memory->GetSize() <= address) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_MEMORY_ACCESS);
-    }
-
-    switch (CPUUtil::GetFunct3(instruction)) {
-    case SB:
+    case Operation::ORN:
         {
-            const uint8_t value = m_registers->GetRegister(rs2);
-            m_memory->Write(address, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::OrNot(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case SH:
+    case Operation::XNOR:
         {
-            const uint16_t value = m_registers->GetRegister(rs2);
-            m_memory->Write(address, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::XorNot(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case SW:
+    case Operation::MIN:
         {
-            const uint32_t value = m_registers->GetRegister(rs2);
-            m_memory->Write(address, value);
+            m_registers.SetRegister(
+                rd, BitManipulation::Min(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    default:
+    case Operation::MINU:
         {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+            m_registers.SetRegister(
+                rd, BitManipulation::MinUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
+            break;
         }
-    }
-    return {true, ExecutionError::NONE, true, {address, m_memory->Read(address)}};
-}
-
-ExecutionResult CPU::ExecuteBType(const uint32_t instruction) const
-{
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    const uint8_t rs2 = CPUUtil::GetRS2(instruction);
-    if (!CPUUtil::IsValidRegister(rs1) || !CPUUtil::IsValidRegister(rs2)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const uint32_t imm12 = instruction >> 31;
-    const uint32_t imm10To5 = instruction >> 25 & 0b111111;
-    const uint32_t imm4To1 = instruction >> 8 & 0b1111;
-    const uint32_t imm11 = instruction >> 7 & 0b1;
-
-    int32_t imm = imm12 << 12 | imm11 << 11 | imm10To5 << 5 | imm4To1 << 1 | 0;
-    if (imm >> 12) {
-        imm |= 0xFFFFE000;
-    }
-    if (imm % 4 != 0) {
-        // RISC-V instructions are 4-byte aligned
-        return CPUUtil::ExecutionErrorResult(ExecutionError::OFFSET_NOT_32_BIT_ALIGNED);
-    }
-
-    const uint32_t val1 = m_registers->GetRegister(rs1);
-    const uint32_t val2 = m_registers->GetRegister(rs2);
-    const uint32_t pc = m_registers->GetPC();
-
-    switch (CPUUtil::GetFunct3(instruction)) {
-    case BEQ:
+    case Operation::MAX:
         {
-            if (val1 == val2) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(
+                rd, BitManipulation::Max(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case BNE:
+    case Operation::MAXU:
         {
-            if (val1 != val2) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(
+                rd, BitManipulation::MaxUnsigned(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case BLT:
+    case Operation::ROL:
         {
-            if (static_cast<int32_t>(val1) < static_cast<int32_t>(val2)) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(
+                rd, BitManipulation::RotateLeft(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case BGE:
+    case Operation::ROR:
         {
-            if (static_cast<int32_t>(val1) >= static_cast<int32_t>(val2)) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(
+                rd, BitManipulation::RotateRight(m_registers.GetRegister(rs1), m_registers.GetRegister(rs2)));
             break;
         }
-    case BLTU:
+    case Operation::RORI:
         {
-            if (val1 < val2) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(rd, BitManipulation::RotateRight(m_registers.GetRegister(rs1), imm));
             break;
         }
-    case BGEU:
+    case Operation::CLZ:
         {
-            if (val1 >= val2) {
-                m_registers->SetPC(pc + imm);
-            }
-            else {
-                m_registers->IncrementPC();
-            }
+            m_registers.SetRegister(rd, BitManipulation::CountLeadingZeros(m_registers.GetRegister(rs1)));
             break;
         }
-    default:
+    case Operation::CTZ:
         {
-            return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
+            m_registers.SetRegister(rd, BitManipulation::CountTrailingZeros(m_registers.GetRegister(rs1)));
+            break;
         }
-    }
-    return {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
-}
-
-ExecutionResult CPU::ExecuteJALType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    if (!CPUUtil::IsValidRegister(rd)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const uint32_t imm20 = instruction >> 31;
-    const uint32_t imm10To1 = instruction >> 21 & 0b1111111111;
-    const uint32_t imm11 = instruction >> 20 & 0b1;
-    const uint32_t imm19To12 = instruction >> 12 & 0b11111111;
-    int32_t imm = static_cast<int32_t>(0 | imm10To1 << 1 | imm11 << 11 | imm19To12 << 12 | imm20 << 20);
-    // Sign-extend the immediate to 32 bits
-    if (imm20) { // If the sign bit is set, extend it
-        imm |= 0xFFF00000;
-    }
-
-    if (imm % 4 != 0) {
-        // RISC-V instructions are 4-byte aligned
-        return CPUUtil::ExecutionErrorResult(ExecutionError::OFFSET_NOT_32_BIT_ALIGNED);
-    }
-
-    const uint32_t pc = m_registers->GetPC();
-    m_registers->SetRegister(rd, pc + 4);
-    m_registers->SetPC(pc + imm);
-
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}};
-}
-
-ExecutionResult CPU::ExecuteJALRType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    const uint8_t rs1 = CPUUtil::GetRS1(instruction);
-    if (!CPUUtil::IsValidRegister(rd) || !CPUUtil::IsValidRegister(rs1)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const uint32_t pc = m_registers->GetPC();
-    const int16_t imm = CPUUtil::GetImm12(instruction);
-    if (imm % 4 != 0) {
-        // RISC-V instructions are 4-byte aligned
-        return CPUUtil::ExecutionErrorResult(ExecutionError::OFFSET_NOT_32_BIT_ALIGNED);
-    }
-
-    m_registers->SetRegister(rd, pc + 4);
-    m_registers->SetPC(m_registers->GetRegister(rs1) + imm);
-
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}};
-}
-
-ExecutionResult CPU::ExecuteLUIType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    if (!CPUUtil::IsValidRegister(rd)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const int32_t imm = static_cast<int32_t>(CPUUtil::GetImm20(instruction));
-    m_registers->SetRegister(rd, imm << 12);
-
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}};
-}
-
-ExecutionResult CPU::ExecuteAUIPCType(const uint32_t instruction) const
-{
-    const uint8_t rd = CPUUtil::GetRD(instruction);
-    if (!CPUUtil::IsValidRegister(rd)) {
-        return CPUUtil::ExecutionErrorResult(ExecutionError::INVALID_REGISTER);
-    }
-    const int32_t imm = static_cast<int32_t>(CPUUtil::GetImm20(instruction));
-    m_registers->SetRegister(rd, m_registers->GetPC() + (imm << 12));
-
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}};
-}
-
-
-ExecutionResult CPU::ExecuteMExtension(const uint8_t funct3, const uint8_t rd, const uint8_t rs1,
-                                       const uint8_t rs2) const
-{
-    switch (funct3) {
-    case MUL: // signed x signed
+    case Operation::CPOP:
         {
-            const int64_t result = static_cast<int64_t>(m_registers->GetRegister(rs1)) *
-                static_cast<int64_t>(m_registers->GetRegister(rs2));
-            m_registers->SetRegister(rd, static_cast<uint32_t>(result & 0xFFFFFFFF)); // lower 32 bits
+            m_registers.SetRegister(rd, BitManipulation::PopCount(m_registers.GetRegister(rs1)));
             break;
         }
-    case MULH: // signed x signed
+    case Operation::SEXT_B:
         {
-            const int64_t result = static_cast<int64_t>(m_registers->GetRegister(rs1)) *
-                static_cast<int64_t>(m_registers->GetRegister(rs2));
-            m_registers->SetRegister(rd, static_cast<uint32_t>(result >> 32) & 0xFFFFFFFF); // upper 32 bits
+            m_registers.SetRegister(rd, BitManipulation::SignExtendByte(m_registers.GetRegister(rs1)));
             break;
         }
-    case MULHSU: // signed x unsigned
+    case Operation::SEXT_H:
         {
-            const int64_t result = static_cast<int64_t>(static_cast<int64_t>(m_registers->GetRegister(rs1)) *
-                                                        static_cast<uint64_t>(m_registers->GetRegister(rs2)));
-            m_registers->SetRegister(rd, static_cast<uint32_t>(result >> 32) & 0xFFFFFFFF); // upper 32 bits
+            m_registers.SetRegister(rd, BitManipulation::SignExtendHalf(m_registers.GetRegister(rs1)));
             break;
         }
-    case MULHU: // unsigned x unsigned
+    case Operation::ZEXT_H:
         {
-            const uint64_t result = static_cast<uint64_t>(m_registers->GetRegister(rs1)) *
-                static_cast<uint64_t>(m_registers->GetRegister(rs2));
-            m_registers->SetRegister(rd, static_cast<uint32_t>(result >> 32) & 0xFFFFFFFF); // upper 32 bits
+            m_registers.SetRegister(rd, BitManipulation::ZeroExtendHalf(m_registers.GetRegister(rs1)));
             break;
         }
-    case DIV: // signed / signed
+    case Operation::ORC_B:
         {
-            if (m_registers->GetRegister(rs2) == 0) {
-                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
-            }
-            m_registers->SetRegister(rd,
-                                     static_cast<uint32_t>(static_cast<int32_t>(m_registers->GetRegister(rs1)) /
-                                                           static_cast<int32_t>(m_registers->GetRegister(rs2))));
+            m_registers.SetRegister(rd, BitManipulation::OrCombineBytes(m_registers.GetRegister(rs1)));
             break;
         }
-    case DIVU: // unsigned / unsigned
+    case Operation::REV8:
         {
-            if (m_registers->GetRegister(rs2) == 0) {
-                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
-            }
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) / m_registers->GetRegister(rs2));
+            m_registers.SetRegister(rd, BitManipulation::ReverseBytes(m_registers.GetRegister(rs1)));
             break;
         }
-    case REM: // signed % signed
+    case Operation::FENCE:
         {
-            if (m_registers->GetRegister(rs2) == 0) {
-                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
-            }
-            m_registers->SetRegister(rd,
-                                     static_cast<uint32_t>(static_cast<int32_t>(m_registers->GetRegister(rs1)) %
-                                                           static_cast<int32_t>(m_registers->GetRegister(rs2))));
             break;
         }
-    case REMU: // unsigned % unsigned
+    case Operation::FENCE_I:
         {
-            if (m_registers->GetRegister(rs2) == 0) {
-                return CPUUtil::ExecutionErrorResult(ExecutionError::DIVISION_BY_ZERO);
-            }
-            m_registers->SetRegister(rd, m_registers->GetRegister(rs1) % m_registers->GetRegister(rs2));
+            // fetching goes to the memory anyway, this is for the engines that decode ahead
+            m_memory->InvalidateCode();
             break;
         }
     default:
@@ -578,8 +626,9 @@ ExecutionResult CPU::ExecuteMExtension(const uint8_t funct3, const uint8_t rd, c
             return CPUUtil::ExecutionErrorResult(ExecutionError::UNSUPPORTED_OPCODE);
         }
     }
-    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers->GetRegister(rd)}, 0};
+    m_registers.IncrementPC(instruction.size);
+    return {true, ExecutionError::NONE, false, {0, 0}, true, {rd, m_registers.GetRegister(rd)}, 0};
 }
 
 
-uint32_t CPU::GetPC() const { return m_registers->GetPC(); }
+uint32_t CPU::GetPC() const { return m_registers.GetPC(); }
@@ -5,6 +5,7 @@
 
 #include "../tests/lib/googletest/googletest/include/gtest/gtest_prod.h"
 #include "CPUUtil.h"
+#include "Decoder.h"
 #include "Memory.h"
 #include "Registers.h"
 
@@ -15,27 +16,52 @@ class CPU
 public:
     explicit CPU(Memory* memory);
     ~CPU();
+    // Writes the instructions to the memory from address 0 on, which has to hold them, and runs them from there
     void LoadInstructions(const std::vector<uint32_t>& instructions);
-    ExecutionResult Step() const;
-    void Reset() const;
+    // The program is the code in the memory in [begin, end), it ends once pc leaves it. Instructions are fetched
+    // from the memory, so loads see them and stores change them. Also tells the memory where the code is,
+    // see Memory::SetCodeRange
+    void SetProgramRange(uint32_t begin, uint64_t end);
+    uint32_t GetProgramBegin() const;
+    uint64_t GetProgramEnd() const;
+    // The code bytes changed since the previous call as one range covering all of them, [begin, end), after the
+    // decoded program has caught up with them. The CPU is the one collecting Memory::CollectCodeChanges, engines
+    // decoding the code on their own get them from here. False if there are none
+    bool CollectCodeChanges(uint64_t& begin, uint64_t& end);
+    ExecutionResult Step();
+    // Executes up to maxInstructions without reporting the changes of each one
+    RunResult Run(uint64_t maxInstructions);
+    void Reset();
     CpuStatus GetStatus() const;
+    HartState GetState() const;
+    void SetState(const HartState& state);
+    // where the instruction at pc stores to, false if it is not a store
+    bool GetPendingStore(uint32_t& address, uint8_t& width) const;
 
 private:
-    ExecutionResult ExecuteInstruction(uint32_t instruction) const;
-    ExecutionResult ExecuteRType(uint32_t instruction) const;
-    ExecutionResult ExecuteIType(uint32_t instruction) const;
-    ExecutionResult ExecuteLoadType(uint32_t instruction) const;
-    ExecutionResult ExecuteSType(uint32_t instruction) const;
-    ExecutionResult ExecuteBType(uint32_t instruction) const;
-    ExecutionResult ExecuteLUIType(uint32_t instruction) const;
-    ExecutionResult ExecuteAUIPCType(uint32_t instruction) const;
-    ExecutionResult ExecuteJALType(uint32_t instruction) const;
-    ExecutionResult ExecuteJALRType(uint32_t instruction) const;
-    ExecutionResult ExecuteMExtension(uint8_t funct3, uint8_t rd, uint8_t rs1, uint8_t rs2) const;
+    friend class ThreadedInterpreter;
+    friend class BlockCache;
+    friend class Jit;
+
+    bool IsInProgram(uint32_t pc) const;
+    // the decoded instruction at pc, which has to be inside the program
+    DecodedInstruction Fetch(uint32_t pc) const;
+    DecodedInstruction Decode(uint32_t pc) const;
+    // decodes the instructions the code changes in the memory reach again
+    void SyncCode() const;
+    ExecutionResult ExecuteInstruction(const DecodedInstruction& instruction);
+    ExecutionResult StoreResult(uint32_t address) const;
 
     uint32_t GetPC() const;
-    vector<uint32_t> m_instructions;
-    Registers* m_registers;
+    uint32_t m_programBegin;
+    uint64_t m_programEnd;
+    // one entry per INSTRUCTION_ALIGNMENT bytes of the program from m_programBegin on, kept up to date with the
+    // memory by SyncCode
+    mutable vector<DecodedInstruction> m_program;
+    // code changes SyncCode collected and CollectCodeChanges did not pass on yet
+    mutable uint64_t m_codeChangeBegin;
+    mutable uint64_t m_codeChangeEnd;
+    Registers m_registers;
     Memory* m_memory;
 };
 
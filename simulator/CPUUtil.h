@@ -1,19 +1,27 @@
 #ifndef CPUUTIL_H
 #define CPUUTIL_H
 #include <cstdint>
+#include <span>
+#include <string_view>
 #include <vector>
 
+using std::span;
 using std::vector;
 
 struct CpuStatus
 {
-    vector<uint32_t> registers;
+    // view of x0-x31, valid as long as the CPU is
+    span<const uint32_t, 32> registers;
     uint32_t pc;
+    // instructions retired since the last reset
+    uint64_t retired;
 };
 
 struct MemoryChange
 {
+    // aligned address of the word holding the first stored byte
     uint32_t address;
+    // value of that word after the store
     uint32_t value;
 };
 
@@ -33,9 +41,32 @@ enum class ExecutionError
     INVALID_MEMORY_ACCESS = 3,
     DIVISION_BY_ZERO = 4,
     PC_OUT_OF_BOUNDS = 5,
-    OFFSET_NOT_32_BIT_ALIGNED = 6
+    // one of the Simulator's ExecutionLimits has been used up
+    LIMIT_EXCEEDED = 7
 };
 
+constexpr std::string_view toString(const ExecutionError error)
+{
+    switch (error) {
+    case ExecutionError::NONE:
+        return "No error";
+    case ExecutionError::UNSUPPORTED_OPCODE:
+        return "Unsupported opcode";
+    case ExecutionError::INVALID_REGISTER:
+        return "Invalid register";
+    case ExecutionError::INVALID_MEMORY_ACCESS:
+        return "Invalid memory access";
+    case ExecutionError::DIVISION_BY_ZERO:
+        return "Division by zero";
+    case ExecutionError::PC_OUT_OF_BOUNDS:
+        return "PC out of bounds";
+    case ExecutionError::LIMIT_EXCEEDED:
+        return "Execution limit exceeded";
+    default:
+        return "Unknown error";
+    }
+}
+
 struct ExecutionResult
 {
     bool success;
@@ -45,7 +76,48 @@ struct ExecutionResult
     bool registerChanged;
     RegisterChange registerChange;
     uint32_t pc;
-    uint32_t errorInstruction;
+    // address of the failing instruction, 0 without an error
+    uint32_t errorPc;
+};
+
+enum class StopReason
+{
+    // the instruction budget is used up, or one of the simulator's limits with the error LIMIT_EXCEEDED
+    LIMIT_REACHED,
+    // pc left the program, which is how a program ends
+    HALTED,
+    // an instruction failed, the CPU has been reset
+    INSTRUCTION_FAILED,
+    // only reported by the batch coordinator, the worker process running the job died each time it was tried
+    WORKER_CRASHED
+};
+
+constexpr std::string_view toString(const StopReason reason)
+{
+    switch (reason) {
+    case StopReason::LIMIT_REACHED:
+        return "Limit reached";
+    case StopReason::HALTED:
+        return "Halted";
+    case StopReason::INSTRUCTION_FAILED:
+        return "Instruction failed";
+    case StopReason::WORKER_CRASHED:
+        return "Worker crashed";
+    default:
+        return "Unknown reason";
+    }
+}
+
+// Summary of running many instructions at once
+struct RunResult
+{
+    // retired instructions, the failing one is not counted
+    uint64_t instructions;
+    ExecutionError error;
+    uint32_t pc;
+    // address of the failing instruction, 0 without an error
+    uint32_t errorPc;
+    StopReason reason;
 };
 
 
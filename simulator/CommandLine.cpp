@@ -0,0 +1,12 @@
+#include "CommandLine.h"
+
+#include <charconv>
+
+bool CommandLine::ParseNumber(const std::string& text, uint64_t& value)
+{
+    const bool hex = text.starts_with("0x") || text.starts_with("0X");
+    const char* begin = text.data() + (hex ? 2 : 0);
+    const char* end = text.data() + text.size();
+    const auto [last, error] = std::from_chars(begin, end, value, hex ? 16 : 10);
+    return begin != end && error == std::errc() && last == end;
+}
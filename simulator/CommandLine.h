@@ -0,0 +1,14 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+#include <cstdint>
+#include <string>
+
+// Helpers for the arguments and input files of the command line tools
+class CommandLine
+{
+public:
+    // A decimal number or a hex one starting with 0x. False for anything else, including trailing characters
+    static bool ParseNumber(const std::string& text, uint64_t& value);
+};
+
+#endif // COMMANDLINE_H
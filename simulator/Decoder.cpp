@@ -0,0 +1,499 @@
+#include "Decoder.h"
+#include "CPUUtil.h"
+#include "Opcodes.h"
+
+static constexpr DecodedInstruction Unsupported = {Operation::UNSUPPORTED, 0, 0, 0, 0, 0};
+
+// bits hi to lo of a compressed instruction
+static uint32_t Bits(const uint16_t instruction, const int hi, const int lo)
+{
+    return instruction >> lo & ((1u << (hi - lo + 1)) - 1);
+}
+
+static int32_t SignExtend(const uint32_t value, const int bits)
+{
+    return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+}
+
+// the three bit register fields of compressed instructions only reach x8 to x15
+static uint8_t CompressedRegister(const uint16_t instruction, const int lo)
+{
+    return static_cast<uint8_t>(8 + Bits(instruction, lo + 2, lo));
+}
+
+vector<DecodedInstruction> Decoder::DecodeProgram(const vector<uint32_t>& instructions)
+{
+    const uint32_t size = static_cast<uint32_t>(instructions.size() * sizeof(uint32_t));
+    const auto* halves = reinterpret_cast<const uint16_t*>(instructions.data());
+    vector<DecodedInstruction> program;
+    program.reserve(size / INSTRUCTION_ALIGNMENT);
+    for (uint32_t i = 0; i < size / INSTRUCTION_ALIGNMENT; i++) {
+        const uint32_t high = (i + 1) * INSTRUCTION_ALIGNMENT < size ? halves[i + 1] : 0;
+        DecodedInstruction instruction = Decode(halves[i] | high << 16, i * INSTRUCTION_ALIGNMENT);
+        if (i * INSTRUCTION_ALIGNMENT + instruction.size > size) {
+            instruction.operation = Operation::UNSUPPORTED;
+        }
+        program.push_back(instruction);
+    }
+    return program;
+}
+
+bool Decoder::IsCompressed(const uint32_t instruction) { return (instruction & 0b11) != 0b11; }
+
+DecodedInstruction Decoder::Decode(const uint32_t instruction, const uint32_t address)
+{
+    if (IsCompressed(instruction)) {
+        return DecodeCompressed(static_cast<uint16_t>(instruction), address);
+    }
+    switch (CPUUtil::GetOpcode(instruction)) {
+    case R_Type:
+        return DecodeRType(instruction);
+    case I_Type:
+        return DecodeIType(instruction);
+    case Load_Type:
+        return DecodeLoadType(instruction);
+    case S_Type:
+        return DecodeSType(instruction);
+    case B_Type:
+        return DecodeBType(instruction, address);
+    case LUI_Type:
+        {
+            const int32_t imm = static_cast<int32_t>(CPUUtil::GetImm20(instruction));
+            return {Operation::LUI, CPUUtil::GetRD(instruction), 0, 0, imm << 12, 0};
+        }
+    case AUIPC_Type:
+        {
+            const int32_t imm = static_cast<int32_t>(CPUUtil::GetImm20(instruction));
+            return {Operation::AUIPC, CPUUtil::GetRD(instruction), 0, 0, imm << 12, address + (imm << 12)};
+        }
+    case JAL_Type:
+        return DecodeJALType(instruction, address);
+    case JALR_Type:
+        return DecodeJALRType(instruction);
+    case MISC_MEM_Type:
+        return DecodeMiscMemType(instruction);
+    default:
+        return Unsupported;
+    }
+}
+
+DecodedInstruction Decoder::DecodeRType(const uint32_t instruction)
+{
+    const uint8_t funct7 = CPUUtil::GetFunct7(instruction);
+    const uint8_t funct3 = CPUUtil::GetFunct3(instruction);
+    DecodedInstruction decoded = {Operation::UNSUPPORTED, CPUUtil::GetRD(instruction), CPUUtil::GetRS1(instruction),
+                                  CPUUtil::GetRS2(instruction), 0, 0};
+
+    switch (funct7) {
+    case 0:
+        {
+            static constexpr Operation base[] = {Operation::ADD, Operation::SLL, Operation::SLT, Operation::SLTU,
+                                                 Operation::XOR, Operation::SRL, Operation::OR,  Operation::AND};
+            decoded.operation = base[funct3];
+            return decoded;
+        }
+    case M_Funct7:
+        {
+            static constexpr Operation mExtension[] = {Operation::MUL, Operation::MULH, Operation::MULHSU,
+                                                       Operation::MULHU, Operation::DIV, Operation::DIVU,
+                                                       Operation::REM, Operation::REMU};
+            decoded.operation = mExtension[funct3];
+            return decoded;
+        }
+    case ALTERNATE_Funct7:
+        switch (funct3) {
+        case SUB:
+            decoded.operation = Operation::SUB;
+            return decoded;
+        case SRA:
+            decoded.operation = Operation::SRA;
+            return decoded;
+        case XNOR:
+            decoded.operation = Operation::XNOR;
+            return decoded;
+        case ORN:
+            decoded.operation = Operation::ORN;
+            return decoded;
+        case ANDN:
+            decoded.operation = Operation::ANDN;
+            return decoded;
+        default:
+            return Unsupported;
+        }
+    case SHIFT_ADD_Funct7:
+        switch (funct3) {
+        case SH1ADD:
+            decoded.operation = Operation::SH1ADD;
+            return decoded;
+        case SH2ADD:
+            decoded.operation = Operation::SH2ADD;
+            return decoded;
+        case SH3ADD:
+            decoded.operation = Operation::SH3ADD;
+            return decoded;
+        default:
+            return Unsupported;
+        }
+    case MIN_MAX_Funct7:
+        {
+            static constexpr Operation minMax[] = {Operation::MIN, Operation::MINU, Operation::MAX, Operation::MAXU};
+            if (funct3 < MINIMUM) {
+                return Unsupported;
+            }
+            decoded.operation = minMax[funct3 - MINIMUM];
+            return decoded;
+        }
+    case ROTATE_Funct7:
+        if (funct3 != ROL && funct3 != ROR) {
+            return Unsupported;
+        }
+        decoded.operation = funct3 == ROL ? Operation::ROL : Operation::ROR;
+        return decoded;
+    case ZEXT_H_Funct7:
+        // encoded like a register instruction with rs2 = 0
+        if (funct3 != ZEXT_H || decoded.rs2 != 0) {
+            return Unsupported;
+        }
+        decoded.operation = Operation::ZEXT_H;
+        return decoded;
+    default:
+        return Unsupported;
+    }
+}
+
+DecodedInstruction Decoder::DecodeIType(const uint32_t instruction)
+{
+    DecodedInstruction decoded = {Operation::UNSUPPORTED, CPUUtil::GetRD(instruction), CPUUtil::GetRS1(instruction), 0,
+                                  CPUUtil::GetImm12(instruction), 0};
+    const uint16_t function = static_cast<uint16_t>(instruction >> 20);
+
+    switch (CPUUtil::GetFunct3(instruction)) {
+    case ADDI:
+        decoded.operation = Operation::ADDI;
+        break;
+    case SLTI:
+        decoded.operation = Operation::SLTI;
+        break;
+    case SLTIU:
+        decoded.operation = Operation::SLTIU;
+        break;
+    case XORI:
+        decoded.operation = Operation::XORI;
+        break;
+    case ORI:
+        decoded.operation = Operation::ORI;
+        break;
+    case ANDI:
+        decoded.operation = Operation::ANDI;
+        break;
+    case SLLI:
+        if (CPUUtil::GetFunct7(instruction) == ROTATE_Funct7) {
+            static constexpr Operation unary[] = {Operation::CLZ,         Operation::CTZ,    Operation::CPOP,
+                                                  Operation::UNSUPPORTED, Operation::SEXT_B, Operation::SEXT_H};
+            if (function > SEXT_H || unary[function - CLZ] == Operation::UNSUPPORTED) {
+                return Unsupported;
+            }
+            decoded.operation = unary[function - CLZ];
+            decoded.imm = 0;
+            break;
+        }
+        if (CPUUtil::GetFunct7(instruction) != 0) {
+            return Unsupported;
+        }
+        decoded.operation = Operation::SLLI;
+        decoded.imm = CPUUtil::GetImm5(instruction);
+        break;
+    case SRLI_SRAI:
+        if (function == ORC_B || function == REV8) {
+            decoded.operation = function == ORC_B ? Operation::ORC_B : Operation::REV8;
+            decoded.imm = 0;
+            break;
+        }
+        switch (CPUUtil::GetFunct7(instruction)) {
+        case 0:
+            decoded.operation = Operation::SRLI;
+            break;
+        case ALTERNATE_Funct7:
+            decoded.operation = Operation::SRAI;
+            break;
+        case ROTATE_Funct7:
+            decoded.operation = Operation::RORI;
+            break;
+        default:
+            return Unsupported;
+        }
+        decoded.imm = CPUUtil::GetImm5(instruction);
+        break;
+    default:
+        return Unsupported;
+    }
+    return decoded;
+}
+
+DecodedInstruction Decoder::DecodeLoadType(const uint32_t instruction)
+{
+    DecodedInstruction decoded = {Operation::UNSUPPORTED, CPUUtil::GetRD(instruction), CPUUtil::GetRS1(instruction), 0,
+                                  CPUUtil::GetImm12(instruction), 0};
+
+    switch (CPUUtil::GetFunct3(instruction)) {
+    case LB:
+        decoded.operation = Operation::LB;
+        break;
+    case LH:
+        decoded.operation = Operation::LH;
+        break;
+    case LW:
+        decoded.operation = Operation::LW;
+        break;
+    case LBU:
+        decoded.operation = Operation::LBU;
+        break;
+    case LHU:
+        decoded.operation = Operation::LHU;
+        break;
+    default:
+        return Unsupported;
+    }
+    return decoded;
+}
+
+DecodedInstruction Decoder::DecodeSType(const uint32_t instruction)
+{
+    // imm[11:5] sits where funct7 is, sign extended like every other immediate
+    const int32_t upperImm = static_cast<int32_t>(instruction) >> 25;
+    const int32_t imm = upperImm << 5 | CPUUtil::GetRD(instruction);
+    DecodedInstruction decoded = {Operation::UNSUPPORTED, 0, CPUUtil::GetRS1(instruction), CPUUtil::GetRS2(instruction),
+                                  imm, 0};
+
+    switch (CPUUtil::GetFunct3(instruction)) {
+    case SB:
+        decoded.operation = Operation::SB;
+        break;
+    case SH:
+        decoded.operation = Operation::SH;
+        break;
+    case SW:
+        decoded.operation = Operation::SW;
+        break;
+    default:
+        return Unsupported;
+    }
+    return decoded;
+}
+
+DecodedInstruction Decoder::DecodeBType(const uint32_t instruction, const uint32_t address)
+{
+    const uint32_t imm12 = instruction >> 31;
+    const uint32_t imm10To5 = instruction >> 25 & 0b111111;
+    const uint32_t imm4To1 = instruction >> 8 & 0b1111;
+    const uint32_t imm11 = instruction >> 7 & 0b1;
+
+    int32_t imm = imm12 << 12 | imm11 << 11 | imm10To5 << 5 | imm4To1 << 1 | 0;
+    if (imm >> 12) {
+        imm |= 0xFFFFE000;
+    }
+    DecodedInstruction decoded = {Operation::UNSUPPORTED, 0, CPUUtil::GetRS1(instruction), CPUUtil::GetRS2(instruction),
+                                  imm, address + imm};
+
+    switch (CPUUtil::GetFunct3(instruction)) {
+    case BEQ:
+        decoded.operation = Operation::BEQ;
+        break;
+    case BNE:
+        decoded.operation = Operation::BNE;
+        break;
+    case BLT:
+        decoded.operation = Operation::BLT;
+        break;
+    case BGE:
+        decoded.operation = Operation::BGE;
+        break;
+    case BLTU:
+        decoded.operation = Operation::BLTU;
+        break;
+    case BGEU:
+        decoded.operation = Operation::BGEU;
+        break;
+    default:
+        return Unsupported;
+    }
+    return decoded;
+}
+
+DecodedInstruction Decoder::DecodeJALType(const uint32_t instruction, const uint32_t address)
+{
+    const uint32_t imm20 = instruction >> 31;
+    const uint32_t imm10To1 = instruction >> 21 & 0b1111111111;
+    const uint32_t imm11 = instruction >> 20 & 0b1;
+    const uint32_t imm19To12 = instruction >> 12 & 0b11111111;
+    int32_t imm = static_cast<int32_t>(0 | imm10To1 << 1 | imm11 << 11 | imm19To12 << 12 | imm20 << 20);
+    // Sign-extend the immediate to 32 bits
+    if (imm20) { // If the sign bit is set, extend it
+        imm |= 0xFFF00000;
+    }
+    return {Operation::JAL, CPUUtil::GetRD(instruction), 0, 0, imm, address + imm};
+}
+
+DecodedInstruction Decoder::DecodeJALRType(const uint32_t instruction)
+{
+    const int16_t imm = CPUUtil::GetImm12(instruction);
+    return {Operation::JALR, CPUUtil::GetRD(instruction), CPUUtil::GetRS1(instruction), 0, imm, 0};
+}
+
+DecodedInstruction Decoder::DecodeMiscMemType(const uint32_t instruction)
+{
+    // the ordering and register fields are reserved for hints, so they are not looked at
+    switch (CPUUtil::GetFunct3(instruction)) {
+    case FENCE:
+        return {Operation::FENCE, 0, 0, 0, 0, 0};
+    case FENCE_I:
+        return {Operation::FENCE_I, 0, 0, 0, 0, 0};
+    default:
+        return Unsupported;
+    }
+}
+
+DecodedInstruction Decoder::DecodeCompressed(const uint16_t instruction, const uint32_t address)
+{
+    const uint8_t funct3 = static_cast<uint8_t>(Bits(instruction, 15, 13));
+    const uint8_t rd = static_cast<uint8_t>(Bits(instruction, 11, 7));
+    const uint8_t rs2 = static_cast<uint8_t>(Bits(instruction, 6, 2));
+    const int32_t imm6 = SignExtend(Bits(instruction, 12, 12) << 5 | Bits(instruction, 6, 2), 6);
+    // offset of C.LW and C.SW
+    const int32_t wordOffset = static_cast<int32_t>(Bits(instruction, 12, 10) << 3 | Bits(instruction, 6, 6) << 2 |
+                                                    Bits(instruction, 5, 5) << 6);
+    DecodedInstruction decoded = Unsupported;
+
+    switch ((instruction & 0b11) << 3 | funct3) {
+    case C0_Quadrant << 3 | C_ADDI4SPN:
+        {
+            const int32_t imm = static_cast<int32_t>(Bits(instruction, 12, 11) << 4 | Bits(instruction, 10, 7) << 6 |
+                                                     Bits(instruction, 6, 6) << 2 | Bits(instruction, 5, 5) << 3);
+            // all zeros is the defined illegal instruction
+            if (imm != 0) {
+                decoded = {Operation::ADDI, CompressedRegister(instruction, 2), 2, 0, imm, 0};
+            }
+            break;
+        }
+    case C0_Quadrant << 3 | C_LW:
+        decoded = {Operation::LW, CompressedRegister(instruction, 2), CompressedRegister(instruction, 7), 0,
+                   wordOffset, 0};
+        break;
+    case C0_Quadrant << 3 | C_SW:
+        decoded = {Operation::SW, 0, CompressedRegister(instruction, 7), CompressedRegister(instruction, 2),
+                   wordOffset, 0};
+        break;
+    case C1_Quadrant << 3 | C_ADDI:
+        decoded = {Operation::ADDI, rd, rd, 0, imm6, 0};
+        break;
+    case C1_Quadrant << 3 | C_JAL:
+    case C1_Quadrant << 3 | C_J:
+        {
+            const uint32_t offset = Bits(instruction, 12, 12) << 11 | Bits(instruction, 11, 11) << 4 |
+                Bits(instruction, 10, 9) << 8 | Bits(instruction, 8, 8) << 10 | Bits(instruction, 7, 7) << 6 |
+                Bits(instruction, 6, 6) << 7 | Bits(instruction, 5, 3) << 1 | Bits(instruction, 2, 2) << 5;
+            const int32_t imm = SignExtend(offset, 12);
+            decoded = {Operation::JAL, static_cast<uint8_t>(funct3 == C_JAL ? 1 : 0), 0, 0, imm, address + imm};
+            break;
+        }
+    case C1_Quadrant << 3 | C_LI:
+        decoded = {Operation::ADDI, rd, 0, 0, imm6, 0};
+        break;
+    case C1_Quadrant << 3 | C_LUI_ADDI16SP:
+        if (rd == 2) {
+            const uint32_t offset = Bits(instruction, 12, 12) << 9 | Bits(instruction, 6, 6) << 4 |
+                Bits(instruction, 5, 5) << 6 | Bits(instruction, 4, 3) << 7 | Bits(instruction, 2, 2) << 5;
+            if (offset != 0) {
+                decoded = {Operation::ADDI, 2, 2, 0, SignExtend(offset, 10), 0};
+            }
+        }
+        else if (imm6 != 0) {
+            decoded = {Operation::LUI, rd, 0, 0, imm6 << 12, 0};
+        }
+        break;
+    case C1_Quadrant << 3 | C_ARITHMETIC:
+        decoded = DecodeCompressedArithmetic(instruction);
+        break;
+    case C1_Quadrant << 3 | C_BEQZ:
+    case C1_Quadrant << 3 | C_BNEZ:
+        {
+            const uint32_t offset = Bits(instruction, 12, 12) << 8 | Bits(instruction, 11, 10) << 3 |
+                Bits(instruction, 6, 5) << 6 | Bits(instruction, 4, 3) << 1 | Bits(instruction, 2, 2) << 5;
+            const int32_t imm = SignExtend(offset, 9);
+            decoded = {funct3 == C_BEQZ ? Operation::BEQ : Operation::BNE, 0, CompressedRegister(instruction, 7), 0,
+                       imm, address + imm};
+            break;
+        }
+    case C2_Quadrant << 3 | C_SLLI:
+        // shift amounts of 32 and more are for RV64
+        if (imm6 >= 0) {
+            decoded = {Operation::SLLI, rd, rd, 0, imm6, 0};
+        }
+        break;
+    case C2_Quadrant << 3 | C_LWSP:
+        if (rd != 0) {
+            const int32_t imm = static_cast<int32_t>(Bits(instruction, 12, 12) << 5 | Bits(instruction, 6, 4) << 2 |
+                                                     Bits(instruction, 3, 2) << 6);
+            decoded = {Operation::LW, rd, 2, 0, imm, 0};
+        }
+        break;
+    case C2_Quadrant << 3 | C_REGISTER:
+        decoded = DecodeCompressedRegister(instruction);
+        break;
+    case C2_Quadrant << 3 | C_SWSP:
+        {
+            const int32_t imm = static_cast<int32_t>(Bits(instruction, 12, 9) << 2 | Bits(instruction, 8, 7) << 6);
+            decoded = {Operation::SW, 0, 2, rs2, imm, 0};
+            break;
+        }
+    default:
+        // the floating point loads and stores and the reserved encodings
+        break;
+    }
+    decoded.size = 2;
+    return decoded;
+}
+
+DecodedInstruction Decoder::DecodeCompressedArithmetic(const uint16_t instruction)
+{
+    const uint8_t rd = CompressedRegister(instruction, 7);
+    const uint8_t rs2 = CompressedRegister(instruction, 2);
+    const bool high = Bits(instruction, 12, 12) != 0;
+    const int32_t imm = static_cast<int32_t>(Bits(instruction, 6, 2));
+
+    switch (Bits(instruction, 11, 10)) {
+    case 0b00:
+        return high ? Unsupported : DecodedInstruction{Operation::SRLI, rd, rd, 0, imm, 0};
+    case 0b01:
+        return high ? Unsupported : DecodedInstruction{Operation::SRAI, rd, rd, 0, imm, 0};
+    case 0b10:
+        return {Operation::ANDI, rd, rd, 0, SignExtend(static_cast<uint32_t>(high) << 5 | imm, 6), 0};
+    default:
+        {
+            // the ones with bit 12 set are the word operations of RV64
+            static constexpr Operation operations[] = {Operation::SUB, Operation::XOR, Operation::OR, Operation::AND};
+            return high ? Unsupported : DecodedInstruction{operations[Bits(instruction, 6, 5)], rd, rd, rs2, 0, 0};
+        }
+    }
+}
+
+DecodedInstruction Decoder::DecodeCompressedRegister(const uint16_t instruction)
+{
+    const uint8_t rd = static_cast<uint8_t>(Bits(instruction, 11, 7));
+    const uint8_t rs2 = static_cast<uint8_t>(Bits(instruction, 6, 2));
+
+    if (Bits(instruction, 12, 12) == 0) {
+        if (rs2 == 0) {
+            // C.JR, x0 is reserved
+            return rd == 0 ? Unsupported : DecodedInstruction{Operation::JALR, 0, rd, 0, 0, 0};
+        }
+        // C.MV
+        return {Operation::ADD, rd, 0, rs2, 0, 0};
+    }
+    if (rs2 == 0) {
+        // C.JALR, or C.EBREAK which is not supported
+        return rd == 0 ? Unsupported : DecodedInstruction{Operation::JALR, 1, rd, 0, 0, 0};
+    }
+    // C.ADD
+    return {Operation::ADD, rd, rd, rs2, 0, 0};
+}
@@ -0,0 +1,129 @@
+#ifndef DECODER_H
+#define DECODER_H
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+// instructions are 2 or 4 bytes long and may start at any even address
+constexpr uint32_t INSTRUCTION_ALIGNMENT = 2;
+
+enum class Operation : uint8_t
+{
+    ADD,
+    SUB,
+    SLL,
+    SLT,
+    SLTU,
+    XOR,
+    SRL,
+    SRA,
+    OR,
+    AND,
+    ADDI,
+    SLTI,
+    SLTIU,
+    XORI,
+    ORI,
+    ANDI,
+    SLLI,
+    SRLI,
+    SRAI,
+    LB,
+    LH,
+    LW,
+    LBU,
+    LHU,
+    SB,
+    SH,
+    SW,
+    BEQ,
+    BNE,
+    BLT,
+    BGE,
+    BLTU,
+    BGEU,
+    JAL,
+    JALR,
+    LUI,
+    AUIPC,
+    MUL,
+    MULH,
+    MULHSU,
+    MULHU,
+    DIV,
+    DIVU,
+    REM,
+    REMU,
+    // Zba
+    SH1ADD,
+    SH2ADD,
+    SH3ADD,
+    // Zbb
+    ANDN,
+    ORN,
+    XNOR,
+    MIN,
+    MINU,
+    MAX,
+    MAXU,
+    ROL,
+    ROR,
+    RORI,
+    CLZ,
+    CTZ,
+    CPOP,
+    SEXT_B,
+    SEXT_H,
+    ZEXT_H,
+    ORC_B,
+    REV8,
+    // no-op, memory accesses are never reordered
+    FENCE,
+    // makes stores to the code visible to the instructions fetched after it
+    FENCE_I,
+    // decoding failure, reported when the instruction is executed
+    UNSUPPORTED
+};
+
+// Instruction with all fields extracted and immediates sign-extended,
+// so executing it does not need to look at the encoding again.
+// Compressed instructions are expanded to the 32-bit instruction they stand for
+struct DecodedInstruction
+{
+    Operation operation;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;
+    // absolute target for branches, JAL and AUIPC
+    uint32_t target;
+    // bytes of the encoding, 2 for compressed instructions
+    uint8_t size = 4;
+};
+
+class Decoder
+{
+public:
+    // a compressed instruction is in the low half, the high half is not looked at then
+    static DecodedInstruction Decode(uint32_t instruction, uint32_t address);
+    // One instruction for every 2 bytes of the code, as if execution could start there.
+    // An instruction that does not end inside the code is unsupported
+    static vector<DecodedInstruction> DecodeProgram(const vector<uint32_t>& instructions);
+    static bool IsCompressed(uint32_t instruction);
+
+private:
+    static DecodedInstruction DecodeRType(uint32_t instruction);
+    static DecodedInstruction DecodeIType(uint32_t instruction);
+    static DecodedInstruction DecodeLoadType(uint32_t instruction);
+    static DecodedInstruction DecodeSType(uint32_t instruction);
+    static DecodedInstruction DecodeBType(uint32_t instruction, uint32_t address);
+    static DecodedInstruction DecodeJALType(uint32_t instruction, uint32_t address);
+    static DecodedInstruction DecodeJALRType(uint32_t instruction);
+    static DecodedInstruction DecodeMiscMemType(uint32_t instruction);
+    static DecodedInstruction DecodeCompressed(uint16_t instruction, uint32_t address);
+    static DecodedInstruction DecodeCompressedArithmetic(uint16_t instruction);
+    static DecodedInstruction DecodeCompressedRegister(uint16_t instruction);
+};
+
+#endif // DECODER_H
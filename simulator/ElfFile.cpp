@@ -0,0 +1,174 @@
+#include "ElfFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef ELF_FILE_MAPPING
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint8_t ELF_MAGIC[4] = {0x7F, 'E', 'L', 'F'};
+static constexpr uint8_t ELF_CLASS_32 = 1;
+static constexpr uint8_t ELF_DATA_LITTLE_ENDIAN = 1;
+
+// false if the bytes are not all inside the file
+static bool ReadAt(std::ifstream& file, const uint64_t fileSize, const uint64_t offset, void* data, const uint64_t size)
+{
+    if (offset > fileSize || fileSize - offset < size) {
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(file.read(static_cast<char*>(data), static_cast<std::streamsize>(size)));
+}
+
+static bool ReadSymbols(std::ifstream& file, const uint64_t fileSize, const ElfHeader& header,
+                        vector<ElfSymbol>& symbols)
+{
+    if (header.sectionHeaderCount == 0) {
+        return true;
+    }
+    if (header.sectionHeaderSize != sizeof(ElfSectionHeader)) {
+        return false;
+    }
+    vector<ElfSectionHeader> sections(header.sectionHeaderCount);
+    if (!ReadAt(file, fileSize, header.sectionHeaderOffset, sections.data(),
+                sections.size() * sizeof(ElfSectionHeader))) {
+        return false;
+    }
+
+    for (const ElfSectionHeader& section : sections) {
+        if (section.type != ELF_SECTION_SYMBOL_TABLE) {
+            continue;
+        }
+        if (section.entrySize != sizeof(ElfSymbolEntry) || section.link >= sections.size()) {
+            return false;
+        }
+        const ElfSectionHeader& stringSection = sections[section.link];
+        vector<char> strings(stringSection.size);
+        vector<ElfSymbolEntry> entries(section.size / sizeof(ElfSymbolEntry));
+        if (!ReadAt(file, fileSize, stringSection.offset, strings.data(), strings.size()) ||
+            !ReadAt(file, fileSize, section.offset, entries.data(), entries.size() * sizeof(ElfSymbolEntry))) {
+            return false;
+        }
+        for (const ElfSymbolEntry& entry : entries) {
+            const uint8_t type = entry.info & 0xF;
+            // section 0 holds the undefined ones
+            if (entry.section == 0 || (type != ELF_SYMBOL_OBJECT && type != ELF_SYMBOL_FUNCTION) ||
+                entry.name >= strings.size()) {
+                continue;
+            }
+            const char* name = strings.data() + entry.name;
+            const size_t length = strnlen(name, strings.size() - entry.name);
+            symbols.push_back({string(name, length), entry.value, entry.size, type == ELF_SYMBOL_FUNCTION});
+        }
+    }
+    return true;
+}
+
+ElfError ElfFile::Read(const string& path, ElfProgram& program)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return ElfError::UNREADABLE;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    ElfHeader header;
+    if (!ReadAt(file, fileSize, 0, &header, sizeof(header))) {
+        return ElfError::NOT_RV32_EXECUTABLE;
+    }
+    if (!std::equal(std::begin(ELF_MAGIC), std::end(ELF_MAGIC), header.ident) || header.ident[4] != ELF_CLASS_32 ||
+        header.ident[5] != ELF_DATA_LITTLE_ENDIAN || header.type != ELF_TYPE_EXECUTABLE ||
+        header.machine != ELF_MACHINE_RISCV || header.programHeaderSize != sizeof(ElfProgramHeader)) {
+        return ElfError::NOT_RV32_EXECUTABLE;
+    }
+
+    ElfProgram result{header.entry, {}, {}, 0, UINT32_MAX, 0};
+    vector<ElfProgramHeader> programHeaders(header.programHeaderCount);
+    if (!ReadAt(file, fileSize, header.programHeaderOffset, programHeaders.data(),
+                programHeaders.size() * sizeof(ElfProgramHeader))) {
+        return ElfError::MALFORMED;
+    }
+    for (const ElfProgramHeader& programHeader : programHeaders) {
+        if (programHeader.type != ELF_SEGMENT_LOAD) {
+            continue;
+        }
+        const ElfSegment segment{programHeader.offset, programHeader.address, programHeader.fileSize,
+                                 programHeader.memorySize, (programHeader.flags & ELF_SEGMENT_EXECUTABLE) != 0};
+        const uint64_t end = static_cast<uint64_t>(segment.address) + segment.memorySize;
+        if (segment.fileSize > segment.memorySize ||
+            static_cast<uint64_t>(segment.offset) + segment.fileSize > fileSize) {
+            return ElfError::MALFORMED;
+        }
+        if (end > ADDRESS_SPACE_SIZE) {
+            return ElfError::SEGMENT_OUT_OF_RANGE;
+        }
+        if (segment.executable && segment.address % INSTRUCTION_ALIGNMENT != 0) {
+            return ElfError::MALFORMED;
+        }
+        result.segments.push_back(segment);
+        result.memoryEnd = std::max(result.memoryEnd, end);
+        if (segment.executable) {
+            result.codeBegin = std::min(result.codeBegin, segment.address);
+            result.codeEnd = std::max(result.codeEnd, end);
+        }
+    }
+    if (result.codeEnd == 0) {
+        result.codeBegin = 0;
+    }
+    if (result.codeEnd - result.codeBegin > ELF_MAX_CODE_SIZE) {
+        return ElfError::CODE_TOO_LARGE;
+    }
+
+    if (!ReadSymbols(file, fileSize, header, result.symbols)) {
+        return ElfError::MALFORMED;
+    }
+    std::ranges::stable_sort(result.symbols, {}, &ElfSymbol::address);
+    program = std::move(result);
+    return ElfError::NONE;
+}
+
+bool ElfFile::Load(const string& path, const ElfProgram& program, Memory& memory)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+#ifdef ELF_FILE_MAPPING
+    const int descriptor = memory.GetBackend() == MemoryBackend::RESERVED ? open(path.c_str(), O_RDONLY) : -1;
+#endif
+
+    bool loaded = true;
+    for (const ElfSegment& segment : program.segments) {
+        const uint64_t fileEnd = static_cast<uint64_t>(segment.address) + segment.fileSize;
+        // bytes from mappedBegin to mappedEnd are mapped, the others of the file part are copied
+        uint64_t mappedBegin = fileEnd;
+        uint64_t mappedEnd = fileEnd;
+#ifdef ELF_FILE_MAPPING
+        const uint64_t firstPage = RoundUpToPage(segment.address);
+        const uint64_t lastPage = fileEnd & ~(MEMORY_PAGE_SIZE - 1ull);
+        if (descriptor >= 0 && (segment.offset - segment.address) % MEMORY_PAGE_SIZE == 0 && firstPage < lastPage &&
+            memory.MapFile(descriptor, segment.offset + (firstPage - segment.address),
+                           static_cast<uint32_t>(firstPage >> MEMORY_PAGE_BITS),
+                           static_cast<uint32_t>((lastPage - firstPage) >> MEMORY_PAGE_BITS))) {
+            mappedBegin = firstPage;
+            mappedEnd = lastPage;
+        }
+#endif
+        for (const auto& [from, to] : {std::pair<uint64_t, uint64_t>(segment.address, mappedBegin),
+                                       std::pair<uint64_t, uint64_t>(mappedEnd, fileEnd)}) {
+            vector<uint8_t> data(to - from);
+            loaded = loaded && ReadAt(file, fileSize, segment.offset + (from - segment.address), data.data(),
+                                      data.size()) && memory.WriteRange(static_cast<uint32_t>(from), data);
+        }
+    }
+
+#ifdef ELF_FILE_MAPPING
+    if (descriptor >= 0) {
+        close(descriptor);
+    }
+#endif
+    return loaded;
+}
@@ -0,0 +1,165 @@
+#ifndef ELFFILE_H
+#define ELFFILE_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CPU.h"
+
+using std::string;
+using std::vector;
+
+#if !defined(_WIN32)
+#define ELF_FILE_MAPPING
+#endif
+
+constexpr uint16_t ELF_TYPE_EXECUTABLE = 2;
+constexpr uint16_t ELF_MACHINE_RISCV = 243;
+constexpr uint32_t ELF_SEGMENT_LOAD = 1;
+constexpr uint32_t ELF_SEGMENT_EXECUTABLE = 1;
+constexpr uint32_t ELF_SECTION_SYMBOL_TABLE = 2;
+constexpr uint8_t ELF_SYMBOL_OBJECT = 1;
+constexpr uint8_t ELF_SYMBOL_FUNCTION = 2;
+// The program is the code from the lowest to the end of the highest executable segment, which the engines
+// translate as a whole, so where it is linked does not matter but how far it spans does
+constexpr uint32_t ELF_MAX_CODE_SIZE = 64 << 20;
+// Room Simulator::LoadElf leaves for the stack above the highest segment unless told otherwise
+constexpr uint64_t ELF_DEFAULT_STACK_SIZE = 1 << 20;
+
+enum class ElfError
+{
+    NONE = 0,
+    // the file cannot be opened or its segments cannot be read
+    UNREADABLE = 1,
+    NOT_RV32_EXECUTABLE = 2,
+    // headers, segments or symbols point outside the file or contradict each other
+    MALFORMED = 3,
+    // a segment ends past the 32-bit address space
+    SEGMENT_OUT_OF_RANGE = 4,
+    // executable segments span more than ELF_MAX_CODE_SIZE
+    CODE_TOO_LARGE = 5
+};
+
+constexpr std::string_view toString(const ElfError error)
+{
+    switch (error) {
+    case ElfError::NONE:
+        return "No error";
+    case ElfError::UNREADABLE:
+        return "File cannot be read";
+    case ElfError::NOT_RV32_EXECUTABLE:
+        return "Not a little-endian RV32 executable";
+    case ElfError::MALFORMED:
+        return "Malformed executable";
+    case ElfError::SEGMENT_OUT_OF_RANGE:
+        return "Segment outside the 32-bit address space";
+    case ElfError::CODE_TOO_LARGE:
+        return "Executable segments span more than 64 MiB";
+    default:
+        return "Unknown error";
+    }
+}
+
+// The parts of the ELF32 format the loader reads, all little-endian
+struct ElfHeader
+{
+    // 0x7F, "ELF", class 1 for 32-bit, data 1 for little-endian, version 1 and padding
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t programHeaderOffset;
+    uint32_t sectionHeaderOffset;
+    uint32_t flags;
+    uint16_t headerSize;
+    uint16_t programHeaderSize;
+    uint16_t programHeaderCount;
+    uint16_t sectionHeaderSize;
+    uint16_t sectionHeaderCount;
+    uint16_t sectionNameIndex;
+};
+
+struct ElfProgramHeader
+{
+    uint32_t type;
+    uint32_t offset;
+    uint32_t address;
+    uint32_t physicalAddress;
+    uint32_t fileSize;
+    uint32_t memorySize;
+    uint32_t flags;
+    uint32_t alignment;
+};
+
+struct ElfSectionHeader
+{
+    uint32_t name;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t address;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t link;
+    uint32_t info;
+    uint32_t alignment;
+    uint32_t entrySize;
+};
+
+struct ElfSymbolEntry
+{
+    uint32_t name;
+    uint32_t value;
+    uint32_t size;
+    // type in the low four bits
+    uint8_t info;
+    uint8_t other;
+    uint16_t section;
+};
+
+struct ElfSegment
+{
+    // file bytes from offset on are loaded to address, the rest up to memorySize is zeros
+    uint32_t offset;
+    uint32_t address;
+    uint32_t fileSize;
+    uint32_t memorySize;
+    bool executable;
+};
+
+struct ElfSymbol
+{
+    string name;
+    uint32_t address;
+    uint32_t size;
+    bool function;
+};
+
+struct ElfProgram
+{
+    uint32_t entry;
+    vector<ElfSegment> segments;
+    // the defined functions and objects in address order
+    vector<ElfSymbol> symbols;
+    // end of the highest segment in memory
+    uint64_t memoryEnd;
+    // start of the lowest and end of the highest executable segment, both 0 without any
+    uint32_t codeBegin;
+    uint64_t codeEnd;
+};
+
+// Loads statically linked RV32 executables, such as those of a cross toolchain, without going through the parser
+class ElfFile
+{
+public:
+    // Reads the segments and symbols. Fails if the file is not a valid RV32 little-endian executable
+    // whose segments fit into the address space and whose code spans at most ELF_MAX_CODE_SIZE
+    static ElfError Read(const string& path, ElfProgram& program);
+    // Writes the segments into the memory, which has to hold them and be zeros where they go. Where supported,
+    // the reserved backend maps whole pages straight from the file copy-on-write. False if the file cannot be
+    // read completely
+    static bool Load(const string& path, const ElfProgram& program, Memory& memory);
+};
+
+#endif // ELFFILE_H
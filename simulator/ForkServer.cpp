@@ -0,0 +1,79 @@
+#include "ForkServer.h"
+
+#include <algorithm>
+
+#include "Pipe.h"
+
+#ifdef FORK_SERVER_SUPPORTED
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+ForkServer::ForkServer(Simulator* simulator) : m_simulator(simulator) {}
+
+bool ForkServer::Initialize(const uint32_t pausePc, const uint64_t maxInstructions)
+{
+    // stepped, it only happens once
+    for (uint64_t executed = 0; m_simulator->GetCpuStatus().pc != pausePc; executed++) {
+        if (executed == maxInstructions || m_simulator->Step().error != ExecutionError::NONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef FORK_SERVER_SUPPORTED
+bool ForkServer::Run(const uint32_t inputAddress, const span<const uint8_t> input, const uint64_t maxInstructions,
+                     ForkRunResult& result)
+{
+    const uint64_t memorySize = m_simulator->GetMemorySize();
+    if (input.size() > memorySize || inputAddress > memorySize - input.size()) {
+        return false;
+    }
+
+    int descriptors[2];
+    if (pipe(descriptors) != 0) {
+        return false;
+    }
+    const pid_t child = fork();
+    if (child < 0) {
+        close(descriptors[0]);
+        close(descriptors[1]);
+        return false;
+    }
+
+    if (child == 0) {
+        close(descriptors[0]);
+        m_simulator->WriteMemory(inputAddress, input);
+        ForkRunResult report{};
+        report.run = m_simulator->Run(maxInstructions);
+        const CpuStatus status = m_simulator->GetCpuStatus();
+        std::ranges::copy(status.registers, report.hart.registers.begin());
+        report.hart.registers[PC] = status.pc;
+        report.hart.retired = status.retired;
+
+        if (!Pipe::WriteAll(descriptors[1], &report, sizeof(report))) {
+            _exit(1);
+        }
+        // skips the destructors and the buffers the child shares with the server
+        _exit(0);
+    }
+
+    close(descriptors[1]);
+    ForkRunResult report{};
+    const bool received = Pipe::ReadAll(descriptors[0], &report, sizeof(report));
+    close(descriptors[0]);
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return false;
+    }
+    result = report;
+    return true;
+}
+#else
+bool ForkServer::Run(uint32_t, span<const uint8_t>, uint64_t, ForkRunResult&) { return false; }
+#endif
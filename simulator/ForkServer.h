@@ -0,0 +1,41 @@
+#ifndef FORKSERVER_H
+#define FORKSERVER_H
+#include <cstdint>
+#include <span>
+
+#include "Simulator.h"
+
+using std::span;
+
+#if !defined(_WIN32)
+#define FORK_SERVER_SUPPORTED
+#endif
+
+// What a run reports back to the server, sent over a pipe as raw bytes
+struct ForkRunResult
+{
+    RunResult run;
+    HartState hart;
+};
+
+// Runs the same initialized program many times. The program is loaded and run up to a pause point once,
+// after which every run is a forked child that starts from that state and shares its memory copy-on-write,
+// so a run costs the pages it writes instead of parsing, loading and initializing the program again.
+// Only available where fork exists, see FORK_SERVER_SUPPORTED
+class ForkServer
+{
+public:
+    // the simulator holds the loaded program and has to outlive the server
+    explicit ForkServer(Simulator* simulator);
+    // Runs the program until it is about to execute the instruction at pausePc, the state every run starts from.
+    // False if it ends or fails before that within maxInstructions
+    bool Initialize(uint32_t pausePc, uint64_t maxInstructions);
+    // Writes input at inputAddress in a child and runs it for up to maxInstructions, the server keeps its state.
+    // False if the input does not fit into the memory or the child did not report back
+    bool Run(uint32_t inputAddress, span<const uint8_t> input, uint64_t maxInstructions, ForkRunResult& result);
+
+private:
+    Simulator* m_simulator;
+};
+
+#endif // FORKSERVER_H
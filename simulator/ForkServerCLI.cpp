@@ -0,0 +1,106 @@
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+#include "../parser/Parser.h"
+#include "CommandLine.h"
+#include "ForkServer.h"
+
+using std::cout;
+
+// bytes as pairs of hex digits, spaces between them are ignored
+static bool ParseInput(const string& line, vector<uint8_t>& input)
+{
+    input.clear();
+    string digits;
+    for (const char c : line) {
+        if (c != ' ' && c != '\t' && c != '\r') {
+            digits.push_back(c);
+        }
+    }
+    if (digits.size() % 2 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        uint8_t byte;
+        const auto [last, error] = std::from_chars(digits.data() + i, digits.data() + i + 2, byte, 16);
+        if (error != std::errc() || last != digits.data() + i + 2) {
+            return false;
+        }
+        input.push_back(byte);
+    }
+    return true;
+}
+
+// Loads a program once, runs it up to the pause pc and then runs every input read from stdin in a forked child.
+// Each input line is written at the input address, each run prints its stop reason, retired instructions,
+// pc and a0
+int main(const int argc, char* argv[])
+{
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <in> <pause pc> <input address> [max instructions] [memory size]"
+                  << std::endl;
+        return 1;
+    }
+
+    uint64_t pausePc;
+    uint64_t inputAddress;
+    uint64_t maxInstructions = UINT64_MAX;
+    uint64_t memorySize = 1 << 20;
+    if (!CommandLine::ParseNumber(argv[2], pausePc) || pausePc > UINT32_MAX ||
+        !CommandLine::ParseNumber(argv[3], inputAddress) || inputAddress > UINT32_MAX ||
+        (argc >= 5 && !CommandLine::ParseNumber(argv[4], maxInstructions)) ||
+        (argc >= 6 && (!CommandLine::ParseNumber(argv[5], memorySize) || memorySize > ADDRESS_SPACE_SIZE))) {
+        std::cerr << "Invalid number" << std::endl;
+        return 1;
+    }
+
+    std::ifstream inputFile(argv[1]);
+    if (!inputFile) {
+        std::cerr << "Error opening file: " << argv[1] << std::endl;
+        return 1;
+    }
+    vector<string> lines;
+    string line;
+    while (std::getline(inputFile, line)) {
+        lines.push_back(line);
+    }
+    inputFile.close();
+
+    const ParsingResult parsed = Parser::Parse(lines);
+    if (!parsed.success) {
+        std::cerr << "Line " << parsed.errorLine << ": Error while parsing instruction: " << lines[parsed.errorLine]
+                  << std::endl;
+        std::cerr << "Error: " << parsed.errorType << std::endl;
+        return 1;
+    }
+
+#ifdef FORK_SERVER_SUPPORTED
+    Simulator simulator(memorySize, ExecutionEngine::JIT, MemoryBackend::RESERVED);
+    simulator.SetInstructions(parsed.instructions);
+    ForkServer server(&simulator);
+    if (!server.Initialize(pausePc, maxInstructions)) {
+        std::cerr << "The program did not reach the pause pc" << std::endl;
+        return 1;
+    }
+
+    vector<uint8_t> input;
+    while (std::getline(std::cin, line)) {
+        ForkRunResult result;
+        if (!ParseInput(line, input)) {
+            cout << "invalid input" << std::endl;
+        }
+        else if (!server.Run(inputAddress, input, maxInstructions, result)) {
+            cout << "run failed" << std::endl;
+        }
+        else {
+            cout << toString(result.run.reason) << " " << result.run.instructions << " " << result.hart.registers[PC]
+                 << " " << result.hart.registers[10] << std::endl;
+        }
+    }
+    return 0;
+#else
+    std::cerr << "Fork server mode is not supported on this platform" << std::endl;
+    return 1;
+#endif
+}
@@ -0,0 +1,126 @@
+#include "History.h"
+
+#include <algorithm>
+
+// Bytes a snapshot adds on top of the previous one. Pages that are still shared with it cost only their pointer
+static uint64_t EstimateCost(const MemorySnapshot& snapshot, const MemorySnapshot* previous)
+{
+    uint64_t cost = sizeof(Checkpoint) + snapshot.pages.size() * sizeof(SnapshotPage);
+    auto shared = previous != nullptr ? previous->pages.begin() : snapshot.pages.end();
+    const auto sharedEnd = previous != nullptr ? previous->pages.end() : snapshot.pages.end();
+    for (const SnapshotPage& page : snapshot.pages) {
+        // both are in address order
+        while (shared != sharedEnd && shared->first < page.first) {
+            ++shared;
+        }
+        if (shared == sharedEnd || shared->first != page.first || shared->second != page.second) {
+            cost += MEMORY_PAGE_SIZE;
+        }
+    }
+    return cost;
+}
+
+History::History(const uint64_t memoryBudget, const uint64_t checkpointInterval) :
+    m_memoryBudget(memoryBudget), m_checkpointInterval(std::max<uint64_t>(checkpointInterval, 1)), m_position(0),
+    m_usedMemory(0)
+{
+}
+
+uint64_t History::GetPosition() const { return m_position; }
+
+uint64_t History::GetOldestPosition() const
+{
+    const uint64_t checkpoint = m_checkpoints.empty() ? m_position : m_checkpoints.front().position;
+    return std::min(GetUndoBegin(), checkpoint);
+}
+
+uint64_t History::GetCheckpointInterval() const { return m_checkpointInterval; }
+
+uint64_t History::GetUsedMemory() const { return m_usedMemory; }
+
+bool History::IsCheckpointDue() const
+{
+    return m_position % m_checkpointInterval == 0 &&
+           (m_checkpoints.empty() || m_checkpoints.back().position != m_position);
+}
+
+void History::AddCheckpoint(SimulatorSnapshot snapshot)
+{
+    if (!m_checkpoints.empty() && m_checkpoints.back().position == m_position) {
+        return;
+    }
+    const uint64_t cost =
+        EstimateCost(snapshot.memory, m_checkpoints.empty() ? nullptr : &m_checkpoints.back().snapshot.memory);
+    m_checkpoints.push_back({m_position, std::move(snapshot), cost});
+    m_usedMemory += cost;
+    Evict();
+}
+
+const Checkpoint* History::FindCheckpoint(const uint64_t position) const
+{
+    const auto after = std::ranges::upper_bound(m_checkpoints, position, {}, &Checkpoint::position);
+    return after == m_checkpoints.begin() ? nullptr : &*std::prev(after);
+}
+
+void History::AddRecord(const UndoRecord& record)
+{
+    if (record.failed && (m_checkpoints.empty() || m_checkpoints.back().position != m_position)) {
+        // its checkpoint did not fit into the budget, nothing before it can be undone
+        Skip(1);
+        return;
+    }
+    m_records.push_back(record);
+    m_position++;
+    m_usedMemory += sizeof(UndoRecord);
+    Evict();
+}
+
+uint64_t History::GetUndoBegin() const { return m_position - m_records.size(); }
+
+const UndoRecord& History::GetLastRecord() const { return m_records.back(); }
+
+void History::Skip(const uint64_t instructions)
+{
+    if (instructions == 0) {
+        return;
+    }
+    m_usedMemory -= m_records.size() * sizeof(UndoRecord);
+    m_records.clear();
+    m_position += instructions;
+}
+
+void History::Truncate(const uint64_t position)
+{
+    while (!m_checkpoints.empty() && m_checkpoints.back().position > position) {
+        m_usedMemory -= m_checkpoints.back().cost;
+        m_checkpoints.pop_back();
+    }
+    // the records have to keep reaching up to the current position
+    const uint64_t dropped = position < GetUndoBegin() ? m_records.size() : m_position - position;
+    m_records.erase(m_records.end() - static_cast<std::ptrdiff_t>(dropped), m_records.end());
+    m_usedMemory -= dropped * sizeof(UndoRecord);
+    m_position = position;
+}
+
+void History::Clear()
+{
+    m_records.clear();
+    m_checkpoints.clear();
+    m_position = 0;
+    m_usedMemory = 0;
+}
+
+void History::Evict()
+{
+    while (m_usedMemory > m_memoryBudget && (!m_records.empty() || !m_checkpoints.empty())) {
+        // oldest first, a record goes before the checkpoint at its own position that it may need
+        if (!m_records.empty() && (m_checkpoints.empty() || GetUndoBegin() <= m_checkpoints.front().position)) {
+            m_records.pop_front();
+            m_usedMemory -= sizeof(UndoRecord);
+        }
+        else {
+            m_usedMemory -= m_checkpoints.front().cost;
+            m_checkpoints.pop_front();
+        }
+    }
+}
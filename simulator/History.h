@@ -0,0 +1,85 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+#include <cstdint>
+#include <deque>
+
+#include "Memory.h"
+#include "Registers.h"
+
+constexpr uint64_t DEFAULT_CHECKPOINT_INTERVAL = 1u << 16;
+
+// Registers and memory of a simulator, restoring it does not change the program
+struct SimulatorSnapshot
+{
+    HartState hart;
+    MemorySnapshot memory;
+};
+
+// What one stepped instruction overwrote
+struct UndoRecord
+{
+    uint32_t pc;
+    // old value of reg, which is 0 if no register was written
+    uint32_t registerValue;
+    uint32_t address;
+    // old bytes at address, width is 0 if nothing was stored
+    uint32_t memoryValue;
+    uint8_t reg;
+    uint8_t width;
+    // the instruction failed and reset the CPU, the checkpoint at its position holds the state before
+    bool failed;
+};
+
+struct Checkpoint
+{
+    uint64_t position;
+    SimulatorSnapshot snapshot;
+    // estimated bytes the snapshot keeps alive on its own
+    uint64_t cost;
+};
+
+// Timeline of executed instructions. Positions count them, including failed ones, since the history was started.
+// Stepped instructions leave undo records behind, and checkpoints are taken every checkpoint interval,
+// so any position since the oldest kept one is reached by undoing up to an interval of records or by
+// restoring a checkpoint and replaying less than an interval. The oldest records and checkpoints are
+// dropped once they take up more than the memory budget
+class History
+{
+public:
+    History(uint64_t memoryBudget, uint64_t checkpointInterval);
+    uint64_t GetPosition() const;
+    // earliest position that can still be gone back to
+    uint64_t GetOldestPosition() const;
+    uint64_t GetCheckpointInterval() const;
+    uint64_t GetUsedMemory() const;
+    bool IsCheckpointDue() const;
+    // at the current position, ignored if there already is one
+    void AddCheckpoint(SimulatorSnapshot snapshot);
+    // latest checkpoint at or before position, nullptr if there is none
+    const Checkpoint* FindCheckpoint(uint64_t position) const;
+    // records the instruction at the current position and moves past it
+    void AddRecord(const UndoRecord& record);
+    // first position the undo records cover, they always reach up to the current one
+    uint64_t GetUndoBegin() const;
+    // record of the instruction before the current position, only valid if GetUndoBegin() is before it
+    const UndoRecord& GetLastRecord() const;
+    // moves past instructions that were run without records, which drops the ones before them
+    void Skip(uint64_t instructions);
+    // forgets everything after position, which becomes the current one
+    void Truncate(uint64_t position);
+    void Clear();
+
+private:
+    void Evict();
+
+    uint64_t m_memoryBudget;
+    uint64_t m_checkpointInterval;
+    uint64_t m_position;
+    uint64_t m_usedMemory;
+    // oldest first, the last one is for the instruction before m_position
+    std::deque<UndoRecord> m_records;
+    // in position order
+    std::deque<Checkpoint> m_checkpoints;
+};
+
+#endif // HISTORY_H
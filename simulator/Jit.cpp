@@ -0,0 +1,903 @@
+#include "Jit.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "BitManipulation.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_HOST
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#if defined(JIT_HOST) && defined(MEMORY_RESERVATION) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_FAULT_RECOVERY
+#include <signal.h>
+#ifdef __linux__
+#include <ucontext.h>
+#endif
+#endif
+
+// Registers of the generated code, all callee-saved in both the System V and the Windows ABI
+constexpr X86Register GUEST_REGISTERS = RBX;
+constexpr X86Register MEMORY_BASE = RBP;
+constexpr X86Register CONTEXT = R12;
+// the three pushes of the prologue already keep calls 16-byte aligned
+#ifdef _WIN32
+constexpr X86Register ARGUMENTS[] = {RCX, RDX, R8};
+// shadow space for the callee
+constexpr int8_t STACK_RESERVE = 32;
+#else
+constexpr X86Register ARGUMENTS[] = {RDI, RSI, RDX};
+constexpr int8_t STACK_RESERVE = 0;
+#endif
+
+constexpr size_t CODE_REGION_SIZE = 256 * 1024;
+
+static uint8_t* AllocateCode(const size_t size)
+{
+#if defined(JIT_HOST) && defined(_WIN32)
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#elif defined(JIT_HOST)
+    void* code = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return code == MAP_FAILED ? nullptr : static_cast<uint8_t*>(code);
+#else
+    return nullptr;
+#endif
+}
+
+// code is never writable and executable at the same time
+static bool ProtectCode(uint8_t* code, const size_t size, const bool executable)
+{
+#if defined(JIT_HOST) && defined(_WIN32)
+    DWORD previous;
+    return VirtualProtect(code, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &previous) != 0;
+#elif defined(JIT_HOST)
+    return mprotect(code, size, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#else
+    return false;
+#endif
+}
+
+static void FreeCode(uint8_t* code, const size_t size)
+{
+#if defined(JIT_HOST) && defined(_WIN32)
+    VirtualFree(code, 0, MEM_RELEASE);
+#elif defined(JIT_HOST)
+    munmap(code, size);
+#endif
+}
+
+// Memory accesses of the generated code, they go through Memory so sparse pages and the TLB stay
+// in one place. A failed access sets the error and the generated code leaves the block
+template <typename T>
+static uint32_t JitLoad(JitContext* context, const uint32_t address)
+{
+    T value;
+    if (!context->memory->Load(address, value)) {
+        context->error = static_cast<uint32_t>(ExecutionError::INVALID_MEMORY_ACCESS);
+        return 0;
+    }
+    return static_cast<uint32_t>(value);
+}
+
+// stores return whether they changed the code, the generated code leaves the block then
+template <typename T>
+static uint32_t JitStore(JitContext* context, const uint32_t address, const uint32_t value)
+{
+    if (!context->memory->Store(address, static_cast<T>(value))) {
+        context->error = static_cast<uint32_t>(ExecutionError::INVALID_MEMORY_ACCESS);
+    }
+    return context->memory->HasCodeChanges();
+}
+
+static uint32_t JitMarkDirty(JitContext* context, const uint32_t address, const uint32_t size)
+{
+    context->memory->MarkDirtyRange(address, size);
+    return context->memory->HasCodeChanges();
+}
+
+static void JitInvalidateCode(JitContext* context) { context->memory->InvalidateCode(); }
+
+template <typename Function>
+static uint64_t HelperAddress(const Function function)
+{
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(function));
+}
+
+#ifdef JIT_FAULT_RECOVERY
+// context of the block running on this thread, only set while generated code runs
+static thread_local JitContext* t_nativeContext = nullptr;
+static struct sigaction g_previousSegv;
+static struct sigaction g_previousBus;
+
+static void HandleFault(const int number, siginfo_t* info, void* signalContext)
+{
+    const JitContext* context = t_nativeContext;
+    const uint8_t* address = static_cast<const uint8_t*>(info->si_addr);
+    if (context != nullptr && context->memoryBase != nullptr && address >= context->memoryBase &&
+        address < context->memoryBase + ADDRESS_SPACE_SIZE + MEMORY_PAGE_SIZE) {
+        // only direct accesses of the generated code get here, none of them is inside a call
+        const uintptr_t stub = reinterpret_cast<uintptr_t>(context->faultStub);
+#ifdef __linux__
+        static_cast<ucontext_t*>(signalContext)->uc_mcontext.gregs[REG_RIP] = static_cast<greg_t>(stub);
+#else
+        static_cast<ucontext_t*>(signalContext)->uc_mcontext->__ss.__rip = stub;
+#endif
+        return;
+    }
+
+    // not ours, hand it to whoever was there before or crash as usual when returning
+    const struct sigaction& previous = number == SIGSEGV ? g_previousSegv : g_previousBus;
+    if ((previous.sa_flags & SA_SIGINFO) != 0) {
+        previous.sa_sigaction(number, info, signalContext);
+    }
+    else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+        previous.sa_handler(number);
+    }
+    else {
+        signal(number, SIG_DFL);
+    }
+}
+#endif
+
+static bool InstallFaultHandler()
+{
+#ifdef JIT_FAULT_RECOVERY
+    static const bool installed = [] {
+        struct sigaction action = {};
+        action.sa_sigaction = HandleFault;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        // macOS reports accesses to inaccessible pages as SIGBUS
+        return sigaction(SIGSEGV, &action, &g_previousSegv) == 0 && sigaction(SIGBUS, &action, &g_previousBus) == 0;
+    }();
+    return installed;
+#else
+    return false;
+#endif
+}
+
+static X86LoadType GetLoadType(const Operation operation)
+{
+    switch (operation) {
+    case Operation::LH:
+        return X86LoadType::HALF_WORD_SIGNED;
+    case Operation::LW:
+        return X86LoadType::WORD;
+    case Operation::LBU:
+        return X86LoadType::BYTE_UNSIGNED;
+    case Operation::LHU:
+        return X86LoadType::HALF_WORD_UNSIGNED;
+    default:
+        return X86LoadType::BYTE_SIGNED;
+    }
+}
+
+static uint64_t GetMemoryHelper(const Operation operation)
+{
+    switch (operation) {
+    case Operation::LB:
+        return HelperAddress(&JitLoad<int8_t>);
+    case Operation::LH:
+        return HelperAddress(&JitLoad<int16_t>);
+    case Operation::LW:
+        return HelperAddress(&JitLoad<uint32_t>);
+    case Operation::LBU:
+        return HelperAddress(&JitLoad<uint8_t>);
+    case Operation::LHU:
+        return HelperAddress(&JitLoad<uint16_t>);
+    case Operation::SB:
+        return HelperAddress(&JitStore<uint8_t>);
+    case Operation::SH:
+        return HelperAddress(&JitStore<uint16_t>);
+    default:
+        return HelperAddress(&JitStore<uint32_t>);
+    }
+}
+
+static bool IsStore(const Operation operation)
+{
+    return operation == Operation::SB || operation == Operation::SH || operation == Operation::SW;
+}
+
+static uint8_t GetStoreWidth(const Operation operation)
+{
+    if (operation == Operation::SB) {
+        return 1;
+    }
+    return operation == Operation::SH ? 2 : 4;
+}
+
+static void LoadRegister(X86Emitter& emitter, const X86Register dst, const uint8_t reg)
+{
+    if (reg == 0) {
+        emitter.Alu32(X86AluOperation::XOR, dst, dst);
+    }
+    else {
+        emitter.Load32(dst, GUEST_REGISTERS, reg * 4);
+    }
+}
+
+static void StoreRegister(X86Emitter& emitter, const uint8_t reg, const X86Register src)
+{
+    if (reg != 0) {
+        emitter.Store32(GUEST_REGISTERS, reg * 4, src);
+    }
+}
+
+static void StoreRegister(X86Emitter& emitter, const uint8_t reg, const uint32_t value)
+{
+    if (reg != 0) {
+        emitter.Store32(GUEST_REGISTERS, reg * 4, value);
+    }
+}
+
+Jit::Jit(CPU* cpu, const uint32_t threshold) :
+    BlockCache(cpu), m_threshold(threshold), m_directMemory(false), m_context(), m_discardedCode(0)
+{
+}
+
+Jit::~Jit() { ReleaseCode(); }
+
+void Jit::Load()
+{
+    BlockCache::Load();
+    m_native.clear();
+    ReleaseCode();
+}
+
+RunResult Jit::Run(const uint64_t maxInstructions)
+{
+    // memory may have been resized since the last run, code compiled for the other kind of access is dropped
+    if (UsesDirectMemory() != m_directMemory) {
+        m_native.clear();
+        ReleaseCode();
+        m_directMemory = !m_directMemory;
+    }
+    m_context.registers = m_cpu->m_registers.GetData();
+    m_context.memory = m_cpu->m_memory;
+    m_context.memoryBase = m_directMemory ? m_cpu->m_memory->GetReservedBase() : nullptr;
+    m_context.dirtyPages = m_cpu->m_memory->GetDirtyMap();
+    m_context.error = static_cast<uint32_t>(ExecutionError::NONE);
+    return BlockCache::Run(maxInstructions);
+}
+
+bool Jit::IsSupported()
+{
+#ifdef JIT_HOST
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint32_t Jit::GetCompiledBlockCount() const
+{
+    return static_cast<uint32_t>(
+        std::count_if(m_native.begin(), m_native.end(), [](const NativeBlock& block) { return block.code != nullptr; }));
+}
+
+const ThreadedOp* Jit::ExecuteBlock(const int32_t block, ThreadedContext& context, const ThreadedOp* op)
+{
+    if (static_cast<size_t>(block) >= m_native.size()) {
+        m_native.resize(m_blocks.size(), {0, false, nullptr, 0, nullptr, 0});
+    }
+
+    NativeBlock& native = m_native[block];
+    if (native.code == nullptr) {
+        if (native.translated || ++native.hits < m_threshold || !Compile(block)) {
+            return BlockCache::ExecuteBlock(block, context, op);
+        }
+    }
+
+    m_context.faultStub = native.faultStub;
+#ifdef JIT_FAULT_RECOVERY
+    t_nativeContext = &m_context;
+    const uint32_t pc = native.code(&m_context);
+    t_nativeContext = nullptr;
+#else
+    const uint32_t pc = native.code(&m_context);
+#endif
+    if (m_context.error != static_cast<uint32_t>(ExecutionError::NONE)) {
+        context.error = static_cast<ExecutionError>(m_context.error);
+        context.errorOp = context.base + m_context.errorIndex;
+        m_context.error = static_cast<uint32_t>(ExecutionError::NONE);
+        return context.end;
+    }
+    if (m_cpu->m_memory->HasCodeChanges()) {
+        // left right after the store or FENCE.I, which stored its index
+        context.codeChange = context.base + m_context.errorIndex;
+        context.exitPc = pc;
+        return context.end;
+    }
+    if (native.length < m_blocks[block].length) {
+        return Fallback(block, context, pc);
+    }
+    const uint32_t index = GetIndex(pc);
+    if (index >= static_cast<uint32_t>(context.end - context.base)) {
+        context.exitPc = pc;
+        return context.end;
+    }
+    return context.base + index;
+}
+
+void Jit::Retranslate(const int32_t block)
+{
+    BlockCache::Retranslate(block);
+    if (static_cast<size_t>(block) >= m_native.size()) {
+        return;
+    }
+    m_discardedCode += m_native[block].size;
+    m_native[block] = {0, false, nullptr, 0, nullptr, 0};
+    if (m_discardedCode >= CODE_REGION_SIZE) {
+        // code that keeps changing would fill region after region otherwise
+        m_native.clear();
+        ReleaseCode();
+    }
+}
+
+const ThreadedOp* Jit::Fallback(const int32_t block, ThreadedContext& context, const uint32_t pc)
+{
+    context.registers->SetPC(pc);
+    const ThreadedOp* op = context.base + GetIndex(pc);
+    const ExecutionError error = m_cpu->ExecuteInstruction(op->instruction).error;
+    if (error != ExecutionError::NONE) {
+        context.error = error;
+        context.errorOp = op;
+        return context.end;
+    }
+    // the untranslated instruction never ends a block, the rest of it is interpreted
+    return BlockCache::ExecuteBlock(block, context, op + op->instruction.size / INSTRUCTION_ALIGNMENT);
+}
+
+bool Jit::CanTranslate(const Operation operation)
+{
+    switch (operation) {
+    case Operation::DIV:
+    case Operation::DIVU:
+    case Operation::REM:
+    case Operation::REMU:
+    case Operation::UNSUPPORTED:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool Jit::UsesDirectMemory() const
+{
+    // faults only catch whole pages, so the size has to end on one
+    const Memory* memory = m_cpu->m_memory;
+    return memory->GetReservedBase() != nullptr && memory->GetSize() % MEMORY_PAGE_SIZE == 0 &&
+           InstallFaultHandler();
+}
+
+bool Jit::Compile(const int32_t block)
+{
+    m_native[block].translated = true;
+    if (!IsSupported()) {
+        return false;
+    }
+
+    const Block& info = m_blocks[block];
+    X86Emitter emitter;
+    EmitPrologue(emitter);
+    uint32_t length = 0;
+    uint32_t index = info.start;
+    const DecodedInstruction* last = nullptr;
+    while (length < info.length && CanTranslate(m_ops[index].instruction.operation)) {
+        last = &m_ops[index].instruction;
+        EmitInstruction(emitter, *last, index);
+        index += last->size / INSTRUCTION_ALIGNMENT;
+        length++;
+    }
+    if (length == 0) {
+        return false;
+    }
+    if (!EndsBlock(last->operation)) {
+        // continue with the untranslated instruction or the end of the program
+        emitter.Move32(RAX, GetAddress(index));
+        EmitEpilogue(emitter);
+    }
+
+    // the faulting access stored its index already
+    const size_t faultStub = emitter.GetPosition();
+    if (m_directMemory) {
+        emitter.Store32(CONTEXT, offsetof(JitContext, error),
+                        static_cast<uint32_t>(ExecutionError::INVALID_MEMORY_ACCESS));
+        EmitEpilogue(emitter);
+    }
+
+    uint8_t* entry = Install(emitter.GetCode());
+    if (entry == nullptr) {
+        return false;
+    }
+    m_native[block].code = reinterpret_cast<NativeCode>(entry);
+    m_native[block].length = length;
+    m_native[block].faultStub = entry + faultStub;
+    m_native[block].size = static_cast<uint32_t>(emitter.GetCode().size());
+    return true;
+}
+
+uint8_t* Jit::Install(const vector<uint8_t>& code)
+{
+    if (m_regions.empty() || m_regions.back().size - m_regions.back().used < code.size()) {
+        const size_t size = std::max(CODE_REGION_SIZE, code.size());
+        uint8_t* base = AllocateCode(size);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        m_regions.push_back({base, size, 0});
+    }
+
+    CodeRegion& region = m_regions.back();
+    if (!ProtectCode(region.base, region.size, false)) {
+        return nullptr;
+    }
+    uint8_t* entry = region.base + region.used;
+    std::memcpy(entry, code.data(), code.size());
+    if (!ProtectCode(region.base, region.size, true)) {
+        return nullptr;
+    }
+    // keep entries 16-byte aligned
+    region.used = std::min(region.size, (region.used + code.size() + 15) & ~static_cast<size_t>(15));
+    return entry;
+}
+
+void Jit::ReleaseCode()
+{
+    for (const CodeRegion& region : m_regions) {
+        FreeCode(region.base, region.size);
+    }
+    m_regions.clear();
+    m_discardedCode = 0;
+}
+
+void Jit::EmitPrologue(X86Emitter& emitter)
+{
+    emitter.Push(RBX);
+    emitter.Push(RBP);
+    emitter.Push(R12);
+    if (STACK_RESERVE != 0) {
+        emitter.Alu64(X86AluOperation::SUB, RSP, STACK_RESERVE);
+    }
+    emitter.Move64(CONTEXT, ARGUMENTS[0]);
+    emitter.Load64(GUEST_REGISTERS, CONTEXT, offsetof(JitContext, registers));
+    emitter.Load64(MEMORY_BASE, CONTEXT, offsetof(JitContext, memoryBase));
+}
+
+void Jit::EmitEpilogue(X86Emitter& emitter)
+{
+    if (STACK_RESERVE != 0) {
+        emitter.Alu64(X86AluOperation::ADD, RSP, STACK_RESERVE);
+    }
+    emitter.Pop(R12);
+    emitter.Pop(RBP);
+    emitter.Pop(RBX);
+    emitter.Ret();
+}
+
+void Jit::EmitMemoryAccess(X86Emitter& emitter, const DecodedInstruction& instruction, const uint32_t index) const
+{
+    // address in eax, the value to store in ecx
+    LoadRegister(emitter, RAX, instruction.rs1);
+    if (instruction.imm != 0) {
+        emitter.Alu32(X86AluOperation::ADD, RAX, instruction.imm);
+    }
+    const bool store = IsStore(instruction.operation);
+    if (store) {
+        LoadRegister(emitter, RCX, instruction.rs2);
+    }
+
+    if (m_directMemory) {
+        // no bounds check, an access outside the memory faults and continues at the fault stub
+        emitter.Store32(CONTEXT, offsetof(JitContext, errorIndex), index);
+        if (store) {
+            const uint8_t width = GetStoreWidth(instruction.operation);
+            emitter.StoreIndexed(width, MEMORY_BASE, RAX, 1, RCX);
+            // The store did not fault, so the pages of its first and last byte are inside the dirty map.
+            // Only the first store to a page since the dirty pages were last collected needs the memory to mark it
+            emitter.Move32(RCX, RAX);
+            emitter.Move32(RDX, RAX);
+            emitter.Alu32(X86AluOperation::ADD, RDX, width - 1);
+            emitter.Shift32(X86ShiftOperation::SHR, RCX, MEMORY_PAGE_BITS);
+            emitter.Shift32(X86ShiftOperation::SHR, RDX, MEMORY_PAGE_BITS);
+            emitter.Load64(R8, CONTEXT, offsetof(JitContext, dirtyPages));
+            emitter.CompareIndexed8(R8, RCX, 1, DIRTY_FLAGS);
+            const size_t firstClean = emitter.Jump(X86Condition::NE);
+            emitter.CompareIndexed8(R8, RDX, 1, DIRTY_FLAGS);
+            const size_t marked = emitter.Jump(X86Condition::E);
+            emitter.Bind(firstClean);
+            emitter.Move32(ARGUMENTS[2], static_cast<uint32_t>(width));
+            emitter.Move32(ARGUMENTS[1], RAX);
+            emitter.Move64(ARGUMENTS[0], CONTEXT);
+            emitter.Move64(RAX, HelperAddress(&JitMarkDirty));
+            emitter.Call(RAX);
+            emitter.Test32(RAX, 1);
+            const size_t unchanged = emitter.Jump(X86Condition::E);
+            emitter.Move32(RAX, GetAddress(index) + instruction.size);
+            EmitEpilogue(emitter);
+            emitter.Bind(marked);
+            emitter.Bind(unchanged);
+        }
+        else {
+            emitter.LoadIndexed(GetLoadType(instruction.operation), RAX, MEMORY_BASE, RAX, 1);
+        }
+        return;
+    }
+
+    // helper(context, address, value), rcx and rdx are argument registers themselves, so fill them last
+    emitter.Move32(ARGUMENTS[2], RCX);
+    emitter.Move32(ARGUMENTS[1], RAX);
+    emitter.Move64(ARGUMENTS[0], CONTEXT);
+    emitter.Move64(RAX, GetMemoryHelper(instruction.operation));
+    emitter.Call(RAX);
+
+    emitter.Compare32(CONTEXT, offsetof(JitContext, error), 0);
+    const size_t succeeded = emitter.Jump(X86Condition::E);
+    emitter.Store32(CONTEXT, offsetof(JitContext, errorIndex), index);
+    EmitEpilogue(emitter);
+    emitter.Bind(succeeded);
+    if (store) {
+        emitter.Test32(RAX, 1);
+        const size_t unchanged = emitter.Jump(X86Condition::E);
+        emitter.Store32(CONTEXT, offsetof(JitContext, errorIndex), index);
+        emitter.Move32(RAX, GetAddress(index) + instruction.size);
+        EmitEpilogue(emitter);
+        emitter.Bind(unchanged);
+    }
+}
+
+void Jit::EmitInstruction(X86Emitter& emitter, const DecodedInstruction& instruction, const uint32_t index) const
+{
+    const uint32_t next = GetAddress(index) + instruction.size;
+
+    switch (instruction.operation) {
+    case Operation::ADD:
+    case Operation::SUB:
+    case Operation::XOR:
+    case Operation::OR:
+    case Operation::AND:
+        {
+            X86AluOperation operation = X86AluOperation::ADD;
+            if (instruction.operation == Operation::SUB) {
+                operation = X86AluOperation::SUB;
+            }
+            else if (instruction.operation == Operation::XOR) {
+                operation = X86AluOperation::XOR;
+            }
+            else if (instruction.operation == Operation::OR) {
+                operation = X86AluOperation::OR;
+            }
+            else if (instruction.operation == Operation::AND) {
+                operation = X86AluOperation::AND;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Alu32(operation, RAX, RCX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SLL:
+    case Operation::SRL:
+    case Operation::SRA:
+    case Operation::ROL:
+    case Operation::ROR:
+        {
+            X86ShiftOperation operation = X86ShiftOperation::SHL;
+            if (instruction.operation == Operation::SRL) {
+                operation = X86ShiftOperation::SHR;
+            }
+            else if (instruction.operation == Operation::SRA) {
+                operation = X86ShiftOperation::SAR;
+            }
+            else if (instruction.operation == Operation::ROL) {
+                operation = X86ShiftOperation::ROL;
+            }
+            else if (instruction.operation == Operation::ROR) {
+                operation = X86ShiftOperation::ROR;
+            }
+            // RV32 uses the low 5 bits of the count, which is what the host shifts do too
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Shift32(operation, RAX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SLT:
+    case Operation::SLTU:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Alu32(X86AluOperation::CMP, RAX, RCX);
+            emitter.Set32(instruction.operation == Operation::SLT ? X86Condition::L : X86Condition::B, RAX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::ADDI:
+    case Operation::XORI:
+    case Operation::ORI:
+    case Operation::ANDI:
+        {
+            X86AluOperation operation = X86AluOperation::ADD;
+            if (instruction.operation == Operation::XORI) {
+                operation = X86AluOperation::XOR;
+            }
+            else if (instruction.operation == Operation::ORI) {
+                operation = X86AluOperation::OR;
+            }
+            else if (instruction.operation == Operation::ANDI) {
+                operation = X86AluOperation::AND;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            emitter.Alu32(operation, RAX, instruction.imm);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SLTI:
+    case Operation::SLTIU:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            emitter.Alu32(X86AluOperation::CMP, RAX, instruction.imm);
+            emitter.Set32(instruction.operation == Operation::SLTI ? X86Condition::L : X86Condition::B, RAX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SLLI:
+    case Operation::SRLI:
+    case Operation::SRAI:
+    case Operation::RORI:
+        {
+            X86ShiftOperation operation = X86ShiftOperation::SHL;
+            if (instruction.operation == Operation::SRLI) {
+                operation = X86ShiftOperation::SHR;
+            }
+            else if (instruction.operation == Operation::SRAI) {
+                operation = X86ShiftOperation::SAR;
+            }
+            else if (instruction.operation == Operation::RORI) {
+                operation = X86ShiftOperation::ROR;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            emitter.Shift32(operation, RAX, static_cast<uint8_t>(instruction.imm));
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::LB:
+    case Operation::LH:
+    case Operation::LW:
+    case Operation::LBU:
+    case Operation::LHU:
+        {
+            EmitMemoryAccess(emitter, instruction, index);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SB:
+    case Operation::SH:
+    case Operation::SW:
+        {
+            EmitMemoryAccess(emitter, instruction, index);
+            break;
+        }
+    case Operation::BEQ:
+    case Operation::BNE:
+    case Operation::BLT:
+    case Operation::BGE:
+    case Operation::BLTU:
+    case Operation::BGEU:
+        {
+            X86Condition condition = X86Condition::E;
+            if (instruction.operation == Operation::BNE) {
+                condition = X86Condition::NE;
+            }
+            else if (instruction.operation == Operation::BLT) {
+                condition = X86Condition::L;
+            }
+            else if (instruction.operation == Operation::BGE) {
+                condition = X86Condition::GE;
+            }
+            else if (instruction.operation == Operation::BLTU) {
+                condition = X86Condition::B;
+            }
+            else if (instruction.operation == Operation::BGEU) {
+                condition = X86Condition::AE;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Alu32(X86AluOperation::CMP, RAX, RCX);
+            const size_t taken = emitter.Jump(condition);
+            emitter.Move32(RAX, next);
+            EmitEpilogue(emitter);
+            emitter.Bind(taken);
+            emitter.Move32(RAX, instruction.target);
+            EmitEpilogue(emitter);
+            break;
+        }
+    case Operation::JAL:
+        {
+            StoreRegister(emitter, instruction.rd, next);
+            emitter.Move32(RAX, instruction.target);
+            EmitEpilogue(emitter);
+            break;
+        }
+    case Operation::JALR:
+        {
+            // rs1 is read before rd is written, they can be the same register
+            LoadRegister(emitter, RAX, instruction.rs1);
+            if (instruction.imm != 0) {
+                emitter.Alu32(X86AluOperation::ADD, RAX, instruction.imm);
+            }
+            emitter.Alu32(X86AluOperation::AND, RAX, ~1);
+            StoreRegister(emitter, instruction.rd, next);
+            EmitEpilogue(emitter);
+            break;
+        }
+    case Operation::LUI:
+        {
+            StoreRegister(emitter, instruction.rd, static_cast<uint32_t>(instruction.imm));
+            break;
+        }
+    case Operation::AUIPC:
+        {
+            StoreRegister(emitter, instruction.rd, instruction.target);
+            break;
+        }
+    case Operation::MUL:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.IMul32(RAX, RCX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::MULH:
+    case Operation::MULHU:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            if (instruction.operation == Operation::MULH) {
+                emitter.IMul32(RCX);
+            }
+            else {
+                emitter.Mul32(RCX);
+            }
+            StoreRegister(emitter, instruction.rd, RDX);
+            break;
+        }
+    case Operation::MULHSU:
+        {
+            // the unsigned high word, less rs2 where rs1 is negative
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Mul32(RCX);
+            LoadRegister(emitter, RAX, instruction.rs1);
+            emitter.Shift32(X86ShiftOperation::SAR, RAX, 31);
+            emitter.Alu32(X86AluOperation::AND, RAX, RCX);
+            emitter.Alu32(X86AluOperation::SUB, RDX, RAX);
+            StoreRegister(emitter, instruction.rd, RDX);
+            break;
+        }
+    case Operation::SH1ADD:
+    case Operation::SH2ADD:
+    case Operation::SH3ADD:
+        {
+            uint8_t amount = 1;
+            if (instruction.operation == Operation::SH2ADD) {
+                amount = 2;
+            }
+            else if (instruction.operation == Operation::SH3ADD) {
+                amount = 3;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Shift32(X86ShiftOperation::SHL, RAX, amount);
+            emitter.Alu32(X86AluOperation::ADD, RAX, RCX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::ANDN:
+    case Operation::ORN:
+    case Operation::XNOR:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            if (instruction.operation == Operation::XNOR) {
+                emitter.Alu32(X86AluOperation::XOR, RAX, RCX);
+                emitter.Not32(RAX);
+            }
+            else {
+                emitter.Not32(RCX);
+                emitter.Alu32(instruction.operation == Operation::ANDN ? X86AluOperation::AND : X86AluOperation::OR,
+                              RAX, RCX);
+            }
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::MIN:
+    case Operation::MINU:
+    case Operation::MAX:
+    case Operation::MAXU:
+        {
+            // take rs2 where rs1 is on the wrong side of it
+            X86Condition condition = X86Condition::G;
+            if (instruction.operation == Operation::MINU) {
+                condition = X86Condition::A;
+            }
+            else if (instruction.operation == Operation::MAX) {
+                condition = X86Condition::L;
+            }
+            else if (instruction.operation == Operation::MAXU) {
+                condition = X86Condition::B;
+            }
+            LoadRegister(emitter, RAX, instruction.rs1);
+            LoadRegister(emitter, RCX, instruction.rs2);
+            emitter.Alu32(X86AluOperation::CMP, RAX, RCX);
+            emitter.ConditionalMove32(condition, RAX, RCX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::SEXT_B:
+    case Operation::SEXT_H:
+    case Operation::ZEXT_H:
+    case Operation::REV8:
+        {
+            LoadRegister(emitter, RAX, instruction.rs1);
+            if (instruction.operation == Operation::SEXT_B) {
+                emitter.SignExtend8(RAX, RAX);
+            }
+            else if (instruction.operation == Operation::SEXT_H) {
+                emitter.SignExtend16(RAX, RAX);
+            }
+            else if (instruction.operation == Operation::ZEXT_H) {
+                emitter.ZeroExtend16(RAX, RAX);
+            }
+            else {
+                emitter.ByteSwap32(RAX);
+            }
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::CLZ:
+    case Operation::CTZ:
+    case Operation::CPOP:
+    case Operation::ORC_B:
+        {
+            // lzcnt, tzcnt and popcnt are not in baseline x86-64, the helpers compile to them where the host has them
+            uint64_t helper = HelperAddress(&BitManipulation::CountLeadingZeros);
+            if (instruction.operation == Operation::CTZ) {
+                helper = HelperAddress(&BitManipulation::CountTrailingZeros);
+            }
+            else if (instruction.operation == Operation::CPOP) {
+                helper = HelperAddress(&BitManipulation::PopCount);
+            }
+            else if (instruction.operation == Operation::ORC_B) {
+                helper = HelperAddress(&BitManipulation::OrCombineBytes);
+            }
+            LoadRegister(emitter, ARGUMENTS[0], instruction.rs1);
+            emitter.Move64(RAX, helper);
+            emitter.Call(RAX);
+            StoreRegister(emitter, instruction.rd, RAX);
+            break;
+        }
+    case Operation::FENCE_I:
+        {
+            emitter.Move64(ARGUMENTS[0], CONTEXT);
+            emitter.Move64(RAX, HelperAddress(&JitInvalidateCode));
+            emitter.Call(RAX);
+            emitter.Store32(CONTEXT, offsetof(JitContext, errorIndex), index);
+            emitter.Move32(RAX, next);
+            EmitEpilogue(emitter);
+            break;
+        }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef JIT_H
+#define JIT_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BlockCache.h"
+#include "X86Emitter.h"
+
+using std::vector;
+
+// State shared with the generated code, which addresses the fields by their offset
+struct JitContext
+{
+    uint32_t* registers;
+    Memory* memory;
+    // reserved memory accessed directly by the generated code, nullptr if it calls into Memory instead
+    uint8_t* memoryBase;
+    // where a faulting direct access of the running block continues
+    uint8_t* faultStub;
+    // Memory::GetDirtyMap, direct stores only call into Memory for pages that are not marked in it yet
+    uint8_t* dirtyPages;
+    // ExecutionError of the failing instruction, NONE as long as nothing failed
+    uint32_t error;
+    // op of the failing instruction, or of the store or FENCE.I the block was left after for changing the code
+    uint32_t errorIndex;
+};
+
+// Compiled block, returns the pc to continue at
+using NativeCode = uint32_t (*)(JitContext* context);
+
+struct NativeBlock
+{
+    // executions before the block got hot
+    uint32_t hits;
+    // whether compiling has been attempted, the block stays interpreted if it failed
+    bool translated;
+    NativeCode code;
+    // compiled instructions, the one after them could not be translated
+    uint32_t length;
+    uint8_t* faultStub;
+    // bytes of machine code
+    uint32_t size;
+};
+
+struct CodeRegion
+{
+    uint8_t* base;
+    size_t size;
+    size_t used;
+};
+
+// Block cache that compiles blocks to x86-64 machine code once they have been executed
+// threshold times. Instructions without a translation are executed by CPU::Step,
+// on other hosts nothing gets compiled and it behaves like the block cache.
+// With reserved memory of a whole number of pages loads and stores are single host accesses,
+// an access outside the memory faults and the fault handler turns it into INVALID_MEMORY_ACCESS.
+// A store to the code leaves the compiled block right after it, the blocks holding the changed code are
+// compiled again once they get hot again
+class Jit : public BlockCache
+{
+public:
+    explicit Jit(CPU* cpu, uint32_t threshold = 16);
+    ~Jit() override;
+    void Load() override;
+    RunResult Run(uint64_t maxInstructions) override;
+    static bool IsSupported();
+    uint32_t GetCompiledBlockCount() const;
+
+protected:
+    const ThreadedOp* ExecuteBlock(int32_t block, ThreadedContext& context, const ThreadedOp* op) override;
+    void Retranslate(int32_t block) override;
+
+private:
+    static bool CanTranslate(Operation operation);
+    static void EmitPrologue(X86Emitter& emitter);
+    static void EmitEpilogue(X86Emitter& emitter);
+    void EmitMemoryAccess(X86Emitter& emitter, const DecodedInstruction& instruction, uint32_t index) const;
+    void EmitInstruction(X86Emitter& emitter, const DecodedInstruction& instruction, uint32_t index) const;
+    bool UsesDirectMemory() const;
+    bool Compile(int32_t block);
+    uint8_t* Install(const vector<uint8_t>& code);
+    void ReleaseCode();
+    const ThreadedOp* Fallback(int32_t block, ThreadedContext& context, uint32_t pc);
+
+    uint32_t m_threshold;
+    // whether the compiled code accesses memory directly
+    bool m_directMemory;
+    JitContext m_context;
+    // indexed like m_blocks
+    vector<NativeBlock> m_native;
+    vector<CodeRegion> m_regions;
+    // bytes of dropped blocks still in the regions, all code is released once they fill a region
+    size_t m_discardedCode;
+};
+
+#endif // JIT_H
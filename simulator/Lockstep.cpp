@@ -0,0 +1,652 @@
+#include "Lockstep.h"
+
+#include <algorithm>
+
+#include "BitManipulation.h"
+#include "MultiplyDivide.h"
+
+Lockstep::Lockstep(const size_t lanes, const uint64_t memorySize, const MemoryBackend backend) :
+    m_lanes(lanes), m_registers((PC + 1) * lanes, 0), m_retired(lanes, 0), m_group(lanes, 0),
+    m_errors(lanes, ExecutionError::NONE), m_errorPcs(lanes, 0), m_failed(false), m_size(0)
+{
+    for (size_t lane = 0; lane < lanes; lane++) {
+        m_memories.push_back(new Memory(memorySize, backend));
+    }
+}
+
+Lockstep::~Lockstep()
+{
+    for (const Memory* memory : m_memories) {
+        delete memory;
+    }
+}
+
+void Lockstep::SetInstructions(const vector<uint32_t>& instructions)
+{
+    m_program = Decoder::DecodeProgram(instructions);
+    const span code(reinterpret_cast<const uint8_t*>(instructions.data()), instructions.size() * sizeof(uint32_t));
+    for (Memory* memory : m_memories) {
+        if (memory->GetSize() < code.size()) {
+            memory->Resize(code.size());
+        }
+        memory->WriteRange(0, code);
+        memory->AddToResetImage(0, code);
+    }
+}
+
+size_t Lockstep::GetLaneCount() const { return m_lanes; }
+
+uint32_t Lockstep::GetRegister(const size_t lane, const uint8_t reg) const
+{
+    return m_registers[reg * m_lanes + lane];
+}
+
+void Lockstep::SetRegister(const size_t lane, const uint8_t reg, const uint32_t value)
+{
+    // x0 is hardwired to 0
+    if (reg != 0) {
+        m_registers[reg * m_lanes + lane] = value;
+    }
+}
+
+uint64_t Lockstep::GetRetired(const size_t lane) const { return m_retired[lane]; }
+
+Memory& Lockstep::GetMemory(const size_t lane) { return *m_memories[lane]; }
+
+void Lockstep::Reset()
+{
+    std::ranges::fill(m_registers, 0);
+    std::ranges::fill(m_retired, 0);
+    for (Memory* memory : m_memories) {
+        memory->Reset();
+    }
+}
+
+vector<RunResult> Lockstep::Run(const uint64_t maxInstructions)
+{
+    const uint64_t end = static_cast<uint64_t>(m_program.size()) * INSTRUCTION_ALIGNMENT;
+    const uint32_t* pcs = GetRow(PC);
+    vector<uint64_t> executed(m_lanes, 0);
+    vector<uint8_t> running(m_lanes, 0);
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        running[lane] = pcs[lane] < end && maxInstructions > 0;
+        m_errors[lane] = ExecutionError::NONE;
+    }
+
+    while (true) {
+        // the lanes furthest behind go next
+        uint32_t pc = UINT32_MAX;
+        for (size_t lane = 0; lane < m_lanes; lane++) {
+            pc = std::min(pc, running[lane] ? pcs[lane] : UINT32_MAX);
+        }
+        if (pc == UINT32_MAX) {
+            break;
+        }
+        // the next lanes ahead, and how far the group may go before one of its lanes reaches the limit
+        uint32_t ahead = UINT32_MAX;
+        uint64_t budget = UINT64_MAX;
+        for (size_t lane = 0; lane < m_lanes; lane++) {
+            const bool member = running[lane] && pcs[lane] == pc;
+            m_group[lane] = member ? UINT32_MAX : 0;
+            ahead = std::min(ahead, running[lane] && !member ? pcs[lane] : UINT32_MAX);
+            budget = std::min(budget, member ? maxInstructions - executed[lane] : UINT64_MAX);
+        }
+
+        // Straight-line code keeps the group together, so it goes on without looking at the lanes again until
+        // control flow, a failure, or the lanes ahead, which join the group there
+        uint64_t count = 0;
+        m_failed = false;
+        while (true) {
+            const DecodedInstruction& instruction = m_program[pc / INSTRUCTION_ALIGNMENT];
+            Execute(instruction, pc);
+            count++;
+            pc += instruction.size;
+            if (m_failed || IsControlFlow(instruction.operation) || pc >= ahead || pc >= end || count == budget) {
+                break;
+            }
+        }
+
+        for (size_t lane = 0; lane < m_lanes; lane++) {
+            if (m_group[lane] != 0) {
+                executed[lane] += count;
+                running[lane] = pcs[lane] < end && executed[lane] < maxInstructions;
+            }
+            else if (running[lane] && m_errors[lane] != ExecutionError::NONE) {
+                // failed at the last instruction
+                executed[lane] += count - 1;
+                running[lane] = false;
+            }
+        }
+    }
+
+    vector<RunResult> results(m_lanes);
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        if (m_errors[lane] != ExecutionError::NONE) {
+            results[lane] = {executed[lane], m_errors[lane], pcs[lane], m_errorPcs[lane],
+                             StopReason::INSTRUCTION_FAILED};
+            continue;
+        }
+        m_retired[lane] += executed[lane];
+        if (pcs[lane] >= end) {
+            results[lane] = {executed[lane], ExecutionError::PC_OUT_OF_BOUNDS, pcs[lane], 0, StopReason::HALTED};
+        }
+        else {
+            results[lane] = {executed[lane], ExecutionError::NONE, pcs[lane], 0, StopReason::LIMIT_REACHED};
+        }
+    }
+    return results;
+}
+
+bool Lockstep::IsControlFlow(const Operation operation)
+{
+    return (operation >= Operation::BEQ && operation <= Operation::JALR) || operation == Operation::UNSUPPORTED;
+}
+
+uint32_t* Lockstep::GetRow(const uint8_t reg) { return m_registers.data() + reg * m_lanes; }
+
+template <typename Function>
+void Lockstep::SetResult(const uint8_t rd, Function function)
+{
+    if (rd != 0) {
+        uint32_t* result = GetRow(rd);
+        const uint32_t* group = m_group.data();
+        // branchless so it is vectorized, lanes outside the group keep their value
+        for (size_t lane = 0; lane < m_lanes; lane++) {
+            result[lane] = (function(lane) & group[lane]) | (result[lane] & ~group[lane]);
+        }
+    }
+    AdvancePC();
+}
+
+template <typename Condition>
+void Lockstep::Branch(const DecodedInstruction& instruction, Condition condition)
+{
+    const uint32_t* a = GetRow(instruction.rs1);
+    const uint32_t* b = GetRow(instruction.rs2);
+    uint32_t* pcs = GetRow(PC);
+    const uint32_t* group = m_group.data();
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        const uint32_t next = condition(a[lane], b[lane]) ? instruction.target : pcs[lane] + instruction.size;
+        pcs[lane] = (next & group[lane]) | (pcs[lane] & ~group[lane]);
+    }
+}
+
+template <typename T>
+void Lockstep::LoadValue(const DecodedInstruction& instruction)
+{
+    const uint32_t* base = GetRow(instruction.rs1);
+    uint32_t* pcs = GetRow(PC);
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        if (m_group[lane] == 0) {
+            continue;
+        }
+        T value;
+        if (!m_memories[lane]->Load(base[lane] + instruction.imm, value)) {
+            Fail(lane, ExecutionError::INVALID_MEMORY_ACCESS, pcs[lane]);
+            continue;
+        }
+        // sign or zero extended by the type
+        SetRegister(lane, instruction.rd, static_cast<uint32_t>(value));
+        pcs[lane] += m_size;
+    }
+}
+
+template <typename T>
+void Lockstep::StoreValue(const DecodedInstruction& instruction)
+{
+    const uint32_t* base = GetRow(instruction.rs1);
+    const uint32_t* values = GetRow(instruction.rs2);
+    uint32_t* pcs = GetRow(PC);
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        if (m_group[lane] == 0) {
+            continue;
+        }
+        if (!m_memories[lane]->Store(base[lane] + instruction.imm, static_cast<T>(values[lane]))) {
+            Fail(lane, ExecutionError::INVALID_MEMORY_ACCESS, pcs[lane]);
+            continue;
+        }
+        pcs[lane] += m_size;
+    }
+}
+
+template <typename Function>
+void Lockstep::Divide(const DecodedInstruction& instruction, Function function)
+{
+    const uint32_t* a = GetRow(instruction.rs1);
+    const uint32_t* b = GetRow(instruction.rs2);
+    uint32_t* pcs = GetRow(PC);
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        if (m_group[lane] == 0) {
+            continue;
+        }
+        if (b[lane] == 0) {
+            Fail(lane, ExecutionError::DIVISION_BY_ZERO, pcs[lane]);
+            continue;
+        }
+        SetRegister(lane, instruction.rd, function(a[lane], b[lane]));
+        pcs[lane] += m_size;
+    }
+}
+
+void Lockstep::Fail(const size_t lane, const ExecutionError error, const uint32_t pc)
+{
+    m_failed = true;
+    m_group[lane] = 0;
+    m_errors[lane] = error;
+    m_errorPcs[lane] = pc;
+    for (uint8_t reg = 0; reg <= PC; reg++) {
+        m_registers[reg * m_lanes + lane] = 0;
+    }
+    m_retired[lane] = 0;
+}
+
+void Lockstep::AdvancePC()
+{
+    uint32_t* pcs = GetRow(PC);
+    const uint32_t* group = m_group.data();
+    for (size_t lane = 0; lane < m_lanes; lane++) {
+        pcs[lane] += m_size & group[lane];
+    }
+}
+
+void Lockstep::Execute(const DecodedInstruction& instruction, const uint32_t pc)
+{
+    const uint32_t* a = GetRow(instruction.rs1);
+    const uint32_t* b = GetRow(instruction.rs2);
+    const auto imm = static_cast<uint32_t>(instruction.imm);
+    m_size = instruction.size;
+
+    switch (instruction.operation) {
+    case Operation::ADD:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] + b[lane]; });
+            break;
+        }
+    case Operation::SUB:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] - b[lane]; });
+            break;
+        }
+    case Operation::SLL:
+        {
+            // only the low 5 bits count, like the shift instructions of the host
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] << (b[lane] & 31); });
+            break;
+        }
+    case Operation::SLT:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return static_cast<uint32_t>(static_cast<int32_t>(a[lane]) < static_cast<int32_t>(b[lane]));
+            });
+            break;
+        }
+    case Operation::SLTU:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return static_cast<uint32_t>(a[lane] < b[lane]); });
+            break;
+        }
+    case Operation::XOR:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] ^ b[lane]; });
+            break;
+        }
+    case Operation::SRL:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] >> (b[lane] & 31); });
+            break;
+        }
+    case Operation::SRA:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return static_cast<uint32_t>(static_cast<int32_t>(a[lane]) >> (b[lane] & 31));
+            });
+            break;
+        }
+    case Operation::OR:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] | b[lane]; });
+            break;
+        }
+    case Operation::AND:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return a[lane] & b[lane]; });
+            break;
+        }
+    case Operation::ADDI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] + imm; });
+            break;
+        }
+    case Operation::SLTI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) {
+                return static_cast<uint32_t>(static_cast<int32_t>(a[lane]) < static_cast<int32_t>(imm));
+            });
+            break;
+        }
+    case Operation::SLTIU:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return static_cast<uint32_t>(a[lane] < imm); });
+            break;
+        }
+    case Operation::XORI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] ^ imm; });
+            break;
+        }
+    case Operation::ORI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] | imm; });
+            break;
+        }
+    case Operation::ANDI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] & imm; });
+            break;
+        }
+    case Operation::SLLI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] << (imm & 31); });
+            break;
+        }
+    case Operation::SRLI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) { return a[lane] >> (imm & 31); });
+            break;
+        }
+    case Operation::SRAI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) {
+                return static_cast<uint32_t>(static_cast<int32_t>(a[lane]) >> (imm & 31));
+            });
+            break;
+        }
+    case Operation::LB:
+        {
+            LoadValue<int8_t>(instruction);
+            break;
+        }
+    case Operation::LH:
+        {
+            LoadValue<int16_t>(instruction);
+            break;
+        }
+    case Operation::LW:
+        {
+            LoadValue<uint32_t>(instruction);
+            break;
+        }
+    case Operation::LBU:
+        {
+            LoadValue<uint8_t>(instruction);
+            break;
+        }
+    case Operation::LHU:
+        {
+            LoadValue<uint16_t>(instruction);
+            break;
+        }
+    case Operation::SB:
+        {
+            StoreValue<uint8_t>(instruction);
+            break;
+        }
+    case Operation::SH:
+        {
+            StoreValue<uint16_t>(instruction);
+            break;
+        }
+    case Operation::SW:
+        {
+            StoreValue<uint32_t>(instruction);
+            break;
+        }
+    case Operation::BEQ:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) { return x == y; });
+            break;
+        }
+    case Operation::BNE:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) { return x != y; });
+            break;
+        }
+    case Operation::BLT:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) {
+                return static_cast<int32_t>(x) < static_cast<int32_t>(y);
+            });
+            break;
+        }
+    case Operation::BGE:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) {
+                return static_cast<int32_t>(x) >= static_cast<int32_t>(y);
+            });
+            break;
+        }
+    case Operation::BLTU:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) { return x < y; });
+            break;
+        }
+    case Operation::BGEU:
+        {
+            Branch(instruction, [](const uint32_t x, const uint32_t y) { return x >= y; });
+            break;
+        }
+    case Operation::JAL:
+        {
+            // every lane of the group is at pc
+            SetResult(instruction.rd, [pc, &instruction](size_t) { return pc + instruction.size; });
+            uint32_t* pcs = GetRow(PC);
+            for (size_t lane = 0; lane < m_lanes; lane++) {
+                pcs[lane] = (instruction.target & m_group[lane]) | (pcs[lane] & ~m_group[lane]);
+            }
+            break;
+        }
+    case Operation::JALR:
+        {
+            uint32_t* pcs = GetRow(PC);
+            for (size_t lane = 0; lane < m_lanes; lane++) {
+                if (m_group[lane] == 0) {
+                    continue;
+                }
+                // rs1 is read before rd is written, they can be the same register
+                pcs[lane] = (a[lane] + imm) & ~1u;
+                SetRegister(lane, instruction.rd, pc + instruction.size);
+            }
+            break;
+        }
+    case Operation::LUI:
+        {
+            SetResult(instruction.rd, [imm](size_t) { return imm; });
+            break;
+        }
+    case Operation::AUIPC:
+        {
+            SetResult(instruction.rd, [&instruction](size_t) { return instruction.target; });
+            break;
+        }
+    case Operation::MUL:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return MultiplyDivide::Mul(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::MULH:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return MultiplyDivide::MulHigh(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::MULHSU:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return MultiplyDivide::MulHighSignedUnsigned(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::MULHU:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return MultiplyDivide::MulHighUnsigned(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::DIV:
+        {
+            Divide(instruction, MultiplyDivide::Div);
+            break;
+        }
+    case Operation::DIVU:
+        {
+            Divide(instruction, MultiplyDivide::DivUnsigned);
+            break;
+        }
+    case Operation::REM:
+        {
+            Divide(instruction, MultiplyDivide::Rem);
+            break;
+        }
+    case Operation::REMU:
+        {
+            Divide(instruction, MultiplyDivide::RemUnsigned);
+            break;
+        }
+    case Operation::SH1ADD:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::ShiftAdd<1>(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::SH2ADD:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::ShiftAdd<2>(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::SH3ADD:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::ShiftAdd<3>(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::ANDN:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return BitManipulation::AndNot(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::ORN:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return BitManipulation::OrNot(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::XNOR:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return BitManipulation::XorNot(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::MIN:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return BitManipulation::Min(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::MINU:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::MinUnsigned(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::MAX:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) { return BitManipulation::Max(a[lane], b[lane]); });
+            break;
+        }
+    case Operation::MAXU:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::MaxUnsigned(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::ROL:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::RotateLeft(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::ROR:
+        {
+            SetResult(instruction.rd, [a, b](const size_t lane) {
+                return BitManipulation::RotateRight(a[lane], b[lane]);
+            });
+            break;
+        }
+    case Operation::RORI:
+        {
+            SetResult(instruction.rd, [a, imm](const size_t lane) {
+                return BitManipulation::RotateRight(a[lane], imm);
+            });
+            break;
+        }
+    case Operation::CLZ:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::CountLeadingZeros(a[lane]); });
+            break;
+        }
+    case Operation::CTZ:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::CountTrailingZeros(a[lane]); });
+            break;
+        }
+    case Operation::CPOP:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::PopCount(a[lane]); });
+            break;
+        }
+    case Operation::SEXT_B:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::SignExtendByte(a[lane]); });
+            break;
+        }
+    case Operation::SEXT_H:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::SignExtendHalf(a[lane]); });
+            break;
+        }
+    case Operation::ZEXT_H:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::ZeroExtendHalf(a[lane]); });
+            break;
+        }
+    case Operation::ORC_B:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::OrCombineBytes(a[lane]); });
+            break;
+        }
+    case Operation::REV8:
+        {
+            SetResult(instruction.rd, [a](const size_t lane) { return BitManipulation::ReverseBytes(a[lane]); });
+            break;
+        }
+    case Operation::FENCE:
+    case Operation::FENCE_I:
+        {
+            AdvancePC();
+            break;
+        }
+    default:
+        {
+            for (size_t lane = 0; lane < m_lanes; lane++) {
+                if (m_group[lane] != 0) {
+                    Fail(lane, ExecutionError::UNSUPPORTED_OPCODE, pc);
+                }
+            }
+            break;
+        }
+    }
+}
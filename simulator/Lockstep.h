@@ -0,0 +1,78 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+#include <cstdint>
+#include <vector>
+
+#include "CPUUtil.h"
+#include "Decoder.h"
+#include "Memory.h"
+#include "Registers.h"
+
+using std::vector;
+
+// Runs one program in many instances, lanes, at once, such as the same program over many inputs. Each lane has
+// registers and memory of its own. The registers are stored one register for all lanes after the other, so an
+// instruction is executed for every lane that is at it in one loop over contiguous values, which the compiler
+// turns into SIMD code for the arithmetic. Lanes that branch differently are executed in groups by pc, the lowest
+// first, which lets the ones behind catch up so they run together again once their paths meet
+class Lockstep
+{
+public:
+    Lockstep(size_t lanes, uint64_t memorySize, MemoryBackend backend = MemoryBackend::PAGED);
+    ~Lockstep();
+    // the memories are tied to the object
+    Lockstep(const Lockstep&) = delete;
+    Lockstep& operator=(const Lockstep&) = delete;
+    // Writes the code to every lane's memory like Simulator::SetInstructions. It is decoded once for all lanes,
+    // stores to it are not seen and FENCE.I does nothing
+    void SetInstructions(const vector<uint32_t>& instructions);
+    size_t GetLaneCount() const;
+    // PC is register 32
+    uint32_t GetRegister(size_t lane, uint8_t reg) const;
+    void SetRegister(size_t lane, uint8_t reg, uint32_t value);
+    uint64_t GetRetired(size_t lane) const;
+    Memory& GetMemory(size_t lane);
+    // registers and memories of all lanes
+    void Reset();
+    // Runs every lane until it ends, fails or has executed maxInstructions, with the same result
+    // and state per lane as CPU::Run
+    vector<RunResult> Run(uint64_t maxInstructions);
+
+private:
+    // instructions that may leave the group at different pcs
+    static bool IsControlFlow(Operation operation);
+    uint32_t* GetRow(uint8_t reg);
+    void Execute(const DecodedInstruction& instruction, uint32_t pc);
+    // writes the value for each lane of the group to rd, moves them to the next instruction
+    template <typename Function>
+    void SetResult(uint8_t rd, Function function);
+    template <typename Condition>
+    void Branch(const DecodedInstruction& instruction, Condition condition);
+    template <typename T>
+    void LoadValue(const DecodedInstruction& instruction);
+    template <typename T>
+    void StoreValue(const DecodedInstruction& instruction);
+    template <typename Function>
+    void Divide(const DecodedInstruction& instruction, Function function);
+    // takes the lane out of the group and resets its registers like a failing CPU
+    void Fail(size_t lane, ExecutionError error, uint32_t pc);
+    void AdvancePC();
+
+    size_t m_lanes;
+    vector<DecodedInstruction> m_program;
+    // register reg of lane is at reg * m_lanes + lane
+    vector<uint32_t> m_registers;
+    vector<uint64_t> m_retired;
+    vector<Memory*> m_memories;
+    // all ones for the lanes executing the current instruction
+    vector<uint32_t> m_group;
+    // only valid for lanes that have failed during Run, NONE for the others
+    vector<ExecutionError> m_errors;
+    vector<uint32_t> m_errorPcs;
+    // a lane has failed during the current instruction
+    bool m_failed;
+    // bytes of the current instruction
+    uint32_t m_size;
+};
+
+#endif // LOCKSTEP_H
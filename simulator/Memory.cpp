@@ -1,52 +1,668 @@
 #include "Memory.h"
 
-Memory::Memory() { Resize(256); }
+#include <algorithm>
 
-Memory::Memory(const uint32_t size) { Resize(size); }
+#ifdef MEMORY_RESERVATION
+#include <sys/mman.h>
 
-vector<uint32_t> Memory::GetMemory() { return m_memory; }
+// the page after the address space catches accesses that start in it and run past its end
+constexpr uint64_t RESERVATION_SIZE = ADDRESS_SPACE_SIZE + MEMORY_PAGE_SIZE;
+#endif
 
-uint32_t Memory::Read(const uint32_t address) const
+// what pages that have never been written are viewed as
+alignas(MEMORY_PAGE_SIZE) static const uint8_t ZERO_PAGE[MEMORY_PAGE_SIZE] = {};
+
+Memory::Memory() : Memory(1024) {}
+
+Memory::Memory(const uint64_t size, const MemoryBackend backend) :
+    m_size(0), m_reserved(nullptr), m_image(), m_pageCount(0), m_codeBegin(0), m_codeEnd(0),
+    m_codeChangeBegin(UINT64_MAX), m_codeChangeEnd(0)
 {
-    if (address >= m_size) {
-        return 0;
+    FlushTlb();
+    if (backend == MemoryBackend::RESERVED) {
+        Reserve();
     }
-    return m_memory[address];
+    Resize(size);
 }
 
-uint16_t Memory::ReadHalfWord(const uint32_t address) const
+Memory::~Memory() { Release(); }
+
+bool Memory::IsReservationSupported()
+{
+#ifdef MEMORY_RESERVATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemoryBackend Memory::GetBackend() const
+{
+    return m_reserved != nullptr ? MemoryBackend::RESERVED : MemoryBackend::PAGED;
+}
+
+uint8_t* Memory::GetReservedBase() const { return m_reserved; }
+
+vector<uint32_t> Memory::GetMemory() const
 {
+    vector<uint32_t> words((m_size + 3) / 4, 0);
+    ReadBytes(0, reinterpret_cast<uint8_t*>(words.data()), m_size);
+    return words;
+}
+
+MemoryPageView Memory::ViewPage(const uint32_t address) const
+{
+    const uint32_t pageAddress = address & ~(MEMORY_PAGE_SIZE - 1);
     if (address >= m_size) {
-        return 0;
+        return {pageAddress, {}};
+    }
+
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(MEMORY_PAGE_SIZE, m_size - pageAddress));
+    if (m_reserved != nullptr) {
+        return {pageAddress, {m_reserved + pageAddress, size}};
+    }
+    const uint8_t* page = FindPage(address >> MEMORY_PAGE_BITS);
+    return {pageAddress, {page != nullptr ? page : ZERO_PAGE, size}};
+}
+
+MemoryPages Memory::GetPages() const
+{
+    return {MemoryPageIterator(this, FindNextPage(0)), MemoryPageIterator(this, GetPageEnd())};
+}
+
+vector<MemoryPageView> Memory::CollectDirtyPages()
+{
+    // only written pages can have changed
+    vector<uint32_t> changed;
+    for (const uint32_t page : m_written) {
+        if ((m_dirty[page] & DIRTY_CHANGED) != 0) {
+            m_dirty[page] &= ~DIRTY_CHANGED;
+            changed.push_back(page);
+        }
+    }
+    std::ranges::sort(changed);
+
+    vector<MemoryPageView> pages;
+    pages.reserve(changed.size());
+    for (const uint32_t page : changed) {
+        pages.push_back(ViewPage(page << MEMORY_PAGE_BITS));
+    }
+    return pages;
+}
+
+uint8_t* Memory::GetDirtyMap() { return m_dirty.data(); }
+
+void Memory::MarkDirtyRange(const uint32_t address, const uint64_t size)
+{
+    const uint64_t end = static_cast<uint64_t>(address) + std::max<uint64_t>(size, 1);
+    for (uint64_t from = address; from < end;) {
+        const uint64_t to = std::min(end, (from | (MEMORY_PAGE_SIZE - 1)) + 1);
+        MarkDirty(static_cast<uint32_t>(from), static_cast<uint32_t>(to - from));
+        from = to;
+    }
+}
+
+MemorySnapshot Memory::Snapshot() const
+{
+    MemorySnapshot snapshot{m_size, {}};
+    if (m_reserved != nullptr) {
+        // the host owns these pages, copy the written ones and share what is left of the image
+        for (const uint32_t page : m_written) {
+            const MemoryPageView view = ViewPage(page << MEMORY_PAGE_BITS);
+            std::shared_ptr<uint8_t[]> copy = std::make_shared<uint8_t[]>(MEMORY_PAGE_SIZE);
+            std::ranges::copy(view.bytes, copy.get());
+            snapshot.pages.emplace_back(page, std::move(copy));
+        }
+        for (const auto& [page, data] : m_image.pages) {
+            if ((m_dirty[page] & DIRTY_WRITTEN) == 0) {
+                snapshot.pages.emplace_back(page, data);
+            }
+        }
+        std::ranges::sort(snapshot.pages, {}, &SnapshotPage::first);
+        return snapshot;
+    }
+
+    snapshot.pages.reserve(m_pageCount);
+    for (uint64_t page = FindNextPage(0); page < GetPageEnd(); page = FindNextPage(page + 1)) {
+        snapshot.pages.emplace_back(static_cast<uint32_t>(page), *FindSlot(static_cast<uint32_t>(page)));
+    }
+    // the pages are shared now, stores have to go through GetPageInTable to copy them first
+    FlushTlb();
+    return snapshot;
+}
+
+void Memory::Restore(const MemorySnapshot& snapshot)
+{
+    if (snapshot.size != m_size) {
+        Resize(snapshot.size);
+    }
+
+    // the pages that can change are the written ones, the image and those of the snapshot
+    const auto compareCode = [this, &snapshot](const uint32_t page) {
+        if (page < m_dirty.size() && (m_dirty[page] & CODE_PAGE) != 0) {
+            const auto found = std::ranges::lower_bound(snapshot.pages, page, {}, &SnapshotPage::first);
+            CompareCode(page, found != snapshot.pages.end() && found->first == page ? found->second.get() : ZERO_PAGE);
+        }
+    };
+    std::ranges::for_each(m_written, compareCode);
+    std::ranges::for_each(m_image.pages, compareCode, &SnapshotPage::first);
+    std::ranges::for_each(snapshot.pages, compareCode, &SnapshotPage::first);
+
+    // clear out everything the written pages and the image put there
+    if (m_reserved != nullptr) {
+        for (const uint32_t page : m_written) {
+            const MemoryPageView view = ViewPage(page << MEMORY_PAGE_BITS);
+            std::fill(m_reserved + view.address, m_reserved + view.address + view.bytes.size(), 0);
+        }
+        for (const auto& [page, data] : m_image.pages) {
+            const MemoryPageView view = ViewPage(page << MEMORY_PAGE_BITS);
+            std::fill(m_reserved + view.address, m_reserved + view.address + view.bytes.size(), 0);
+        }
+    }
+    else {
+        for (auto& table : m_directory) {
+            table.reset();
+        }
+        m_pageCount = 0;
+    }
+    for (const uint32_t page : m_written) {
+        m_dirty[page] &= CODE_PAGE;
+    }
+    m_written.clear();
+
+    for (const auto& [page, data] : snapshot.pages) {
+        if (m_reserved != nullptr) {
+            const uint64_t address = static_cast<uint64_t>(page) << MEMORY_PAGE_BITS;
+            std::memcpy(m_reserved + address, data.get(), std::min<uint64_t>(MEMORY_PAGE_SIZE, m_size - address));
+        }
+        else {
+            // never written through while the snapshot holds it, GetPageInTable copies it first
+            GetSlot(page) = std::const_pointer_cast<uint8_t[]>(data);
+            m_pageCount++;
+        }
+        MarkWritten(page);
     }
-    return static_cast<uint16_t>(m_memory[address]);
+    // whatever the snapshot holds, the next reset has to bring the image back
+    for (const auto& [page, data] : m_image.pages) {
+        MarkWritten(page);
+    }
+    FlushTlb();
+}
+
+void Memory::SetResetImage()
+{
+    m_image = Snapshot();
+    for (const uint32_t page : m_written) {
+        m_dirty[page] &= CODE_PAGE;
+    }
+    m_written.clear();
+}
+
+void Memory::ClearResetImage() { DropResetImage(); }
+
+bool Memory::AddToResetImage(const uint32_t address, const span<const uint8_t> data)
+{
+    if (!Contains(address, data.size())) {
+        return false;
+    }
+    // the image is written by going through a reset, the current contents come back afterwards
+    const MemorySnapshot current = Snapshot();
+    Reset();
+    WriteBytes(address, data.data(), data.size());
+    SetResetImage();
+    Restore(current);
+    return true;
+}
+
+bool Memory::ReadResetImage(uint32_t address, span<uint8_t> data) const
+{
+    if (!Contains(address, data.size())) {
+        return false;
+    }
+    while (!data.empty()) {
+        const uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+        const size_t chunk = std::min<size_t>(data.size(), MEMORY_PAGE_SIZE - offset);
+        const std::shared_ptr<const uint8_t[]>* image = FindImagePage(address >> MEMORY_PAGE_BITS);
+        if (image != nullptr) {
+            std::memcpy(data.data(), image->get() + offset, chunk);
+        }
+        else {
+            std::fill_n(data.data(), chunk, 0);
+        }
+        address += static_cast<uint32_t>(chunk);
+        data = data.subspan(chunk);
+    }
+    return true;
+}
+
+bool Memory::MapFile(const int descriptor, const uint64_t offset, const uint32_t page, const uint32_t count)
+{
+#ifdef MEMORY_RESERVATION
+    if (m_reserved == nullptr || static_cast<uint64_t>(page) + count > GetPageEnd()) {
+        return false;
+    }
+    const uint64_t from = static_cast<uint64_t>(page) << MEMORY_PAGE_BITS;
+    const uint64_t to = static_cast<uint64_t>(page + count) << MEMORY_PAGE_BITS;
+    void* mapped = mmap(m_reserved + from, to - from, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, descriptor,
+                        static_cast<off_t>(offset));
+    if (mapped == MAP_FAILED) {
+        // a failed fixed mapping may have taken the old pages with it
+        RemapReserved(from, to, true);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        MarkWritten(page + i);
+    }
+    RecordCodeChange(from, to - from);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Memory::ReadRange(const uint32_t address, const span<uint8_t> data) const
+{
+    if (!Contains(address, data.size())) {
+        return false;
+    }
+    ReadBytes(address, data.data(), data.size());
+    return true;
+}
+
+bool Memory::WriteRange(const uint32_t address, const span<const uint8_t> data)
+{
+    if (!Contains(address, data.size())) {
+        return false;
+    }
+    WriteBytes(address, data.data(), data.size());
+    return true;
+}
+
+uint32_t Memory::Read(const uint32_t address) const
+{
+    uint32_t value = 0;
+    Load(address, value);
+    return value;
+}
+
+uint16_t Memory::ReadHalfWord(const uint32_t address) const
+{
+    uint16_t value = 0;
+    Load(address, value);
+    return value;
 }
 
 uint8_t Memory::ReadByte(const uint32_t address) const
 {
-    if (address >= m_size) {
-        return 0;
+    uint8_t value = 0;
+    Load(address, value);
+    return value;
+}
+
+void Memory::Write(const uint32_t address, const uint32_t value) { Store(address, value); }
+
+void Memory::Reset()
+{
+    for (const uint32_t page : m_written) {
+        const std::shared_ptr<const uint8_t[]>* image = FindImagePage(page);
+        if ((m_dirty[page] & CODE_PAGE) != 0) {
+            CompareCode(page, image != nullptr ? image->get() : ZERO_PAGE);
+        }
+        if (m_reserved != nullptr) {
+            const MemoryPageView view = ViewPage(page << MEMORY_PAGE_BITS);
+            uint8_t* data = m_reserved + view.address;
+            if (image != nullptr) {
+                std::memcpy(data, image->get(), view.bytes.size());
+            }
+            else {
+                std::fill(data, data + view.bytes.size(), 0);
+            }
+        }
+        else {
+            // the image pages are shared again, everything else is released
+            Page& slot = GetSlot(page);
+            if (slot != nullptr) {
+                m_pageCount--;
+            }
+            if (image != nullptr) {
+                slot = std::const_pointer_cast<uint8_t[]>(*image);
+                m_pageCount++;
+            }
+            else {
+                slot.reset();
+            }
+        }
+        m_dirty[page] &= CODE_PAGE;
     }
-    return static_cast<uint8_t>(m_memory[address]);
+    m_written.clear();
+    FlushTlb();
 }
 
-void Memory::Write(const uint32_t address, const uint32_t value)
+void Memory::Resize(const uint64_t size)
 {
-    if (address >= m_size) {
+    const uint64_t newSize = std::min(size, ADDRESS_SPACE_SIZE);
+    DropResetImage();
+    const uint64_t pages = RoundUpToPage(newSize) >> MEMORY_PAGE_BITS;
+    std::erase_if(m_written, [pages](const uint32_t page) { return page >= pages; });
+    m_dirty.resize(pages, 0);
+    MarkCodePages(m_codeBegin, m_codeEnd, true);
+    if (newSize < m_codeEnd) {
+        // fetching there fails from now on
+        RecordCodeChange(newSize, m_codeEnd - newSize);
+    }
+    if (m_reserved != nullptr) {
+        if (newSize < m_size) {
+            RemapReserved(RoundUpToPage(newSize), RoundUpToPage(m_size), false);
+            std::fill(m_reserved + newSize, m_reserved + RoundUpToPage(newSize), 0);
+        }
+        else {
+            RemapReserved(RoundUpToPage(m_size), RoundUpToPage(newSize), true);
+        }
+        m_size = newSize;
         return;
     }
-    m_memory[address] = value;
+    if (newSize < m_size) {
+        // drop everything past the end, so growing again shows zeros
+        const uint64_t firstPage = (newSize + MEMORY_PAGE_SIZE - 1) >> MEMORY_PAGE_BITS;
+        for (uint64_t page = firstPage; page < (m_size + MEMORY_PAGE_SIZE - 1) >> MEMORY_PAGE_BITS; page++) {
+            const std::unique_ptr<PageTable>& table = m_directory[page >> TABLE_BITS];
+            if (table != nullptr && (*table)[page % TABLE_SIZE] != nullptr) {
+                (*table)[page % TABLE_SIZE].reset();
+                m_pageCount--;
+            }
+        }
+        const uint32_t offset = newSize & (MEMORY_PAGE_SIZE - 1);
+        const uint32_t lastPage = static_cast<uint32_t>(newSize >> MEMORY_PAGE_BITS);
+        if (offset != 0 && FindPageInTable(lastPage) != nullptr) {
+            uint8_t* page = GetPageInTable(lastPage);
+            std::fill(page + offset, page + MEMORY_PAGE_SIZE, 0);
+        }
+        FlushTlb();
+    }
+    m_size = newSize;
 }
 
-void Memory::Reset()
+void Memory::SetCodeRange(const uint64_t begin, const uint64_t end)
+{
+    MarkCodePages(m_codeBegin, m_codeEnd, false);
+    m_codeBegin = begin;
+    m_codeEnd = end;
+    MarkCodePages(m_codeBegin, m_codeEnd, true);
+    m_codeChangeBegin = UINT64_MAX;
+    m_codeChangeEnd = 0;
+}
+
+void Memory::InvalidateCode() { RecordCodeChange(m_codeBegin, m_codeEnd - m_codeBegin); }
+
+bool Memory::CollectCodeChanges(uint64_t& begin, uint64_t& end)
+{
+    if (!HasCodeChanges()) {
+        return false;
+    }
+    begin = m_codeChangeBegin;
+    end = m_codeChangeEnd;
+    m_codeChangeBegin = UINT64_MAX;
+    m_codeChangeEnd = 0;
+    return true;
+}
+
+uint64_t Memory::GetSize() const { return m_size; }
+
+uint32_t Memory::GetPageCount() const { return m_pageCount; }
+
+uint64_t Memory::GetFootprint() const
+{
+    const uint64_t pages = m_reserved != nullptr ? m_written.size() : m_pageCount;
+    return pages * MEMORY_PAGE_SIZE;
+}
+
+const uint8_t* Memory::FindPageInTable(const uint32_t page) const
+{
+    const Page* slot = FindSlot(page);
+    if (slot == nullptr || *slot == nullptr) {
+        return nullptr;
+    }
+    m_tlb[page % TLB_SIZE] = {page, slot->use_count() == 1, slot->get()};
+    return slot->get();
+}
+
+Memory::Page* Memory::FindSlot(const uint32_t page) const
+{
+    const std::unique_ptr<PageTable>& table = m_directory[page >> TABLE_BITS];
+    return table != nullptr ? &(*table)[page % TABLE_SIZE] : nullptr;
+}
+
+Memory::Page& Memory::GetSlot(const uint32_t page)
+{
+    std::unique_ptr<PageTable>& table = m_directory[page >> TABLE_BITS];
+    if (table == nullptr) {
+        table = std::make_unique<PageTable>();
+    }
+    return (*table)[page % TABLE_SIZE];
+}
+
+uint8_t* Memory::GetPageInTable(const uint32_t page)
+{
+    Page& slot = GetSlot(page);
+    if (slot == nullptr) {
+        // value-initialized, so the page starts out zeroed
+        slot = std::make_shared<uint8_t[]>(MEMORY_PAGE_SIZE);
+        m_pageCount++;
+    }
+    else if (slot.use_count() > 1) {
+        // a snapshot holds on to the current contents
+        Page copy = std::make_shared<uint8_t[]>(MEMORY_PAGE_SIZE);
+        std::memcpy(copy.get(), slot.get(), MEMORY_PAGE_SIZE);
+        slot = std::move(copy);
+    }
+
+    m_tlb[page % TLB_SIZE] = {page, true, slot.get()};
+    if (m_fetchEntry.page == page) {
+        m_fetchEntry.data = slot.get();
+    }
+    return slot.get();
+}
+
+void Memory::ReadBytes(uint32_t address, uint8_t* data, uint64_t size) const
+{
+    if (m_reserved != nullptr) {
+        std::memcpy(data, m_reserved + address, size);
+        return;
+    }
+    while (size > 0) {
+        const uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+        const uint32_t chunk = static_cast<uint32_t>(std::min<uint64_t>(size, MEMORY_PAGE_SIZE - offset));
+        const uint8_t* page = FindPage(address >> MEMORY_PAGE_BITS);
+        if (page == nullptr) {
+            std::fill(data, data + chunk, 0);
+        }
+        else {
+            std::memcpy(data, page + offset, chunk);
+        }
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void Memory::WriteBytes(uint32_t address, const uint8_t* data, uint64_t size)
+{
+    while (size > 0) {
+        const uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+        const uint32_t chunk = static_cast<uint32_t>(std::min<uint64_t>(size, MEMORY_PAGE_SIZE - offset));
+        MarkDirty(address, chunk);
+        if (m_reserved != nullptr) {
+            std::memcpy(m_reserved + address, data, chunk);
+        }
+        else {
+            std::memcpy(GetPage(address >> MEMORY_PAGE_BITS) + offset, data, chunk);
+        }
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void Memory::FlushTlb() const
+{
+    m_tlb.fill({NO_PAGE, false, nullptr});
+    m_fetchEntry = {NO_PAGE, nullptr};
+}
+
+void Memory::FillFetchEntry(const uint32_t page) const
+{
+    const uint8_t* data = FindPage(page);
+    m_fetchEntry = {page, data != nullptr ? data : ZERO_PAGE};
+}
+
+bool Memory::FetchSplit(const uint32_t address, uint32_t& word) const
+{
+    if (!Contains(address, sizeof(uint16_t))) {
+        return false;
+    }
+    // a compressed instruction only needs the first half
+    word = ReadHalfWord(address) | static_cast<uint32_t>(ReadHalfWord(address + 2)) << 16;
+    return true;
+}
+
+void Memory::RecordCodeChange(const uint64_t address, const uint64_t size)
 {
-    m_memory.clear();
-    m_memory.resize(m_size, 0);
+    const uint64_t begin = std::max(address, m_codeBegin);
+    const uint64_t end = std::min(address + size, m_codeEnd);
+    if (begin < end) {
+        m_codeChangeBegin = std::min(m_codeChangeBegin, begin);
+        m_codeChangeEnd = std::max(m_codeChangeEnd, end);
+    }
+}
+
+void Memory::CompareCode(const uint32_t page, const uint8_t* contents)
+{
+    const MemoryPageView view = ViewPage(page << MEMORY_PAGE_BITS);
+    // only the part of the page inside the code
+    const uint64_t from = std::clamp<uint64_t>(m_codeBegin, view.address, view.address + view.bytes.size());
+    const uint64_t to = std::clamp<uint64_t>(m_codeEnd, from, view.address + view.bytes.size());
+    const auto first = static_cast<std::ptrdiff_t>(from - view.address);
+    const auto last = static_cast<std::ptrdiff_t>(to - view.address);
+    if (!std::equal(view.bytes.begin() + first, view.bytes.begin() + last, contents + first)) {
+        RecordCodeChange(from, to - from);
+    }
+}
+
+void Memory::MarkCodePages(const uint64_t from, const uint64_t to, const bool code)
+{
+    const uint64_t end = std::min<uint64_t>(RoundUpToPage(to) >> MEMORY_PAGE_BITS, m_dirty.size());
+    for (uint64_t page = from >> MEMORY_PAGE_BITS; page < end; page++) {
+        if (code) {
+            m_dirty[page] |= CODE_PAGE;
+        }
+        else {
+            m_dirty[page] &= ~CODE_PAGE;
+        }
+    }
+}
+
+void Memory::MarkWritten(const uint32_t page)
+{
+    if ((m_dirty[page] & DIRTY_WRITTEN) == 0) {
+        m_written.push_back(page);
+        m_dirty[page] |= DIRTY_WRITTEN;
+    }
 }
 
-void Memory::Resize(const uint32_t size)
+const std::shared_ptr<const uint8_t[]>* Memory::FindImagePage(const uint32_t page) const
 {
-    m_size = size;
-    m_memory.resize(size, 0);
+    const auto found = std::ranges::lower_bound(m_image.pages, page, {}, &SnapshotPage::first);
+    return found != m_image.pages.end() && found->first == page ? &found->second : nullptr;
+}
+
+void Memory::DropResetImage()
+{
+    for (const auto& [page, data] : m_image.pages) {
+        if (page < m_dirty.size()) {
+            MarkWritten(page);
+        }
+    }
+    m_image = {};
+}
+
+uint64_t Memory::GetPageEnd() const { return RoundUpToPage(m_size) >> MEMORY_PAGE_BITS; }
+
+uint64_t Memory::FindNextPage(uint64_t page) const
+{
+    const uint64_t end = GetPageEnd();
+    if (m_reserved != nullptr) {
+        return std::min(page, end);
+    }
+    while (page < end) {
+        const std::unique_ptr<PageTable>& table = m_directory[page >> TABLE_BITS];
+        if (table == nullptr) {
+            // skip the whole table
+            page = (page | (TABLE_SIZE - 1)) + 1;
+        }
+        else if ((*table)[page % TABLE_SIZE] != nullptr) {
+            return page;
+        }
+        else {
+            page++;
+        }
+    }
+    return end;
+}
+
+MemoryPageIterator::MemoryPageIterator(const Memory* memory, const uint64_t page) : m_memory(memory), m_page(page) {}
+
+MemoryPageView MemoryPageIterator::operator*() const
+{
+    return m_memory->ViewPage(static_cast<uint32_t>(m_page << MEMORY_PAGE_BITS));
+}
+
+MemoryPageIterator& MemoryPageIterator::operator++()
+{
+    m_page = m_memory->FindNextPage(m_page + 1);
+    return *this;
+}
+
+MemoryPageIterator MemoryPageIterator::operator++(int)
+{
+    const MemoryPageIterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool MemoryPageIterator::operator==(const MemoryPageIterator& other) const
+{
+    return m_memory == other.m_memory && m_page == other.m_page;
+}
+
+void Memory::Reserve()
+{
+#ifdef MEMORY_RESERVATION
+    // nothing is backed until it is made accessible and touched
+    void* reserved = mmap(nullptr, RESERVATION_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved != MAP_FAILED) {
+        m_reserved = static_cast<uint8_t*>(reserved);
+    }
+#endif
+}
+
+void Memory::Release()
+{
+#ifdef MEMORY_RESERVATION
+    if (m_reserved != nullptr) {
+        munmap(m_reserved, RESERVATION_SIZE);
+        m_reserved = nullptr;
+    }
+#endif
+}
+
+void Memory::RemapReserved(const uint64_t from, const uint64_t to, const bool accessible)
+{
+#ifdef MEMORY_RESERVATION
+    if (from >= to) {
+        return;
+    }
+    // mapping fresh pages over the range drops whatever the host committed for it
+    mmap(m_reserved + from, to - from, accessible ? PROT_READ | PROT_WRITE : PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
 }
-uint32_t Memory::GetSize() const { return m_memory.size(); }
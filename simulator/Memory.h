@@ -1,28 +1,371 @@
 #ifndef MEMORY_H
 #define MEMORY_H
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
 #include <vector>
 
+using std::span;
 using std::vector;
 
+// guest memory is little-endian and accessed with memcpy, which needs a host of the same byte order
+static_assert(std::endian::native == std::endian::little, "Memory requires a little-endian host");
+
+constexpr uint32_t MEMORY_PAGE_BITS = 12;
+constexpr uint32_t MEMORY_PAGE_SIZE = 1u << MEMORY_PAGE_BITS;
+constexpr uint64_t ADDRESS_SPACE_SIZE = 1ull << 32;
+
+constexpr uint64_t RoundUpToPage(const uint64_t size)
+{
+    return (size + MEMORY_PAGE_SIZE - 1) & ~(MEMORY_PAGE_SIZE - 1ull);
+}
+
+// written since the dirty pages were last collected
+constexpr uint8_t DIRTY_CHANGED = 1;
+// written since the last reset, the pages that Reset puts back
+constexpr uint8_t DIRTY_WRITTEN = 2;
+constexpr uint8_t DIRTY_FLAGS = DIRTY_CHANGED | DIRTY_WRITTEN;
+// not a dirty flag but kept in the same map, the page holds code, see Memory::SetCodeRange
+constexpr uint8_t CODE_PAGE = 4;
+
+#if !defined(_WIN32) && UINTPTR_MAX > UINT32_MAX
+#define MEMORY_RESERVATION
+#endif
+
+enum class MemoryBackend
+{
+    // two-level page table, pages are allocated on first write
+    PAGED,
+    // the whole address space is reserved up front and the host commits pages on first touch,
+    // so guest addresses map to host ones by adding a fixed base. Falls back to PAGED where unsupported
+    RESERVED
+};
+
+class Memory;
+
+// Read-only view of the bytes of one page, clipped to the memory size
+struct MemoryPageView
+{
+    uint32_t address;
+    span<const uint8_t> bytes;
+};
+
+// Walks the pages that hold data in address order
+class MemoryPageIterator
+{
+public:
+    using iterator_concept = std::forward_iterator_tag;
+    using value_type = MemoryPageView;
+    using difference_type = std::ptrdiff_t;
+
+    MemoryPageIterator() = default;
+    MemoryPageIterator(const Memory* memory, uint64_t page);
+    MemoryPageView operator*() const;
+    MemoryPageIterator& operator++();
+    MemoryPageIterator operator++(int);
+    bool operator==(const MemoryPageIterator& other) const;
+
+private:
+    const Memory* m_memory = nullptr;
+    uint64_t m_page = 0;
+};
+
+using MemoryPages = std::ranges::subrange<MemoryPageIterator>;
+
+// page number and contents
+using SnapshotPage = std::pair<uint32_t, std::shared_ptr<const uint8_t[]>>;
+
+// Contents of a memory at one point in time. With the paged backend the pages are shared
+// with the memory and only copied once either side writes them
+struct MemorySnapshot
+{
+    uint64_t size;
+    // every page that holds data, in address order
+    vector<SnapshotPage> pages;
+};
+
+// Byte addressed guest memory of up to the whole 32-bit address space.
+// Pages are allocated when they are first written, untouched ones read as zero
 class Memory
 {
 public:
     Memory();
-    explicit Memory(uint32_t size);
-    ~Memory() = default;
-    vector<uint32_t> GetMemory();
+    // size in bytes, at most ADDRESS_SPACE_SIZE
+    explicit Memory(uint64_t size, MemoryBackend backend = MemoryBackend::PAGED);
+    ~Memory();
+    // the reservation is tied to the object
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
+    static bool IsReservationSupported();
+    MemoryBackend GetBackend() const;
+    // Host address of guest address 0 for the reserved backend, nullptr for the paged one.
+    // Everything from GetSize() rounded up to a page to the end of the address space plus one
+    // page faults on access
+    uint8_t* GetReservedBase() const;
+    // contents as words, the last one padded with zeros. Copies the whole size, only meant for small memories
+    vector<uint32_t> GetMemory() const;
+    // Views without copying. They stay valid until the memory is reset or resized, a view of a page
+    // that has never been written, or was shared with a snapshot, keeps showing the old contents after writing it
+    MemoryPageView ViewPage(uint32_t address) const;
+    // pages that have been written for the paged backend, every page for the reserved one
+    MemoryPages GetPages() const;
+    // Pages stored to since the previous call, in address order, and clears their dirty bits in the same go.
+    // Reset, Restore and SetResetImage clear all of them, observers reload everything after those and Resize
+    vector<MemoryPageView> CollectDirtyPages();
+    // One byte per page, stores set all of DIRTY_FLAGS in it. For code that writes memory directly, which has
+    // to call MarkDirtyRange for the pages that hold anything but exactly DIRTY_FLAGS, such as CODE_PAGE ones
+    uint8_t* GetDirtyMap();
+    void MarkDirtyRange(uint32_t address, uint64_t size);
+    // Costs a pointer per page that holds data for the paged backend,
+    // the reserved one copies the pages written since the last reset
+    MemorySnapshot Snapshot() const;
+    // Brings back the contents and size of the snapshot, which stays usable for further restores.
+    // A snapshot of another size drops the reset image like Resize
+    void Restore(const MemorySnapshot& snapshot);
+    // The current contents become what Reset goes back to instead of zeros, such as the data a program was loaded with.
+    // The pages are shared like those of a snapshot
+    void SetResetImage();
+    void ClearResetImage();
+    // Writes data into the reset image only, such as a program's code, the current contents stay as they are.
+    // False without changing anything if the data does not fit into the memory
+    bool AddToResetImage(uint32_t address, span<const uint8_t> data);
+    // what Reset would bring back, zeros where the image has no data. False if the bytes are not all inside the memory
+    bool ReadResetImage(uint32_t address, span<uint8_t> data) const;
+    // Reserved backend only, maps count pages of an open file from offset on over the memory from page on,
+    // copy-on-write. False if that is not possible, the pages read as zero then
+    bool MapFile(int descriptor, uint64_t offset, uint32_t page, uint32_t count);
+    // Accesses sizeof(T) bytes at any, also unaligned, address.
+    // Returns false without touching anything if they are not all inside the memory
+    template <typename T>
+    bool Load(uint32_t address, T& value) const;
+    template <typename T>
+    bool Store(uint32_t address, T value);
+    // Loads the 4 bytes at the address rounded down to 2, enough for an instruction of either size, the ones
+    // outside the memory read as 0. Keeps the code page at hand in an entry of its own, so fetching does not evict
+    // the data pages and the other way round. False if the address is outside the memory
+    bool Fetch(uint32_t address, uint32_t& word) const;
+    bool ReadRange(uint32_t address, span<uint8_t> data) const;
+    bool WriteRange(uint32_t address, span<const uint8_t> data);
+    // The bytes in [begin, end) are code that engines decode ahead of executing it. Their pages are marked with
+    // CODE_PAGE, and changes to those bytes by stores, Reset or Restore are recorded until they are collected.
+    // Stores to other pages cost nothing extra. Drops the changes recorded so far
+    void SetCodeRange(uint64_t begin, uint64_t end);
+    // records all of the code as changed, such as for FENCE.I
+    void InvalidateCode();
+    // cheap enough to check after every store
+    bool HasCodeChanges() const;
+    // The code bytes changed since the previous call as one range covering all of them, [begin, end).
+    // False if there are none
+    bool CollectCodeChanges(uint64_t& begin, uint64_t& end);
+    // out of bounds reads return 0 and writes are ignored
     uint32_t Read(uint32_t address) const;
     uint16_t ReadHalfWord(uint32_t address) const;
     uint8_t ReadByte(uint32_t address) const;
     void Write(uint32_t address, uint32_t value);
+    // Goes back to the reset image, zeros if there is none. Only visits the pages written since the previous
+    // reset, so it costs the same for any size
     void Reset();
-    void Resize(uint32_t size);
-    uint32_t GetSize() const;
+    // drops the reset image, the memory keeps its contents until the next reset
+    void Resize(uint64_t size);
+    uint64_t GetSize() const;
+    // number of pages allocated by the paged backend, the reserved one leaves that to the host and reports 0
+    uint32_t GetPageCount() const;
+    // Bytes in pages that hold data, those allocated by the paged backend and those written since the last reset
+    // by the reserved one. Pages shared with snapshots or the reset image count as well
+    uint64_t GetFootprint() const;
 
 private:
-    uint32_t m_size;
-    vector<uint32_t> m_memory;
+    friend class MemoryPageIterator;
+
+    static constexpr uint32_t TABLE_BITS = 10;
+    static constexpr uint32_t TABLE_SIZE = 1u << TABLE_BITS;
+    static constexpr uint32_t TLB_SIZE = 8;
+    static constexpr uint32_t NO_PAGE = UINT32_MAX;
+
+    // shared with snapshots, a page is copied before writing it while they hold it too
+    using Page = std::shared_ptr<uint8_t[]>;
+    // second level of the page table, covers TABLE_SIZE pages
+    using PageTable = std::array<Page, TABLE_SIZE>;
+
+    // recently used pages, only ever holds allocated ones
+    struct TlbEntry
+    {
+        uint32_t page;
+        // whether no snapshot shares the page, stores only take the fast path for those
+        bool writable;
+        uint8_t* data;
+    };
+
+    // page the latest instruction was fetched from, the zero page for pages that have not been allocated
+    struct FetchEntry
+    {
+        uint32_t page;
+        const uint8_t* data;
+    };
+
+    bool Contains(uint32_t address, uint64_t size) const;
+    // nullptr if the page has not been allocated
+    const uint8_t* FindPage(uint32_t page) const;
+    const uint8_t* FindPageInTable(uint32_t page) const;
+    // nullptr if the table of the page has not been allocated
+    Page* FindSlot(uint32_t page) const;
+    Page& GetSlot(uint32_t page);
+    // allocates the page or copies it away from snapshots if needed
+    uint8_t* GetPage(uint32_t page);
+    uint8_t* GetPageInTable(uint32_t page);
+    void ReadBytes(uint32_t address, uint8_t* data, uint64_t size) const;
+    void WriteBytes(uint32_t address, const uint8_t* data, uint64_t size);
+    void FlushTlb() const;
+    void FillFetchEntry(uint32_t page) const;
+    // Fetch of the last 2 bytes of a page or of the memory
+    bool FetchSplit(uint32_t address, uint32_t& word) const;
+    uint64_t GetPageEnd() const;
+    // the bytes have to be inside one page
+    void MarkDirty(uint32_t address, uint32_t size);
+    void RecordCodeChange(uint64_t address, uint64_t size);
+    // records the code bytes of the page if contents, which it is about to hold, differs from them
+    void CompareCode(uint32_t page, const uint8_t* contents);
+    void MarkCodePages(uint64_t from, uint64_t to, bool code);
+    // the page holds data Reset has to take care of, without telling observers
+    void MarkWritten(uint32_t page);
+    // nullptr if the reset image has no data for the page
+    const std::shared_ptr<const uint8_t[]>* FindImagePage(uint32_t page) const;
+    // the image pages become written ones, so the next reset zeroes them
+    void DropResetImage();
+    // first page from page on that GetPages visits, GetPageEnd if there is none
+    uint64_t FindNextPage(uint64_t page) const;
+    void Reserve();
+    void Release();
+    // whole pages between from and to become zeroed and accessible or inaccessible
+    void RemapReserved(uint64_t from, uint64_t to, bool accessible);
+
+    uint64_t m_size;
+    // nullptr unless the reserved backend is in use
+    uint8_t* m_reserved;
+    vector<uint8_t> m_dirty;
+    // pages with DIRTY_WRITTEN in the order they were first written
+    vector<uint32_t> m_written;
+    MemorySnapshot m_image;
+    uint32_t m_pageCount;
+    std::array<std::unique_ptr<PageTable>, TABLE_SIZE> m_directory;
+    mutable std::array<TlbEntry, TLB_SIZE> m_tlb;
+    mutable FetchEntry m_fetchEntry;
+    uint64_t m_codeBegin;
+    uint64_t m_codeEnd;
+    // changes since the last collection, begin >= end if there are none
+    uint64_t m_codeChangeBegin;
+    uint64_t m_codeChangeEnd;
 };
 
+inline bool Memory::Contains(const uint32_t address, const uint64_t size) const
+{
+    return static_cast<uint64_t>(address) + size <= m_size;
+}
+
+inline void Memory::MarkDirty(const uint32_t address, const uint32_t size)
+{
+    uint8_t& dirty = m_dirty[address >> MEMORY_PAGE_BITS];
+    if (dirty == DIRTY_FLAGS) {
+        return;
+    }
+    if ((dirty & DIRTY_WRITTEN) == 0) {
+        m_written.push_back(address >> MEMORY_PAGE_BITS);
+    }
+    if ((dirty & CODE_PAGE) != 0) {
+        RecordCodeChange(address, size);
+    }
+    dirty |= DIRTY_FLAGS;
+}
+
+inline bool Memory::HasCodeChanges() const { return m_codeChangeBegin < m_codeChangeEnd; }
+
+inline const uint8_t* Memory::FindPage(const uint32_t page) const
+{
+    const TlbEntry& entry = m_tlb[page % TLB_SIZE];
+    if (entry.page == page) {
+        return entry.data;
+    }
+    return FindPageInTable(page);
+}
+
+inline uint8_t* Memory::GetPage(const uint32_t page)
+{
+    const TlbEntry& entry = m_tlb[page % TLB_SIZE];
+    if (entry.page == page && entry.writable) {
+        return entry.data;
+    }
+    return GetPageInTable(page);
+}
+
+template <typename T>
+bool Memory::Load(const uint32_t address, T& value) const
+{
+    if (!Contains(address, sizeof(T))) {
+        return false;
+    }
+    if (m_reserved != nullptr) {
+        std::memcpy(&value, m_reserved + address, sizeof(T));
+        return true;
+    }
+    const uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+    if (offset > MEMORY_PAGE_SIZE - sizeof(T)) {
+        ReadBytes(address, reinterpret_cast<uint8_t*>(&value), sizeof(T));
+        return true;
+    }
+
+    const uint8_t* page = FindPage(address >> MEMORY_PAGE_BITS);
+    if (page == nullptr) {
+        value = 0;
+    }
+    else {
+        std::memcpy(&value, page + offset, sizeof(T));
+    }
+    return true;
+}
+
+template <typename T>
+bool Memory::Store(const uint32_t address, const T value)
+{
+    if (!Contains(address, sizeof(T))) {
+        return false;
+    }
+    const uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+    if (offset > MEMORY_PAGE_SIZE - sizeof(T)) {
+        WriteBytes(address, reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+        return true;
+    }
+
+    MarkDirty(address, sizeof(T));
+    if (m_reserved != nullptr) {
+        std::memcpy(m_reserved + address, &value, sizeof(T));
+    }
+    else {
+        std::memcpy(GetPage(address >> MEMORY_PAGE_BITS) + offset, &value, sizeof(T));
+    }
+    return true;
+}
+
+inline bool Memory::Fetch(uint32_t address, uint32_t& word) const
+{
+    address &= ~1u;
+    if ((address & (MEMORY_PAGE_SIZE - 1)) > MEMORY_PAGE_SIZE - sizeof(word) || !Contains(address, sizeof(word))) {
+        return FetchSplit(address, word);
+    }
+    if (m_reserved != nullptr) {
+        std::memcpy(&word, m_reserved + address, sizeof(word));
+        return true;
+    }
+    const uint32_t page = address >> MEMORY_PAGE_BITS;
+    if (m_fetchEntry.page != page) {
+        FillFetchEntry(page);
+    }
+    std::memcpy(&word, m_fetchEntry.data + (address & (MEMORY_PAGE_SIZE - 1)), sizeof(word));
+    return true;
+}
+
 #endif // MEMORY_H
@@ -0,0 +1,45 @@
+#ifndef MULTIPLYDIVIDE_H
+#define MULTIPLYDIVIDE_H
+#include <cstdint>
+
+// The M operations, shared by the engines so they all compute the same results. The divisions take a divisor
+// other than 0, which the engines report as DIVISION_BY_ZERO instead
+class MultiplyDivide
+{
+public:
+    static uint32_t Mul(const uint32_t a, const uint32_t b) { return a * b; }
+    // the upper 32 bits of the 64-bit product, with the operands sign or zero extended
+    static uint32_t MulHigh(const uint32_t a, const uint32_t b)
+    {
+        return static_cast<uint32_t>(static_cast<int64_t>(static_cast<int32_t>(a)) * static_cast<int32_t>(b) >> 32);
+    }
+    static uint32_t MulHighSignedUnsigned(const uint32_t a, const uint32_t b)
+    {
+        // fits, the magnitude stays below 2^63
+        return static_cast<uint32_t>(static_cast<int64_t>(static_cast<int32_t>(a)) * static_cast<int64_t>(b) >> 32);
+    }
+    static uint32_t MulHighUnsigned(const uint32_t a, const uint32_t b)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(a) * b >> 32);
+    }
+    static uint32_t Div(const uint32_t a, const uint32_t b)
+    {
+        // negated without overflow, INT_MIN / -1 is INT_MIN in RV32M while it traps on the host
+        if (static_cast<int32_t>(b) == -1) {
+            return 0 - a;
+        }
+        return static_cast<uint32_t>(static_cast<int32_t>(a) / static_cast<int32_t>(b));
+    }
+    static uint32_t DivUnsigned(const uint32_t a, const uint32_t b) { return a / b; }
+    static uint32_t Rem(const uint32_t a, const uint32_t b)
+    {
+        // the remainder of any division by -1 is 0, INT_MIN % -1 traps on the host
+        if (static_cast<int32_t>(b) == -1) {
+            return 0;
+        }
+        return static_cast<uint32_t>(static_cast<int32_t>(a) % static_cast<int32_t>(b));
+    }
+    static uint32_t RemUnsigned(const uint32_t a, const uint32_t b) { return a % b; }
+};
+
+#endif // MULTIPLYDIVIDE_H
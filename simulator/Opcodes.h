@@ -8,9 +8,10 @@ static constexpr uint8_t Load_Type = 0b00000011;
 static constexpr uint8_t S_Type = 0b00100011;
 static constexpr uint8_t B_Type = 0b01100011;
 static constexpr uint8_t LUI_Type = 0b00110111;
-static constexpr uint8_t AUIPC_Type = 0b00100111;
+static constexpr uint8_t AUIPC_Type = 0b00010111;
 static constexpr uint8_t JAL_Type = 0b01101111;
 static constexpr uint8_t JALR_Type = 0b01100111;
+static constexpr uint8_t MISC_MEM_Type = 0b00001111;
 
 static constexpr uint8_t ADD = 0x0;
 static constexpr uint8_t SUB = 0x0;
@@ -32,6 +33,33 @@ static constexpr uint8_t DIVU = 0x5;
 static constexpr uint8_t REM = 0x6;
 static constexpr uint8_t REMU = 0x7;
 
+// funct7 of the register instructions besides the base ones and M
+static constexpr uint8_t M_Funct7 = 0x01;
+// sub and sra, and the Zbb ones with an inverted operand
+static constexpr uint8_t ALTERNATE_Funct7 = 0x20;
+static constexpr uint8_t SHIFT_ADD_Funct7 = 0x10;
+static constexpr uint8_t MIN_MAX_Funct7 = 0x05;
+static constexpr uint8_t ROTATE_Funct7 = 0x30;
+static constexpr uint8_t ZEXT_H_Funct7 = 0x04;
+
+static constexpr uint8_t SH1ADD = 0x2;
+static constexpr uint8_t SH2ADD = 0x4;
+static constexpr uint8_t SH3ADD = 0x6;
+
+static constexpr uint8_t XNOR = 0x4;
+static constexpr uint8_t ORN = 0x6;
+static constexpr uint8_t ANDN = 0x7;
+
+static constexpr uint8_t MINIMUM = 0x4;
+static constexpr uint8_t MINIMUM_UNSIGNED = 0x5;
+static constexpr uint8_t MAXIMUM = 0x6;
+static constexpr uint8_t MAXIMUM_UNSIGNED = 0x7;
+
+static constexpr uint8_t ROL = 0x1;
+static constexpr uint8_t ROR = 0x5;
+
+static constexpr uint8_t ZEXT_H = 0x4;
+
 static constexpr uint8_t ADDI = 0x0;
 static constexpr uint8_t SLLI = 0x1;
 static constexpr uint8_t SLTI = 0x2;
@@ -41,6 +69,15 @@ static constexpr uint8_t SRLI_SRAI = 0x5;
 static constexpr uint8_t ORI = 0x6;
 static constexpr uint8_t ANDI = 0x7;
 
+// the Zbb immediate instructions with one source, told apart by all 12 immediate bits
+static constexpr uint16_t CLZ = 0x600;
+static constexpr uint16_t CTZ = 0x601;
+static constexpr uint16_t CPOP = 0x602;
+static constexpr uint16_t SEXT_B = 0x604;
+static constexpr uint16_t SEXT_H = 0x605;
+static constexpr uint16_t ORC_B = 0x287;
+static constexpr uint16_t REV8 = 0x698;
+
 static constexpr uint8_t LB = 0x0;
 static constexpr uint8_t LH = 0x1;
 static constexpr uint8_t LW = 0x2;
@@ -59,4 +96,30 @@ static constexpr uint8_t BLTU = 0x6;
 static constexpr uint8_t BGEU = 0x7;
 
 static constexpr uint8_t JALR = 0x0;
+
+static constexpr uint8_t FENCE = 0x0;
+static constexpr uint8_t FENCE_I = 0x1;
+
+// compressed instructions, the quadrant is in the low two bits and funct3 in the top three
+static constexpr uint8_t C0_Quadrant = 0b00;
+static constexpr uint8_t C1_Quadrant = 0b01;
+static constexpr uint8_t C2_Quadrant = 0b10;
+
+static constexpr uint8_t C_ADDI4SPN = 0x0;
+static constexpr uint8_t C_LW = 0x2;
+static constexpr uint8_t C_SW = 0x6;
+
+static constexpr uint8_t C_ADDI = 0x0;
+static constexpr uint8_t C_JAL = 0x1;
+static constexpr uint8_t C_LI = 0x2;
+static constexpr uint8_t C_LUI_ADDI16SP = 0x3;
+static constexpr uint8_t C_ARITHMETIC = 0x4;
+static constexpr uint8_t C_J = 0x5;
+static constexpr uint8_t C_BEQZ = 0x6;
+static constexpr uint8_t C_BNEZ = 0x7;
+
+static constexpr uint8_t C_SLLI = 0x0;
+static constexpr uint8_t C_LWSP = 0x2;
+static constexpr uint8_t C_REGISTER = 0x4;
+static constexpr uint8_t C_SWSP = 0x6;
 #endif // OPCODES_H
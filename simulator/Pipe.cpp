@@ -0,0 +1,37 @@
+#include "Pipe.h"
+
+#ifdef PIPE_SUPPORTED
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+
+bool Pipe::WriteAll(const int descriptor, const void* data, const size_t size)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t written = 0; written < size;) {
+        const ssize_t count = write(descriptor, bytes + written, size - written);
+        if (count < 0 && errno != EINTR) {
+            return false;
+        }
+        written += count > 0 ? count : 0;
+    }
+    return true;
+}
+
+bool Pipe::ReadAll(const int descriptor, void* data, const size_t size)
+{
+    auto* bytes = static_cast<uint8_t*>(data);
+    for (size_t received = 0; received < size;) {
+        const ssize_t count = read(descriptor, bytes + received, size - received);
+        if (count == 0 || (count < 0 && errno != EINTR)) {
+            return false;
+        }
+        received += count > 0 ? count : 0;
+    }
+    return true;
+}
+#else
+bool Pipe::WriteAll(int, const void*, size_t) { return false; }
+
+bool Pipe::ReadAll(int, void*, size_t) { return false; }
+#endif
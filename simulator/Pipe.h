@@ -0,0 +1,20 @@
+#ifndef PIPE_H
+#define PIPE_H
+#include <cstddef>
+
+#if !defined(_WIN32)
+#define PIPE_SUPPORTED
+#endif
+
+// Blocking transfers over the pipes between a process and the children it forks, retried when a signal
+// interrupts them
+class Pipe
+{
+public:
+    // False if the other end has been closed or the write failed
+    static bool WriteAll(int descriptor, const void* data, size_t size);
+    // False if the other end was closed before size bytes arrived or the read failed
+    static bool ReadAll(int descriptor, void* data, size_t size);
+};
+
+#endif // PIPE_H
@@ -1,33 +1,35 @@
 #include "Registers.h"
 
-Registers::Registers()
-{
-    m_registers = std::vector<uint32_t>(33, 0);
-    Reset();
-}
-
-Registers::~Registers() = default;
+Registers::Registers() { Reset(); }
 
-void Registers::Reset()
-{
-    for (int i = 0; i < 33; i++) {
-        m_registers[i] = 0;
-    }
-}
+void Registers::Reset() { m_state = {}; }
 
-void Registers::SetPC(const uint32_t value) { m_registers[PC] = value; }
+void Registers::SetPC(const uint32_t value) { m_state.registers[PC] = value; }
 
-void Registers::IncrementPC() { m_registers[PC] += 4; }
+void Registers::IncrementPC(const uint32_t size) { m_state.registers[PC] += size; }
 
-uint32_t Registers::GetPC() const { return m_registers[PC]; }
+uint32_t Registers::GetPC() const { return m_state.registers[PC]; }
 
 void Registers::SetRegister(const uint8_t reg, const uint32_t value)
 {
     if (reg == 0) // Register x0 is hardwired to 0
         return;
-    m_registers[reg] = value;
+    m_state.registers[reg] = value;
+}
+
+uint32_t Registers::GetRegister(const uint8_t reg) const { return m_state.registers[reg]; }
+
+const HartState& Registers::GetState() const { return m_state; }
+
+void Registers::SetState(const HartState& state) { m_state = state; }
+
+span<const uint32_t, 32> Registers::GetRegisters() const
+{
+    return span<const uint32_t, 32>(m_state.registers.data(), 32);
 }
 
-uint32_t Registers::GetRegister(const uint8_t reg) const { return m_registers[reg]; }
+uint64_t Registers::GetRetired() const { return m_state.retired; }
+
+void Registers::AddRetired(const uint64_t instructions) { m_state.retired += instructions; }
 
-vector<uint32_t> Registers::GetRegisters() const { return vector(m_registers.begin(), m_registers.begin() + 32); }
+uint32_t* Registers::GetData() { return m_state.registers.data(); }
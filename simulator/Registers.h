@@ -1,30 +1,47 @@
 #ifndef REGISTERS_H
 #define REGISTERS_H
+#include <array>
 #include <cstdint>
-#include <vector>
+#include <span>
 
-using std::vector;
+using std::span;
 
 constexpr uint8_t PC = 32;
 
+// Architectural state of the hart, cache-line aligned and held inline so the engines
+// reach every register with a single offset from the same base. At 140 bytes it spans three lines
+struct alignas(64) HartState
+{
+    // 0: constant 0
+    // 1-31: general purpose registers
+    // 32: program counter
+    std::array<uint32_t, 33> registers;
+    // instructions retired since the last reset
+    uint64_t retired;
+};
+
 class Registers
 {
 public:
     Registers();
-    ~Registers();
     void Reset();
     void SetPC(uint32_t value);
-    void IncrementPC();
+    // by the size of the instruction at pc
+    void IncrementPC(uint32_t size);
     uint32_t GetPC() const;
     void SetRegister(uint8_t reg, uint32_t value);
     uint32_t GetRegister(uint8_t reg) const;
-    vector<uint32_t> GetRegisters() const;
+    // view of x0-x31, stays valid as long as the registers do
+    span<const uint32_t, 32> GetRegisters() const;
+    uint64_t GetRetired() const;
+    void AddRetired(uint64_t instructions);
+    // raw register file for generated code, x0 must never be written through it
+    uint32_t* GetData();
+    const HartState& GetState() const;
+    void SetState(const HartState& state);
 
 private:
-    // 0: constant 0
-    // 1-31: general purpose registers
-    // 32: stack pointer
-    vector<uint32_t> m_registers;
+    HartState m_state;
 };
 
 #endif // REGISTERS_H
@@ -1,34 +1,498 @@
 #include "Simulator.h"
 
-Simulator::Simulator(const uint32_t memorySize)
+#include <algorithm>
+#include <chrono>
+
+#include "SnapshotFile.h"
+
+Simulator::Simulator(const uint64_t memorySize, const ExecutionEngine engine, const MemoryBackend backend) :
+    m_memory(memorySize, backend), m_cpu(&m_memory), m_engine(engine), m_threadedEngine(nullptr),
+    m_history(nullptr), m_resetState(), m_symbols(), m_limits(), m_executed(0), m_executionTime(0)
 {
-    m_memory = new Memory(memorySize);
-    m_cpu = new CPU(m_memory);
+    if (engine == ExecutionEngine::THREADED) {
+        m_threadedEngine = new ThreadedInterpreter(&m_cpu);
+    }
+    else if (engine == ExecutionEngine::BLOCK_CACHE) {
+        m_threadedEngine = new BlockCache(&m_cpu);
+    }
+    else if (engine == ExecutionEngine::JIT) {
+        m_threadedEngine = new Jit(&m_cpu);
+    }
 }
 
-Simulator::Simulator()
+Simulator::Simulator() :
+    m_cpu(&m_memory), m_engine(ExecutionEngine::INTERPRETER), m_threadedEngine(nullptr), m_history(nullptr),
+    m_resetState(), m_symbols(), m_limits(), m_executed(0), m_executionTime(0)
 {
-    m_memory = new Memory();
-    m_cpu = new CPU(m_memory);
 }
 
 Simulator::~Simulator()
 {
-    delete m_cpu;
-    delete m_memory;
+    delete m_threadedEngine;
+    delete m_history;
+}
+
+void Simulator::SetInstructions(const vector<uint32_t>& instructions)
+{
+    // zeros over what is left of a previous program from address 0 on
+    vector<uint32_t> code(instructions);
+    if (m_cpu.GetProgramBegin() == 0) {
+        code.resize(std::max<size_t>(code.size(), (m_cpu.GetProgramEnd() + 3) / 4), 0);
+    }
+    const span bytes(reinterpret_cast<const uint8_t*>(code.data()), code.size() * sizeof(uint32_t));
+    if (m_memory.GetSize() < bytes.size()) {
+        m_memory.Resize(bytes.size());
+    }
+    m_memory.WriteRange(0, bytes);
+    m_memory.AddToResetImage(0, bytes);
+    m_cpu.SetProgramRange(0, instructions.size() * sizeof(uint32_t));
+    m_symbols.clear();
+    if (m_threadedEngine != nullptr) {
+        m_threadedEngine->Load();
+    }
+    RestartHistory();
+}
+
+ExecutionResult Simulator::Step()
+{
+    if (!HasLimits()) {
+        return StepRecorded();
+    }
+    if (IsLimitExceeded()) {
+        ExecutionResult result = CPUUtil::ExecutionErrorResult(ExecutionError::LIMIT_EXCEEDED);
+        result.pc = m_cpu.GetStatus().pc;
+        result.errorPc = result.pc;
+        return result;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const ExecutionResult result = StepRecorded();
+    m_executionTime += std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+    if (result.error != ExecutionError::PC_OUT_OF_BOUNDS) {
+        m_executed++;
+    }
+    return result;
+}
+
+RunResult Simulator::Run(const uint64_t maxInstructions)
+{
+    if (!HasLimits()) {
+        return RunRecorded(maxInstructions);
+    }
+
+    // in slices with the limits checked in between
+    uint64_t executed = 0;
+    while (true) {
+        if (IsLimitExceeded()) {
+            const uint32_t pc = m_cpu.GetStatus().pc;
+            return {executed, ExecutionError::LIMIT_EXCEEDED, pc, pc, StopReason::LIMIT_REACHED};
+        }
+        uint64_t slice = std::min(maxInstructions - executed, LIMIT_CHECK_INTERVAL);
+        if (m_limits.maxInstructions != 0) {
+            slice = std::min(slice, m_limits.maxInstructions - m_executed);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        RunResult result = RunRecorded(slice);
+        m_executionTime += std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+        m_executed += result.instructions;
+        executed += result.instructions;
+        if (result.reason != StopReason::LIMIT_REACHED || executed == maxInstructions) {
+            result.instructions = executed;
+            return result;
+        }
+    }
+}
+
+RunResult Simulator::RunUntilHalt() { return Run(UINT64_MAX); }
+
+void Simulator::SetLimits(const ExecutionLimits& limits)
+{
+    m_limits = limits;
+    m_executed = 0;
+    m_executionTime = 0;
+}
+
+ExecutionLimits Simulator::GetLimits() const { return m_limits; }
+
+ExecutionResult Simulator::StepRecorded()
+{
+    if (m_history == nullptr) {
+        return StepEngine();
+    }
+
+    const HartState state = m_cpu.GetState();
+    UndoRecord record{state.registers[PC], 0, 0, 0, 0, 0, false};
+    if (m_cpu.GetPendingStore(record.address, record.width) &&
+        !m_memory.ReadRange(record.address, span(reinterpret_cast<uint8_t*>(&record.memoryValue), record.width))) {
+        // the store is going to fail and change nothing
+        record.width = 0;
+    }
+
+    const ExecutionResult result = StepEngine();
+    if (result.error == ExecutionError::PC_OUT_OF_BOUNDS) {
+        // nothing was executed
+        return result;
+    }
+    if (result.error != ExecutionError::NONE) {
+        // the failed instruction has not touched the memory, only the registers are lost
+        record.failed = true;
+        record.width = 0;
+        m_history->AddCheckpoint({state, m_memory.Snapshot()});
+    }
+    else if (result.registerChanged) {
+        record.reg = result.registerChange.reg;
+        record.registerValue = state.registers[record.reg];
+    }
+    m_history->AddRecord(record);
+    if (m_history->IsCheckpointDue()) {
+        m_history->AddCheckpoint(Snapshot());
+    }
+    return result;
+}
+
+RunResult Simulator::RunRecorded(const uint64_t maxInstructions)
+{
+    if (m_history == nullptr) {
+        return RunEngine(maxInstructions);
+    }
+
+    // in stretches that end where the next checkpoint is due
+    uint64_t executed = 0;
+    while (true) {
+        const uint64_t position = m_history->GetPosition();
+        const uint64_t interval = m_history->GetCheckpointInterval();
+        RunResult result = RunEngine(std::min(maxInstructions - executed, interval - position % interval));
+        executed += result.instructions;
+        m_history->Skip(result.instructions);
+        if (result.reason == StopReason::INSTRUCTION_FAILED) {
+            RecordFailure(position + result.instructions);
+            m_history->Skip(1);
+        }
+        if (m_history->IsCheckpointDue()) {
+            m_history->AddCheckpoint(Snapshot());
+        }
+        if (result.reason != StopReason::LIMIT_REACHED || executed == maxInstructions) {
+            result.instructions = executed;
+            return result;
+        }
+    }
 }
 
-void Simulator::SetInstructions(const vector<uint32_t>& instructions) const { m_cpu->LoadInstructions(instructions); }
+CpuStatus Simulator::GetCpuStatus() const { return m_cpu.GetStatus(); }
 
-ExecutionResult Simulator::Step() const { return m_cpu->Step(); }
+vector<uint32_t> Simulator::GetMemory() const { return m_memory.GetMemory(); }
 
-CpuStatus Simulator::GetCpuStatus() const { return m_cpu->GetStatus(); }
+uint64_t Simulator::GetMemorySize() const { return m_memory.GetSize(); }
 
-vector<uint32_t> Simulator::GetMemory() const { return m_memory->GetMemory(); }
+MemoryPageView Simulator::ViewMemoryPage(const uint32_t address) const { return m_memory.ViewPage(address); }
+
+MemoryPages Simulator::GetMemoryPages() const { return m_memory.GetPages(); }
+
+vector<MemoryPageView> Simulator::CollectMemoryDiff() { return m_memory.CollectDirtyPages(); }
+
+bool Simulator::WriteMemory(const uint32_t address, const span<const uint8_t> data)
+{
+    if (!m_memory.WriteRange(address, data)) {
+        return false;
+    }
+    RestartHistory();
+    return true;
+}
+
+void Simulator::ResizeMemory(const uint64_t size)
+{
+    const vector<uint8_t> code = ReadResetCode();
+    m_memory.Resize(std::max<uint64_t>(size, m_cpu.GetProgramEnd()));
+    m_memory.AddToResetImage(m_cpu.GetProgramBegin(), code);
+    RestartHistory();
+}
+
+void Simulator::Reset()
+{
+    m_cpu.SetState(m_resetState);
+    m_memory.Reset();
+    RestartHistory();
+    m_executed = 0;
+    m_executionTime = 0;
+}
+
+void Simulator::SetResetImage()
+{
+    m_resetState = m_cpu.GetState();
+    m_resetState.retired = 0;
+    m_memory.SetResetImage();
+}
+
+void Simulator::ClearResetImage()
+{
+    m_resetState = {};
+    const vector<uint8_t> code = ReadResetCode();
+    m_memory.ClearResetImage();
+    m_memory.AddToResetImage(m_cpu.GetProgramBegin(), code);
+}
+
+SimulatorSnapshot Simulator::Snapshot() const { return {m_cpu.GetState(), m_memory.Snapshot()}; }
+
+void Simulator::Restore(const SimulatorSnapshot& snapshot)
+{
+    const vector<uint8_t> code = ReadResetCode();
+    const uint64_t size = m_memory.GetSize();
+    m_cpu.SetState(snapshot.hart);
+    m_memory.Restore(snapshot.memory);
+    KeepResetCode(code, size);
+    RestartHistory();
+}
+
+bool Simulator::SaveSnapshot(const std::string& path) const { return SnapshotFile::Write(path, Snapshot()); }
+
+bool Simulator::LoadSnapshot(const std::string& path)
+{
+    const vector<uint8_t> code = ReadResetCode();
+    const uint64_t size = m_memory.GetSize();
+    if (!SnapshotFile::Restore(path, m_cpu, m_memory)) {
+        return false;
+    }
+    KeepResetCode(code, size);
+    RestartHistory();
+    return true;
+}
+
+ElfError Simulator::LoadElf(const std::string& path, const uint64_t stackSize)
+{
+    ElfProgram program;
+    const ElfError error = ElfFile::Read(path, program);
+    if (error != ElfError::NONE) {
+        return error;
+    }
+
+    m_memory.ClearResetImage();
+    // the stack goes above the segments so pushing does not overwrite their data
+    const uint64_t stackEnd = program.memoryEnd + std::min(stackSize, ADDRESS_SPACE_SIZE);
+    const uint64_t memorySize = std::min(RoundUpToPage(stackEnd), ADDRESS_SPACE_SIZE);
+    if (m_memory.GetSize() < memorySize) {
+        m_memory.Resize(memorySize);
+    }
+    m_memory.Reset();
+    if (!ElfFile::Load(path, program, m_memory)) {
+        m_memory.Reset();
+        return ElfError::UNREADABLE;
+    }
+    m_cpu.SetProgramRange(program.codeBegin, program.codeEnd);
+    if (m_threadedEngine != nullptr) {
+        m_threadedEngine->Load();
+    }
+    m_symbols = std::move(program.symbols);
+
+    HartState state{};
+    state.registers[PC] = program.entry;
+    // the stack grows down from the end of the memory, 16-byte aligned as the calling convention wants it
+    const uint64_t stackTop = std::min<uint64_t>(m_memory.GetSize(), ADDRESS_SPACE_SIZE - 16) & ~15ull;
+    state.registers[2] = static_cast<uint32_t>(stackTop);
+    m_cpu.SetState(state);
+    SetResetImage();
+    RestartHistory();
+    return ElfError::NONE;
+}
+
+const vector<ElfSymbol>& Simulator::GetSymbols() const { return m_symbols; }
+
+void Simulator::EnableHistory(const uint64_t memoryBudget, const uint64_t checkpointInterval)
+{
+    delete m_history;
+    m_history = new History(memoryBudget, checkpointInterval);
+    RestartHistory();
+}
+
+void Simulator::DisableHistory()
+{
+    delete m_history;
+    m_history = nullptr;
+}
+
+uint64_t Simulator::ReverseStep(const uint64_t count)
+{
+    if (m_history == nullptr) {
+        return 0;
+    }
+    const uint64_t position = m_history->GetPosition();
+    const uint64_t target = position - std::min(count, position - m_history->GetOldestPosition());
+    Rewind(target);
+    return position - target;
+}
+
+uint64_t Simulator::ReverseContinue(const uint32_t pc)
+{
+    if (m_history == nullptr) {
+        return 0;
+    }
+    const uint64_t start = m_history->GetPosition();
+    // the undo records go back one instruction at a time
+    while (m_history->GetPosition() > m_history->GetUndoBegin()) {
+        Undo(m_history->GetPosition() - 1);
+        if (m_cpu.GetStatus().pc == pc) {
+            return start - m_history->GetPosition();
+        }
+    }
+
+    // before them, replay the stretches between checkpoints, the latest first
+    uint64_t end = m_history->GetPosition();
+    const Checkpoint* checkpoint = end > 0 ? m_history->FindCheckpoint(end - 1) : nullptr;
+    while (checkpoint != nullptr) {
+        // the history is only cut once the point is known
+        LoadCheckpoint(*checkpoint);
+        uint64_t found = end;
+        for (uint64_t position = checkpoint->position; position < end; position++) {
+            if (m_cpu.GetStatus().pc == pc) {
+                found = position;
+            }
+            if (position + 1 < end) {
+                StepEngine();
+            }
+        }
+        if (found != end) {
+            RestoreCheckpoint(*checkpoint, found);
+            return start - found;
+        }
+
+        end = checkpoint->position;
+        const Checkpoint* previous = end > 0 ? m_history->FindCheckpoint(end - 1) : nullptr;
+        if (previous == nullptr) {
+            // not found anywhere, stay at the oldest point
+            RestoreCheckpoint(*checkpoint, end);
+            return start - end;
+        }
+        checkpoint = previous;
+    }
+    return start - end;
+}
+
+vector<uint8_t> Simulator::ReadResetCode() const
+{
+    vector<uint8_t> code(m_cpu.GetProgramEnd() - m_cpu.GetProgramBegin());
+    m_memory.ReadResetImage(m_cpu.GetProgramBegin(), code);
+    return code;
+}
+
+void Simulator::KeepResetCode(const vector<uint8_t>& code, const uint64_t previousSize)
+{
+    // a restore of another size drops the reset image like ResizeMemory does, the same size keeps it and the
+    // pages a file restore mapped stay unread
+    if (m_memory.GetSize() != previousSize) {
+        m_memory.AddToResetImage(m_cpu.GetProgramBegin(), code);
+    }
+}
+
+bool Simulator::HasLimits() const
+{
+    return m_limits.maxInstructions != 0 || m_limits.maxTime != 0 || m_limits.maxMemory != 0;
+}
+
+bool Simulator::IsLimitExceeded() const
+{
+    return (m_limits.maxInstructions != 0 && m_executed >= m_limits.maxInstructions) ||
+        (m_limits.maxTime != 0 && m_executionTime >= m_limits.maxTime) ||
+        (m_limits.maxMemory != 0 && m_memory.GetFootprint() > m_limits.maxMemory);
+}
+
+ExecutionResult Simulator::StepEngine()
+{
+    if (m_threadedEngine != nullptr) {
+        return m_threadedEngine->Step();
+    }
+    return m_cpu.Step();
+}
+
+RunResult Simulator::RunEngine(const uint64_t maxInstructions)
+{
+    if (m_threadedEngine != nullptr) {
+        return m_threadedEngine->Run(maxInstructions);
+    }
+    return m_cpu.Run(maxInstructions);
+}
+
+void Simulator::RestartHistory()
+{
+    if (m_history != nullptr) {
+        m_history->Clear();
+        m_history->AddCheckpoint(Snapshot());
+    }
+}
+
+void Simulator::RecordFailure(const uint64_t position)
+{
+    // the failure reset the registers, get them back by replaying up to it
+    const Checkpoint* checkpoint = m_history->FindCheckpoint(position);
+    if (checkpoint == nullptr) {
+        return;
+    }
+    const HartState reset = m_cpu.GetState();
+    LoadCheckpoint(*checkpoint);
+    Replay(position - checkpoint->position);
+    m_history->AddCheckpoint(Snapshot());
+    m_cpu.SetState(reset);
+}
+
+void Simulator::Rewind(const uint64_t position)
+{
+    const uint64_t distance = m_history->GetPosition() - position;
+    const Checkpoint* checkpoint = m_history->FindCheckpoint(position);
+    if (position >= m_history->GetUndoBegin() &&
+        (checkpoint == nullptr || distance <= m_history->GetCheckpointInterval())) {
+        Undo(position);
+    }
+    else {
+        RestoreCheckpoint(*checkpoint, position);
+    }
+}
+
+void Simulator::Undo(const uint64_t position)
+{
+    HartState state = m_cpu.GetState();
+    while (m_history->GetPosition() > position) {
+        const UndoRecord& record = m_history->GetLastRecord();
+        if (record.failed) {
+            const Checkpoint* checkpoint = m_history->FindCheckpoint(m_history->GetPosition() - 1);
+            state = checkpoint->snapshot.hart;
+            m_memory.Restore(checkpoint->snapshot.memory);
+        }
+        else {
+            // x0 is always recorded with its value 0
+            state.registers[record.reg] = record.registerValue;
+            state.registers[PC] = record.pc;
+            state.retired--;
+            m_memory.WriteRange(record.address,
+                                span(reinterpret_cast<const uint8_t*>(&record.memoryValue), record.width));
+        }
+        m_history->Truncate(m_history->GetPosition() - 1);
+    }
+    m_cpu.SetState(state);
+}
+
+void Simulator::LoadCheckpoint(const Checkpoint& checkpoint)
+{
+    m_cpu.SetState(checkpoint.snapshot.hart);
+    m_memory.Restore(checkpoint.snapshot.memory);
+}
+
+void Simulator::RestoreCheckpoint(const Checkpoint& checkpoint, const uint64_t position)
+{
+    LoadCheckpoint(checkpoint);
+    Replay(position - checkpoint.position);
+    m_history->Truncate(position);
+}
 
-void Simulator::ResizeMemory(const uint32_t size) const { m_memory->Resize(size); }
-void Simulator::Reset() const
+void Simulator::Replay(uint64_t instructions)
 {
-    m_cpu->Reset();
-    m_memory->Reset();
+    while (instructions > 0) {
+        const RunResult result = RunEngine(instructions);
+        instructions -= result.instructions;
+        if (result.reason == StopReason::INSTRUCTION_FAILED) {
+            instructions--;
+        }
+        else if (result.reason == StopReason::HALTED) {
+            // cannot happen for instructions that have been executed before
+            break;
+        }
+    }
 }
@@ -2,28 +2,145 @@
 #define SIMULATOR_LIBRARY_H
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "CPU.h"
+#include "ElfFile.h"
+#include "History.h"
+#include "Jit.h"
 
 using std::vector;
 
+enum class ExecutionEngine
+{
+    // CPU::Step, the reference implementation
+    INTERPRETER,
+    THREADED,
+    BLOCK_CACHE,
+    // compiles hot blocks to x86-64, the block cache on other hosts
+    JIT
+};
+
+// Bounds on what a program may use, 0 for no bound. They are checked between Steps and between slices of
+// LIMIT_CHECK_INTERVAL instructions of a Run, so a run can go over them by up to one slice
+struct ExecutionLimits
+{
+    // instructions executed since the limits were set or the last reset
+    uint64_t maxInstructions;
+    // nanoseconds spent executing since the limits were set or the last reset
+    uint64_t maxTime;
+    // bytes of memory holding data, see Memory::GetFootprint
+    uint64_t maxMemory;
+};
+
+constexpr uint64_t LIMIT_CHECK_INTERVAL = 1 << 16;
+
 class Simulator
 {
 public:
-    explicit Simulator(uint32_t memorySize);
+    explicit Simulator(uint64_t memorySize, ExecutionEngine engine = ExecutionEngine::INTERPRETER,
+                       MemoryBackend backend = MemoryBackend::PAGED);
     Simulator();
     ~Simulator();
-    void SetInstructions(const vector<uint32_t>& instructions) const;
-    ExecutionResult Step() const;
+    // the CPU and the engine point into the simulator
+    Simulator(const Simulator&) = delete;
+    Simulator& operator=(const Simulator&) = delete;
+    // Writes the instructions to the memory from address 0 on, growing it to hold them, where they become part
+    // of what Reset goes back to. Loads see them like any other data
+    void SetInstructions(const vector<uint32_t>& instructions);
+    // fails with LIMIT_EXCEEDED without executing anything once a limit has been used up
+    ExecutionResult Step();
+    // Executes up to maxInstructions in one go, only the summary is reported. Stops with LIMIT_REACHED and
+    // the error LIMIT_EXCEEDED once a limit has been used up
+    RunResult Run(uint64_t maxInstructions);
+    // Runs until the program ends or fails, does not return for programs that loop forever unless limits are set
+    RunResult RunUntilHalt();
+    // restarts counting the instructions and time
+    void SetLimits(const ExecutionLimits& limits);
+    ExecutionLimits GetLimits() const;
     CpuStatus GetCpuStatus() const;
+    // copies all of the memory, prefer the page views for anything but small memories
     vector<uint32_t> GetMemory() const;
-    void ResizeMemory(uint32_t size) const;
-    void Reset() const;
+    uint64_t GetMemorySize() const;
+    MemoryPageView ViewMemoryPage(uint32_t address) const;
+    MemoryPages GetMemoryPages() const;
+    // pages stored to since the previous call, see Memory::CollectDirtyPages
+    vector<MemoryPageView> CollectMemoryDiff();
+    // false without writing anything if the data does not fit into the memory
+    bool WriteMemory(uint32_t address, span<const uint8_t> data);
+    // drops the reset image apart from the code, the memory never gets smaller than the code
+    void ResizeMemory(uint64_t size);
+    // Goes back to the reset image, or zeros without one. Costs time in the pages written since the last reset
+    void Reset();
+    // the current registers and memory, such as those of a loaded program, become what Reset goes back to
+    void SetResetImage();
+    // Reset goes back to the code and zeros
+    void ClearResetImage();
+    // Costs time and space in the number of written pages, which stay shared until either side
+    // writes them again. See Memory::Snapshot
+    SimulatorSnapshot Snapshot() const;
+    void Restore(const SimulatorSnapshot& snapshot);
+    // Writes the registers and memory to a file, see SnapshotFile. False if that fails
+    bool SaveSnapshot(const std::string& path) const;
+    // Restores a file written by SaveSnapshot, mapping its pages copy-on-write where the host supports it,
+    // so only the pages a run touches are ever read. False without changing anything for invalid files
+    bool LoadSnapshot(const std::string& path);
+    // Loads a statically linked RV32 executable, see ElfFile, in place of the instructions and memory contents.
+    // The memory grows to hold the segments and stackSize bytes above them, pc starts at the entry point and sp
+    // at the end of the memory, and Reset goes back to that. Returns why the file is not a valid executable
+    // without changing anything
+    ElfError LoadElf(const std::string& path, uint64_t stackSize = ELF_DEFAULT_STACK_SIZE);
+    // functions and objects of the loaded executable in address order, empty for other programs
+    const vector<ElfSymbol>& GetSymbols() const;
+    // Records the instructions executed from now on so they can be gone back over, keeping about
+    // memoryBudget bytes of history. Reset, SetInstructions, ResizeMemory and Restore start it over
+    void EnableHistory(uint64_t memoryBudget, uint64_t checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL);
+    void DisableHistory();
+    // Goes back up to count instructions, as far as the history reaches, and returns how many.
+    // May restore the memory, which like Reset clears its diff
+    uint64_t ReverseStep(uint64_t count = 1);
+    // Goes back to the latest earlier point about to execute the instruction at pc,
+    // or to the oldest one in the history, and returns by how many instructions
+    uint64_t ReverseContinue(uint32_t pc);
 
 private:
-    Memory* m_memory;
-    CPU* m_cpu;
+    // the code as Reset brings it back
+    vector<uint8_t> ReadResetCode() const;
+    // puts the code read before a restore back into the reset image if the restore resized the memory
+    void KeepResetCode(const vector<uint8_t>& code, uint64_t previousSize);
+    bool HasLimits() const;
+    bool IsLimitExceeded() const;
+    // Step and Run without the limits, recording the history if it is enabled
+    ExecutionResult StepRecorded();
+    RunResult RunRecorded(uint64_t maxInstructions);
+    ExecutionResult StepEngine();
+    RunResult RunEngine(uint64_t maxInstructions);
+    void RestartHistory();
+    // keeps the state before an instruction that failed inside Run
+    void RecordFailure(uint64_t position);
+    void Rewind(uint64_t position);
+    void Undo(uint64_t position);
+    void LoadCheckpoint(const Checkpoint& checkpoint);
+    // goes to the position, which is between the checkpoint and the current one, by replaying from the checkpoint
+    void RestoreCheckpoint(const Checkpoint& checkpoint, uint64_t position);
+    // executes instructions that have been executed before, including failing ones
+    void Replay(uint64_t instructions);
+
+    // owned by value so a simulator is a single allocation apart from the engine
+    Memory m_memory;
+    CPU m_cpu;
+    ExecutionEngine m_engine;
+    // threaded interpreter or an engine built on it, nullptr for the reference interpreter
+    ThreadedInterpreter* m_threadedEngine;
+    // nullptr unless the history is enabled
+    History* m_history;
+    HartState m_resetState;
+    vector<ElfSymbol> m_symbols;
+    ExecutionLimits m_limits;
+    // counted towards the limits, only while there are any
+    uint64_t m_executed;
+    uint64_t m_executionTime;
 };
 
 #endif // SIMULATOR_LIBRARY_H
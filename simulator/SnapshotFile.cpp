@@ -0,0 +1,190 @@
+#include "SnapshotFile.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef SNAPSHOT_FILE_MAPPING
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr char SNAPSHOT_FILE_MAGIC[8] = {'R', 'V', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+static bool IsZeroPage(const uint8_t* data)
+{
+    return std::all_of(data, data + MEMORY_PAGE_SIZE, [](const uint8_t byte) { return byte == 0; });
+}
+
+static HartState GetHartState(const SnapshotFileHeader& header)
+{
+    HartState state{};
+    std::ranges::copy(header.registers, state.registers.begin());
+    state.retired = header.retired;
+    return state;
+}
+
+// reads the header and the page numbers and checks that they describe a snapshot the file holds completely
+static bool ReadLayout(std::ifstream& file, SnapshotFileHeader& header, vector<uint32_t>& pages)
+{
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    if (!std::ranges::equal(header.magic, SNAPSHOT_FILE_MAGIC) || header.version != SNAPSHOT_FILE_VERSION ||
+        header.pageSize != MEMORY_PAGE_SIZE || header.memorySize > ADDRESS_SPACE_SIZE ||
+        header.payloadOffset % MEMORY_PAGE_SIZE != 0 || header.payloadOffset > fileSize) {
+        return false;
+    }
+
+    const uint64_t pageEnd = RoundUpToPage(header.memorySize) >> MEMORY_PAGE_BITS;
+    if (header.pageCount > pageEnd || header.payloadOffset < sizeof(header) + header.pageCount * sizeof(uint32_t) ||
+        fileSize - header.payloadOffset < header.pageCount * MEMORY_PAGE_SIZE) {
+        return false;
+    }
+    pages.resize(header.pageCount);
+    const auto tableSize = static_cast<std::streamsize>(pages.size() * sizeof(uint32_t));
+    if (!file.read(reinterpret_cast<char*>(pages.data()), tableSize)) {
+        return false;
+    }
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i] >= pageEnd || (i > 0 && pages[i] <= pages[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef SNAPSHOT_FILE_MAPPING
+// private writable mapping of the pages, unmapped once the last page sharing it is gone
+static std::shared_ptr<uint8_t> MapPayload(const string& path, const SnapshotFileHeader& header)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return nullptr;
+    }
+    const size_t length = header.pageCount * MEMORY_PAGE_SIZE;
+    void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor,
+                        static_cast<off_t>(header.payloadOffset));
+    close(descriptor);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+    return {static_cast<uint8_t*>(mapped), [length](uint8_t* data) { munmap(data, length); }};
+}
+#endif
+
+bool SnapshotFile::Write(const string& path, const SimulatorSnapshot& snapshot)
+{
+    // pages of zeros read the same without being stored
+    vector<const SnapshotPage*> pages;
+    for (const SnapshotPage& page : snapshot.memory.pages) {
+        if (!IsZeroPage(page.second.get())) {
+            pages.push_back(&page);
+        }
+    }
+
+    SnapshotFileHeader header{};
+    std::ranges::copy(SNAPSHOT_FILE_MAGIC, header.magic);
+    header.version = SNAPSHOT_FILE_VERSION;
+    header.pageSize = MEMORY_PAGE_SIZE;
+    header.memorySize = snapshot.memory.size;
+    header.pageCount = pages.size();
+    header.payloadOffset = RoundUpToPage(sizeof(header) + pages.size() * sizeof(uint32_t));
+    header.retired = snapshot.hart.retired;
+    std::ranges::copy(snapshot.hart.registers, header.registers);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const SnapshotPage* page : pages) {
+        file.write(reinterpret_cast<const char*>(&page->first), sizeof(uint32_t));
+    }
+    const vector<char> padding(header.payloadOffset - sizeof(header) - pages.size() * sizeof(uint32_t), 0);
+    file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    for (const SnapshotPage* page : pages) {
+        file.write(reinterpret_cast<const char*>(page->second.get()), MEMORY_PAGE_SIZE);
+    }
+    file.flush();
+    return file.good();
+}
+
+bool SnapshotFile::Read(const string& path, SimulatorSnapshot& snapshot)
+{
+    std::ifstream file(path, std::ios::binary);
+    SnapshotFileHeader header;
+    vector<uint32_t> pages;
+    if (!file || !ReadLayout(file, header, pages)) {
+        return false;
+    }
+
+    SimulatorSnapshot result{GetHartState(header), {header.memorySize, {}}};
+    result.memory.pages.reserve(pages.size());
+#ifdef SNAPSHOT_FILE_MAPPING
+    if (const std::shared_ptr<uint8_t> payload = pages.empty() ? nullptr : MapPayload(path, header)) {
+        for (size_t i = 0; i < pages.size(); i++) {
+            // each page shares the ownership of the whole mapping
+            const uint8_t* data = payload.get() + i * MEMORY_PAGE_SIZE;
+            result.memory.pages.emplace_back(pages[i], std::shared_ptr<const uint8_t[]>(payload, data));
+        }
+        snapshot = std::move(result);
+        return true;
+    }
+#endif
+
+    file.seekg(static_cast<std::streamoff>(header.payloadOffset));
+    for (const uint32_t page : pages) {
+        std::shared_ptr<uint8_t[]> data = std::make_shared<uint8_t[]>(MEMORY_PAGE_SIZE);
+        if (!file.read(reinterpret_cast<char*>(data.get()), MEMORY_PAGE_SIZE)) {
+            return false;
+        }
+        result.memory.pages.emplace_back(page, std::move(data));
+    }
+    snapshot = std::move(result);
+    return true;
+}
+
+bool SnapshotFile::Restore(const string& path, CPU& cpu, Memory& memory)
+{
+#ifdef SNAPSHOT_FILE_MAPPING
+    if (memory.GetBackend() == MemoryBackend::RESERVED) {
+        std::ifstream file(path, std::ios::binary);
+        SnapshotFileHeader header;
+        vector<uint32_t> pages;
+        if (!file || !ReadLayout(file, header, pages)) {
+            return false;
+        }
+
+        const int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor >= 0) {
+            memory.Restore({header.memorySize, {}});
+            bool mapped = true;
+            // one mapping for each run of consecutive pages
+            for (size_t first = 0; first < pages.size() && mapped;) {
+                size_t last = first + 1;
+                while (last < pages.size() && pages[last] == pages[last - 1] + 1) {
+                    last++;
+                }
+                mapped = memory.MapFile(descriptor, header.payloadOffset + first * MEMORY_PAGE_SIZE, pages[first],
+                                        static_cast<uint32_t>(last - first));
+                first = last;
+            }
+            close(descriptor);
+            if (mapped) {
+                cpu.SetState(GetHartState(header));
+                return true;
+            }
+        }
+        // otherwise the pages are copied in
+    }
+#endif
+
+    SimulatorSnapshot snapshot;
+    if (!Read(path, snapshot)) {
+        return false;
+    }
+    cpu.SetState(snapshot.hart);
+    memory.Restore(snapshot.memory);
+    return true;
+}
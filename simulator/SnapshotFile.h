@@ -0,0 +1,49 @@
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+#include <cstdint>
+#include <string>
+
+#include "CPU.h"
+#include "History.h"
+
+using std::string;
+
+#if !defined(_WIN32)
+#define SNAPSHOT_FILE_MAPPING
+#endif
+
+constexpr uint32_t SNAPSHOT_FILE_VERSION = 1;
+
+// Start of a snapshot file. It is followed by the numbers of the pages that hold data in address order,
+// zeros up to the next page boundary and then the contents of those pages, a whole page each in the
+// same order, so they can be mapped straight into memory. Everything is little-endian
+struct SnapshotFileHeader
+{
+    // "RVSNAP" followed by two zeros
+    char magic[8];
+    uint32_t version;
+    uint32_t pageSize;
+    uint64_t memorySize;
+    uint64_t pageCount;
+    // file offset of the first page, a multiple of the page size
+    uint64_t payloadOffset;
+    uint64_t retired;
+    uint32_t registers[33];
+    uint32_t padding;
+};
+
+// Reads and writes snapshots of a simulator as files, to start many runs from one warmed up state
+class SnapshotFile
+{
+public:
+    // false if the file could not be written completely
+    static bool Write(const string& path, const SimulatorSnapshot& snapshot);
+    // Where supported, the pages are views of a private mapping of the file which the host only reads
+    // once they are accessed, elsewhere they are read. False if the file is not a valid snapshot
+    static bool Read(const string& path, SimulatorSnapshot& snapshot);
+    // Same as restoring the result of Read, but the reserved backend maps the pages straight into the memory.
+    // False without changing anything if the file is not a valid snapshot
+    static bool Restore(const string& path, CPU& cpu, Memory& memory);
+};
+
+#endif // SNAPSHOTFILE_H
@@ -0,0 +1,544 @@
+#include "ThreadedInterpreter.h"
+
+#include <algorithm>
+
+#include "BitManipulation.h"
+#include "MultiplyDivide.h"
+
+static uint32_t Add(const uint32_t a, const uint32_t b) { return a + b; }
+static uint32_t Sub(const uint32_t a, const uint32_t b) { return a - b; }
+static uint32_t ShiftLeft(const uint32_t a, const uint32_t b) { return a << (b & 31); }
+static uint32_t ShiftRight(const uint32_t a, const uint32_t b) { return a >> (b & 31); }
+static uint32_t ShiftRightArithmetic(const uint32_t a, const uint32_t b)
+{
+    return static_cast<int32_t>(a) >> (b & 31);
+}
+static uint32_t LessThan(const uint32_t a, const uint32_t b)
+{
+    return static_cast<int32_t>(a) < static_cast<int32_t>(b);
+}
+static uint32_t LessThanUnsigned(const uint32_t a, const uint32_t b) { return a < b; }
+static uint32_t Xor(const uint32_t a, const uint32_t b) { return a ^ b; }
+static uint32_t Or(const uint32_t a, const uint32_t b) { return a | b; }
+static uint32_t And(const uint32_t a, const uint32_t b) { return a & b; }
+
+static bool Equal(const uint32_t a, const uint32_t b) { return a == b; }
+static bool NotEqual(const uint32_t a, const uint32_t b) { return a != b; }
+static bool Less(const uint32_t a, const uint32_t b) { return static_cast<int32_t>(a) < static_cast<int32_t>(b); }
+static bool GreaterEqual(const uint32_t a, const uint32_t b)
+{
+    return static_cast<int32_t>(a) >= static_cast<int32_t>(b);
+}
+static bool LessUnsigned(const uint32_t a, const uint32_t b) { return a < b; }
+static bool GreaterEqualUnsigned(const uint32_t a, const uint32_t b) { return a >= b; }
+
+static const ThreadedOp* Fail(ThreadedContext& context, const ThreadedOp* op, const ExecutionError error)
+{
+    context.error = error;
+    context.errorOp = op;
+    return context.end;
+}
+
+static uint32_t GetPC(const ThreadedContext& context, const ThreadedOp* op)
+{
+    return context.codeBegin + static_cast<uint32_t>(op - context.base) * INSTRUCTION_ALIGNMENT;
+}
+
+// the op of the instruction after this one
+static const ThreadedOp* Next(const ThreadedOp* op) { return op + op->instruction.size / INSTRUCTION_ALIGNMENT; }
+
+static const ThreadedOp* ChangeCode(ThreadedContext& context, const ThreadedOp* op)
+{
+    context.codeChange = op;
+    context.exitPc = GetPC(context, op) + op->instruction.size;
+    return context.end;
+}
+
+static const ThreadedOp* Jump(ThreadedContext& context, const ThreadedOp* op)
+{
+    if (op->next == context.end) {
+        context.exitPc = op->instruction.target;
+    }
+    return op->next;
+}
+
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+static const ThreadedOp* RegisterHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    Registers* registers = context.registers;
+    const DecodedInstruction& instruction = op->instruction;
+    registers->SetRegister(instruction.rd,
+                           Function(registers->GetRegister(instruction.rs1), registers->GetRegister(instruction.rs2)));
+    return Next(op);
+}
+
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+static const ThreadedOp* ImmediateHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    Registers* registers = context.registers;
+    const DecodedInstruction& instruction = op->instruction;
+    registers->SetRegister(instruction.rd,
+                           Function(registers->GetRegister(instruction.rs1), static_cast<uint32_t>(instruction.imm)));
+    return Next(op);
+}
+
+template <uint32_t (*Function)(uint32_t)>
+static const ThreadedOp* UnaryHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    Registers* registers = context.registers;
+    const DecodedInstruction& instruction = op->instruction;
+    registers->SetRegister(instruction.rd, Function(registers->GetRegister(instruction.rs1)));
+    return Next(op);
+}
+
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+static const ThreadedOp* DivisionHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    Registers* registers = context.registers;
+    const DecodedInstruction& instruction = op->instruction;
+    const uint32_t divisor = registers->GetRegister(instruction.rs2);
+    if (divisor == 0) {
+        return Fail(context, op, ExecutionError::DIVISION_BY_ZERO);
+    }
+    registers->SetRegister(instruction.rd, Function(registers->GetRegister(instruction.rs1), divisor));
+    return Next(op);
+}
+
+// signed T are sign extended to the register
+template <typename T>
+static const ThreadedOp* LoadHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    const DecodedInstruction& instruction = op->instruction;
+    T value;
+    if (!context.memory->Load(context.registers->GetRegister(instruction.rs1) + instruction.imm, value)) {
+        return Fail(context, op, ExecutionError::INVALID_MEMORY_ACCESS);
+    }
+    context.registers->SetRegister(instruction.rd, static_cast<uint32_t>(value));
+    return Next(op);
+}
+
+template <typename T>
+static const ThreadedOp* StoreHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    const DecodedInstruction& instruction = op->instruction;
+    const uint32_t address = context.registers->GetRegister(instruction.rs1) + instruction.imm;
+    if (!context.memory->Store(address, static_cast<T>(context.registers->GetRegister(instruction.rs2)))) {
+        return Fail(context, op, ExecutionError::INVALID_MEMORY_ACCESS);
+    }
+    if (context.memory->HasCodeChanges()) {
+        return ChangeCode(context, op);
+    }
+    return Next(op);
+}
+
+template <bool (*Condition)(uint32_t, uint32_t)>
+static const ThreadedOp* BranchHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    const DecodedInstruction& instruction = op->instruction;
+    if (Condition(context.registers->GetRegister(instruction.rs1), context.registers->GetRegister(instruction.rs2))) {
+        return Jump(context, op);
+    }
+    return Next(op);
+}
+
+static const ThreadedOp* JALHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    context.registers->SetRegister(op->instruction.rd, GetPC(context, op) + op->instruction.size);
+    return Jump(context, op);
+}
+
+static const ThreadedOp* JALRHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    const DecodedInstruction& instruction = op->instruction;
+    // read before rd is written, which can be rs1
+    const uint32_t target = (context.registers->GetRegister(instruction.rs1) + instruction.imm) & ~1u;
+    context.registers->SetRegister(instruction.rd, GetPC(context, op) + instruction.size);
+    // wraps around to far out of the program for targets in front of it
+    const uint32_t offset = target - context.codeBegin;
+    if (offset / INSTRUCTION_ALIGNMENT >= static_cast<uint32_t>(context.end - context.base)) {
+        context.exitPc = target;
+        return context.end;
+    }
+    return context.base + offset / INSTRUCTION_ALIGNMENT;
+}
+
+static const ThreadedOp* LUIHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    context.registers->SetRegister(op->instruction.rd, op->instruction.imm);
+    return Next(op);
+}
+
+static const ThreadedOp* AUIPCHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    context.registers->SetRegister(op->instruction.rd, op->instruction.target);
+    return Next(op);
+}
+
+static const ThreadedOp* FenceHandler(ThreadedContext&, const ThreadedOp* op) { return Next(op); }
+
+static const ThreadedOp* FenceIHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    context.memory->InvalidateCode();
+    return ChangeCode(context, op);
+}
+
+static const ThreadedOp* UnsupportedHandler(ThreadedContext& context, const ThreadedOp* op)
+{
+    return Fail(context, op, ExecutionError::UNSUPPORTED_OPCODE);
+}
+
+ThreadedInterpreter::ThreadedInterpreter(CPU* cpu) : m_cpu(cpu), m_ops(1, {nullptr, nullptr, {}}) {}
+
+void ThreadedInterpreter::Load()
+{
+    const size_t size = m_cpu->m_program.size();
+    m_ops.assign(size + 1, {nullptr, nullptr, {}});
+    // all of it is decoded from here on, the changes so far are part of that
+    uint64_t begin;
+    uint64_t end;
+    m_cpu->CollectCodeChanges(begin, end);
+    for (uint32_t i = 0; i < size; i++) {
+        Decode(i);
+    }
+}
+
+uint32_t ThreadedInterpreter::GetIndex(const uint32_t pc) const
+{
+    // wraps around to far out of the program for a pc in front of it
+    const uint32_t index = (pc - m_cpu->m_programBegin) / INSTRUCTION_ALIGNMENT;
+    return static_cast<uint32_t>(std::min<size_t>(index, m_ops.size() - 1));
+}
+
+uint32_t ThreadedInterpreter::GetAddress(const uint32_t index) const
+{
+    return m_cpu->m_programBegin + index * INSTRUCTION_ALIGNMENT;
+}
+
+void ThreadedInterpreter::Decode(const uint32_t index)
+{
+    const DecodedInstruction instruction = m_cpu->Fetch(GetAddress(index));
+    m_ops[index].handler = GetHandler(instruction.operation);
+    m_ops[index].instruction = instruction;
+    m_ops[index].next = &m_ops[GetIndex(instruction.target)];
+}
+
+void ThreadedInterpreter::Invalidate(const uint32_t first, const uint32_t last)
+{
+    for (uint32_t i = first; i <= last; i++) {
+        Decode(i);
+    }
+}
+
+void ThreadedInterpreter::SyncCode()
+{
+    uint64_t begin;
+    uint64_t end;
+    if (!m_cpu->CollectCodeChanges(begin, end)) {
+        return;
+    }
+    const uint64_t size = m_ops.size() - 1;
+    // the changes are inside the program, an instruction starting in front of one may reach into it
+    begin -= m_cpu->m_programBegin;
+    end -= m_cpu->m_programBegin;
+    const uint64_t first = std::max<uint64_t>(begin / INSTRUCTION_ALIGNMENT, 1) - 1;
+    if (first < size) {
+        const uint64_t last = std::min((end + INSTRUCTION_ALIGNMENT - 1) / INSTRUCTION_ALIGNMENT, size) - 1;
+        Invalidate(static_cast<uint32_t>(first), static_cast<uint32_t>(last));
+    }
+}
+
+const ThreadedOp* ThreadedInterpreter::Resume(ThreadedContext& context)
+{
+    // the ops do not move, only their contents change
+    const ThreadedOp* next = Next(context.codeChange);
+    context.codeChange = nullptr;
+    // exitPc was the pc after the change, falling off the end from here on has to come out at the end
+    context.exitPc = GetPC(context, context.end);
+    SyncCode();
+    return next;
+}
+
+uint64_t ThreadedInterpreter::CountInstructions(const ThreadedOp* from, const ThreadedOp* to)
+{
+    uint64_t count = 0;
+    for (const ThreadedOp* op = from; op < to; op = Next(op)) {
+        count++;
+    }
+    return count;
+}
+
+const ThreadedOp* ThreadedInterpreter::Dispatch(ThreadedContext& context, const ThreadedOp* op,
+                                                const uint64_t maxInstructions, uint64_t& executed)
+{
+    while (true) {
+        while (op != context.end && executed < maxInstructions) {
+            op = op->handler(context, op);
+            executed++;
+        }
+        if (context.codeChange == nullptr) {
+            return op;
+        }
+        op = Resume(context);
+    }
+}
+
+ExecutionResult ThreadedInterpreter::Step()
+{
+    SyncCode();
+    Registers* registers = &m_cpu->m_registers;
+    const uint32_t pc = registers->GetPC();
+    const uint32_t index = GetIndex(pc);
+    if (index >= m_ops.size() - 1) {
+        return CPUUtil::ExecutionErrorResult(ExecutionError::PC_OUT_OF_BOUNDS);
+    }
+
+    ThreadedContext context = CreateContext();
+    const ThreadedOp* op = &m_ops[index];
+    const DecodedInstruction& instruction = op->instruction;
+    const uint32_t address = registers->GetRegister(instruction.rs1) + instruction.imm;
+    const ThreadedOp* next = op->handler(context, op);
+
+    if (context.error != ExecutionError::NONE) {
+        ExecutionResult result = CPUUtil::ExecutionErrorResult(context.error);
+        result.errorPc = pc;
+        m_cpu->Reset();
+        result.pc = registers->GetPC();
+        return result;
+    }
+    WriteBackPC(context, next);
+    registers->AddRetired(1);
+
+    ExecutionResult result;
+    switch (instruction.operation) {
+    case Operation::SB:
+    case Operation::SH:
+    case Operation::SW:
+        {
+            result = m_cpu->StoreResult(address);
+            break;
+        }
+    case Operation::BEQ:
+    case Operation::BNE:
+    case Operation::BLT:
+    case Operation::BGE:
+    case Operation::BLTU:
+    case Operation::BGEU:
+        {
+            result = {true, ExecutionError::NONE, false, {0, 0}, false, {0, 0}};
+            break;
+        }
+    default:
+        {
+            result = {
+                true, ExecutionError::NONE, false, {0, 0}, true, {instruction.rd, registers->GetRegister(instruction.rd)}};
+            break;
+        }
+    }
+    result.pc = registers->GetPC();
+    return result;
+}
+
+RunResult ThreadedInterpreter::Run(const uint64_t maxInstructions)
+{
+    SyncCode();
+    Registers* registers = &m_cpu->m_registers;
+    const uint32_t index = GetIndex(registers->GetPC());
+    if (index >= m_ops.size() - 1) {
+        return {0, ExecutionError::PC_OUT_OF_BOUNDS, registers->GetPC(), 0, StopReason::HALTED};
+    }
+
+    ThreadedContext context = CreateContext();
+    uint64_t executed = 0;
+    const ThreadedOp* op = Dispatch(context, &m_ops[index], maxInstructions, executed);
+
+    if (context.error != ExecutionError::NONE) {
+        return Failed(context, executed - 1);
+    }
+    return Finished(context, op, executed);
+}
+
+RunResult ThreadedInterpreter::Failed(const ThreadedContext& context, const uint64_t executed) const
+{
+    m_cpu->Reset();
+    const uint32_t errorPc = GetPC(context, context.errorOp);
+    return {executed, context.error, m_cpu->m_registers.GetPC(), errorPc, StopReason::INSTRUCTION_FAILED};
+}
+
+RunResult ThreadedInterpreter::Finished(const ThreadedContext& context, const ThreadedOp* op,
+                                        const uint64_t executed) const
+{
+    WriteBackPC(context, op);
+    m_cpu->m_registers.AddRetired(executed);
+    if (op == context.end) {
+        return {executed, ExecutionError::PC_OUT_OF_BOUNDS, m_cpu->m_registers.GetPC(), 0, StopReason::HALTED};
+    }
+    return {executed, ExecutionError::NONE, m_cpu->m_registers.GetPC(), 0, StopReason::LIMIT_REACHED};
+}
+
+ThreadedContext ThreadedInterpreter::CreateContext() const
+{
+    const ThreadedOp* end = &m_ops.back();
+    return {&m_cpu->m_registers,
+            m_cpu->m_memory,
+            m_ops.data(),
+            end,
+            m_cpu->m_programBegin,
+            GetAddress(static_cast<uint32_t>(end - m_ops.data())),
+            ExecutionError::NONE,
+            nullptr,
+            nullptr};
+}
+
+void ThreadedInterpreter::WriteBackPC(const ThreadedContext& context, const ThreadedOp* op) const
+{
+    if (op == context.end) {
+        m_cpu->m_registers.SetPC(context.exitPc);
+    }
+    else {
+        m_cpu->m_registers.SetPC(GetPC(context, op));
+    }
+}
+
+Handler ThreadedInterpreter::GetHandler(const Operation operation)
+{
+    switch (operation) {
+    case Operation::ADD:
+        return RegisterHandler<Add>;
+    case Operation::SUB:
+        return RegisterHandler<Sub>;
+    case Operation::SLL:
+        return RegisterHandler<ShiftLeft>;
+    case Operation::SLT:
+        return RegisterHandler<LessThan>;
+    case Operation::SLTU:
+        return RegisterHandler<LessThanUnsigned>;
+    case Operation::XOR:
+        return RegisterHandler<Xor>;
+    case Operation::SRL:
+        return RegisterHandler<ShiftRight>;
+    case Operation::SRA:
+        return RegisterHandler<ShiftRightArithmetic>;
+    case Operation::OR:
+        return RegisterHandler<Or>;
+    case Operation::AND:
+        return RegisterHandler<And>;
+    case Operation::ADDI:
+        return ImmediateHandler<Add>;
+    case Operation::SLTI:
+        return ImmediateHandler<LessThan>;
+    case Operation::SLTIU:
+        return ImmediateHandler<LessThanUnsigned>;
+    case Operation::XORI:
+        return ImmediateHandler<Xor>;
+    case Operation::ORI:
+        return ImmediateHandler<Or>;
+    case Operation::ANDI:
+        return ImmediateHandler<And>;
+    case Operation::SLLI:
+        return ImmediateHandler<ShiftLeft>;
+    case Operation::SRLI:
+        return ImmediateHandler<ShiftRight>;
+    case Operation::SRAI:
+        return ImmediateHandler<ShiftRightArithmetic>;
+    case Operation::LB:
+        return LoadHandler<int8_t>;
+    case Operation::LH:
+        return LoadHandler<int16_t>;
+    case Operation::LW:
+        return LoadHandler<uint32_t>;
+    case Operation::LBU:
+        return LoadHandler<uint8_t>;
+    case Operation::LHU:
+        return LoadHandler<uint16_t>;
+    case Operation::SB:
+        return StoreHandler<uint8_t>;
+    case Operation::SH:
+        return StoreHandler<uint16_t>;
+    case Operation::SW:
+        return StoreHandler<uint32_t>;
+    case Operation::BEQ:
+        return BranchHandler<Equal>;
+    case Operation::BNE:
+        return BranchHandler<NotEqual>;
+    case Operation::BLT:
+        return BranchHandler<Less>;
+    case Operation::BGE:
+        return BranchHandler<GreaterEqual>;
+    case Operation::BLTU:
+        return BranchHandler<LessUnsigned>;
+    case Operation::BGEU:
+        return BranchHandler<GreaterEqualUnsigned>;
+    case Operation::JAL:
+        return JALHandler;
+    case Operation::JALR:
+        return JALRHandler;
+    case Operation::LUI:
+        return LUIHandler;
+    case Operation::AUIPC:
+        return AUIPCHandler;
+    case Operation::MUL:
+        return RegisterHandler<MultiplyDivide::Mul>;
+    case Operation::MULH:
+        return RegisterHandler<MultiplyDivide::MulHigh>;
+    case Operation::MULHSU:
+        return RegisterHandler<MultiplyDivide::MulHighSignedUnsigned>;
+    case Operation::MULHU:
+        return RegisterHandler<MultiplyDivide::MulHighUnsigned>;
+    case Operation::DIV:
+        return DivisionHandler<MultiplyDivide::Div>;
+    case Operation::DIVU:
+        return DivisionHandler<MultiplyDivide::DivUnsigned>;
+    case Operation::REM:
+        return DivisionHandler<MultiplyDivide::Rem>;
+    case Operation::REMU:
+        return DivisionHandler<MultiplyDivide::RemUnsigned>;
+    case Operation::SH1ADD:
+        return RegisterHandler<BitManipulation::ShiftAdd<1>>;
+    case Operation::SH2ADD:
+        return RegisterHandler<BitManipulation::ShiftAdd<2>>;
+    case Operation::SH3ADD:
+        return RegisterHandler<BitManipulation::ShiftAdd<3>>;
+    case Operation::ANDN:
+        return RegisterHandler<BitManipulation::AndNot>;
+    case Operation::ORN:
+        return RegisterHandler<BitManipulation::OrNot>;
+    case Operation::XNOR:
+        return RegisterHandler<BitManipulation::XorNot>;
+    case Operation::MIN:
+        return RegisterHandler<BitManipulation::Min>;
+    case Operation::MINU:
+        return RegisterHandler<BitManipulation::MinUnsigned>;
+    case Operation::MAX:
+        return RegisterHandler<BitManipulation::Max>;
+    case Operation::MAXU:
+        return RegisterHandler<BitManipulation::MaxUnsigned>;
+    case Operation::ROL:
+        return RegisterHandler<BitManipulation::RotateLeft>;
+    case Operation::ROR:
+        return RegisterHandler<BitManipulation::RotateRight>;
+    case Operation::RORI:
+        return ImmediateHandler<BitManipulation::RotateRight>;
+    case Operation::CLZ:
+        return UnaryHandler<BitManipulation::CountLeadingZeros>;
+    case Operation::CTZ:
+        return UnaryHandler<BitManipulation::CountTrailingZeros>;
+    case Operation::CPOP:
+        return UnaryHandler<BitManipulation::PopCount>;
+    case Operation::SEXT_B:
+        return UnaryHandler<BitManipulation::SignExtendByte>;
+    case Operation::SEXT_H:
+        return UnaryHandler<BitManipulation::SignExtendHalf>;
+    case Operation::ZEXT_H:
+        return UnaryHandler<BitManipulation::ZeroExtendHalf>;
+    case Operation::ORC_B:
+        return UnaryHandler<BitManipulation::OrCombineBytes>;
+    case Operation::REV8:
+        return UnaryHandler<BitManipulation::ReverseBytes>;
+    case Operation::FENCE:
+        return FenceHandler;
+    case Operation::FENCE_I:
+        return FenceIHandler;
+    default:
+        return UnsupportedHandler;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef THREADEDINTERPRETER_H
+#define THREADEDINTERPRETER_H
+#include <cstdint>
+#include <vector>
+
+#include "CPU.h"
+
+using std::vector;
+
+struct ThreadedOp;
+struct ThreadedContext;
+
+// Executes the op and returns the op to continue with
+using Handler = const ThreadedOp* (*)(ThreadedContext& context, const ThreadedOp* op);
+
+struct ThreadedOp
+{
+    Handler handler;
+    // branch/jump target, the end of the program if the target is out of bounds
+    const ThreadedOp* next;
+    DecodedInstruction instruction;
+};
+
+struct ThreadedContext
+{
+    Registers* registers;
+    Memory* memory;
+    const ThreadedOp* base;
+    const ThreadedOp* end;
+    // pc of the op at base, the start of the program
+    uint32_t codeBegin;
+    // pc to continue at once the end of the program is reached
+    uint32_t exitPc;
+    ExecutionError error;
+    const ThreadedOp* errorOp;
+    // Store or FENCE.I that changed the code, nullptr if none did. It ends the dispatch like a failure,
+    // so the ops after it are decoded again before going on
+    const ThreadedOp* codeChange;
+};
+
+// Alternative to CPU::Step which resolves every instruction of the decoded program
+// to a handler up front, so executing an instruction is a single indirect call.
+// There is an op for every INSTRUCTION_ALIGNMENT bytes of the code from the start of the program on, so any pc
+// in the program has one, and an op is followed
+// by the op of the next instruction one or two ops later, depending on its size.
+// Stores to the code are seen through CPU::CollectCodeChanges, only the ops they changed are decoded again
+class ThreadedInterpreter
+{
+public:
+    explicit ThreadedInterpreter(CPU* cpu);
+    virtual ~ThreadedInterpreter() = default;
+    // Rebuilds the ops from the program loaded into the CPU
+    virtual void Load();
+    ExecutionResult Step();
+    virtual RunResult Run(uint64_t maxInstructions);
+
+protected:
+    static Handler GetHandler(Operation operation);
+    // index of the op at pc, the index of the end of the program for a pc outside of it
+    uint32_t GetIndex(uint32_t pc) const;
+    uint32_t GetAddress(uint32_t index) const;
+    void Decode(uint32_t index);
+    // decodes the ops from first to last again after the code changed
+    virtual void Invalidate(uint32_t first, uint32_t last);
+    // picks up the changes to the code since the last time
+    void SyncCode();
+    // after the op in context.codeChange, returns the op following it
+    const ThreadedOp* Resume(ThreadedContext& context);
+    // instructions executed going from op from to op to, which has to be reached from it without jumping
+    static uint64_t CountInstructions(const ThreadedOp* from, const ThreadedOp* to);
+    // Executes single ops until the end of the program, a failure or maxInstructions, counting them in executed
+    const ThreadedOp* Dispatch(ThreadedContext& context, const ThreadedOp* op, uint64_t maxInstructions,
+                               uint64_t& executed);
+    ThreadedContext CreateContext() const;
+    void WriteBackPC(const ThreadedContext& context, const ThreadedOp* op) const;
+    RunResult Failed(const ThreadedContext& context, uint64_t executed) const;
+    RunResult Finished(const ThreadedContext& context, const ThreadedOp* op, uint64_t executed) const;
+
+    CPU* m_cpu;
+    // one op per INSTRUCTION_ALIGNMENT bytes of code followed by the end of the program
+    vector<ThreadedOp> m_ops;
+};
+
+#endif // THREADEDINTERPRETER_H
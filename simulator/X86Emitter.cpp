@@ -0,0 +1,373 @@
+#include "X86Emitter.h"
+
+const vector<uint8_t>& X86Emitter::GetCode() const { return m_code; }
+
+size_t X86Emitter::GetPosition() const { return m_code.size(); }
+
+void X86Emitter::Push(const X86Register reg)
+{
+    EmitRex(false, 0, 0, reg);
+    Emit8(0x50 + (reg & 7));
+}
+
+void X86Emitter::Pop(const X86Register reg)
+{
+    EmitRex(false, 0, 0, reg);
+    Emit8(0x58 + (reg & 7));
+}
+
+void X86Emitter::Ret() { Emit8(0xC3); }
+
+void X86Emitter::Load32(const X86Register dst, const X86Register base, const int32_t disp)
+{
+    EmitRex(false, dst, 0, base);
+    Emit8(0x8B);
+    EmitMemoryOperand(dst, base, disp);
+}
+
+void X86Emitter::Load64(const X86Register dst, const X86Register base, const int32_t disp)
+{
+    EmitRex(true, dst, 0, base);
+    Emit8(0x8B);
+    EmitMemoryOperand(dst, base, disp);
+}
+
+void X86Emitter::Store32(const X86Register base, const int32_t disp, const X86Register src)
+{
+    EmitRex(false, src, 0, base);
+    Emit8(0x89);
+    EmitMemoryOperand(src, base, disp);
+}
+
+void X86Emitter::Store32(const X86Register base, const int32_t disp, const uint32_t imm)
+{
+    EmitRex(false, 0, 0, base);
+    Emit8(0xC7);
+    EmitMemoryOperand(0, base, disp);
+    Emit32(imm);
+}
+
+void X86Emitter::LoadIndexed(const X86LoadType type, const X86Register dst, const X86Register base,
+                             const X86Register index, const uint8_t scale)
+{
+    EmitRex(false, dst, index, base);
+    switch (type) {
+    case X86LoadType::BYTE_SIGNED:
+        Emit8(0x0F);
+        Emit8(0xBE);
+        break;
+    case X86LoadType::BYTE_UNSIGNED:
+        Emit8(0x0F);
+        Emit8(0xB6);
+        break;
+    case X86LoadType::HALF_WORD_SIGNED:
+        Emit8(0x0F);
+        Emit8(0xBF);
+        break;
+    case X86LoadType::HALF_WORD_UNSIGNED:
+        Emit8(0x0F);
+        Emit8(0xB7);
+        break;
+    case X86LoadType::WORD:
+        Emit8(0x8B);
+        break;
+    }
+    EmitIndexedOperand(dst, base, index, scale);
+}
+
+void X86Emitter::StoreIndexed(const uint8_t width, const X86Register base, const X86Register index,
+                              const uint8_t scale, const X86Register src)
+{
+    if (width == 2) {
+        Emit8(0x66);
+    }
+    EmitRex(false, src, index, base);
+    Emit8(width == 1 ? 0x88 : 0x89);
+    EmitIndexedOperand(src, base, index, scale);
+}
+
+void X86Emitter::Compare32(const X86Register base, const int32_t disp, const int8_t imm)
+{
+    EmitRex(false, 0, 0, base);
+    Emit8(0x83);
+    EmitMemoryOperand(static_cast<uint8_t>(X86AluOperation::CMP), base, disp);
+    Emit8(static_cast<uint8_t>(imm));
+}
+
+void X86Emitter::CompareIndexed8(const X86Register base, const X86Register index, const uint8_t scale,
+                                 const uint8_t imm)
+{
+    EmitRex(false, 0, index, base);
+    Emit8(0x80);
+    EmitIndexedOperand(static_cast<uint8_t>(X86AluOperation::CMP), base, index, scale);
+    Emit8(imm);
+}
+
+void X86Emitter::Move32(const X86Register dst, const X86Register src)
+{
+    EmitRex(false, src, 0, dst);
+    Emit8(0x89);
+    EmitModRM(3, src, dst);
+}
+
+void X86Emitter::Move64(const X86Register dst, const X86Register src)
+{
+    EmitRex(true, src, 0, dst);
+    Emit8(0x89);
+    EmitModRM(3, src, dst);
+}
+
+void X86Emitter::Move32(const X86Register dst, const uint32_t imm)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0xB8 + (dst & 7));
+    Emit32(imm);
+}
+
+void X86Emitter::Move64(const X86Register dst, const uint64_t imm)
+{
+    EmitRex(true, 0, 0, dst);
+    Emit8(0xB8 + (dst & 7));
+    Emit32(static_cast<uint32_t>(imm));
+    Emit32(static_cast<uint32_t>(imm >> 32));
+}
+
+void X86Emitter::ZeroExtend8(const X86Register dst, const X86Register src)
+{
+    // without a REX prefix 4-7 would address ah, ch, dh, bh instead of spl, bpl, sil, dil
+    if (src >= RSP && src <= RDI && dst < R8) {
+        Emit8(0x40);
+    }
+    else {
+        EmitRex(false, dst, 0, src);
+    }
+    Emit8(0x0F);
+    Emit8(0xB6);
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::ZeroExtend16(const X86Register dst, const X86Register src)
+{
+    EmitRex(false, dst, 0, src);
+    Emit8(0x0F);
+    Emit8(0xB7);
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::SignExtend8(const X86Register dst, const X86Register src)
+{
+    if (src >= RSP && src <= RDI && dst < R8) {
+        Emit8(0x40);
+    }
+    else {
+        EmitRex(false, dst, 0, src);
+    }
+    Emit8(0x0F);
+    Emit8(0xBE);
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::SignExtend16(const X86Register dst, const X86Register src)
+{
+    EmitRex(false, dst, 0, src);
+    Emit8(0x0F);
+    Emit8(0xBF);
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::Alu32(const X86AluOperation operation, const X86Register dst, const X86Register src)
+{
+    EmitRex(false, src, 0, dst);
+    Emit8(static_cast<uint8_t>(static_cast<uint8_t>(operation) << 3 | 0x01));
+    EmitModRM(3, src, dst);
+}
+
+void X86Emitter::Alu32(const X86AluOperation operation, const X86Register dst, const int32_t imm)
+{
+    EmitRex(false, 0, 0, dst);
+    if (imm >= INT8_MIN && imm <= INT8_MAX) {
+        Emit8(0x83);
+        EmitModRM(3, static_cast<uint8_t>(operation), dst);
+        Emit8(static_cast<uint8_t>(imm));
+    }
+    else {
+        Emit8(0x81);
+        EmitModRM(3, static_cast<uint8_t>(operation), dst);
+        Emit32(static_cast<uint32_t>(imm));
+    }
+}
+
+void X86Emitter::Alu64(const X86AluOperation operation, const X86Register dst, const int8_t imm)
+{
+    EmitRex(true, 0, 0, dst);
+    Emit8(0x83);
+    EmitModRM(3, static_cast<uint8_t>(operation), dst);
+    Emit8(static_cast<uint8_t>(imm));
+}
+
+void X86Emitter::Test32(const X86Register dst, const uint32_t imm)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0xF7);
+    EmitModRM(3, 0, dst);
+    Emit32(imm);
+}
+
+void X86Emitter::Shift32(const X86ShiftOperation operation, const X86Register dst)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0xD3);
+    EmitModRM(3, static_cast<uint8_t>(operation), dst);
+}
+
+void X86Emitter::Shift32(const X86ShiftOperation operation, const X86Register dst, const uint8_t amount)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0xC1);
+    EmitModRM(3, static_cast<uint8_t>(operation), dst);
+    Emit8(amount);
+}
+
+void X86Emitter::IMul32(const X86Register dst, const X86Register src)
+{
+    EmitRex(false, dst, 0, src);
+    Emit8(0x0F);
+    Emit8(0xAF);
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::Mul32(const X86Register src)
+{
+    EmitRex(false, 0, 0, src);
+    Emit8(0xF7);
+    EmitModRM(3, 4, src);
+}
+
+void X86Emitter::IMul32(const X86Register src)
+{
+    EmitRex(false, 0, 0, src);
+    Emit8(0xF7);
+    EmitModRM(3, 5, src);
+}
+
+void X86Emitter::Not32(const X86Register dst)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0xF7);
+    EmitModRM(3, 2, dst);
+}
+
+void X86Emitter::ByteSwap32(const X86Register dst)
+{
+    EmitRex(false, 0, 0, dst);
+    Emit8(0x0F);
+    Emit8(0xC8 + (dst & 7));
+}
+
+void X86Emitter::ConditionalMove32(const X86Condition condition, const X86Register dst, const X86Register src)
+{
+    EmitRex(false, dst, 0, src);
+    Emit8(0x0F);
+    Emit8(0x40 + static_cast<uint8_t>(condition));
+    EmitModRM(3, dst, src);
+}
+
+void X86Emitter::Set32(const X86Condition condition, const X86Register dst)
+{
+    Emit8(0x0F);
+    Emit8(0x90 + static_cast<uint8_t>(condition));
+    EmitModRM(3, 0, dst);
+    ZeroExtend8(dst, dst);
+}
+
+void X86Emitter::Call(const X86Register target)
+{
+    EmitRex(false, 0, 0, target);
+    Emit8(0xFF);
+    EmitModRM(3, 2, target);
+}
+
+size_t X86Emitter::Jump()
+{
+    Emit8(0xE9);
+    Emit32(0);
+    return m_code.size() - 4;
+}
+
+size_t X86Emitter::Jump(const X86Condition condition)
+{
+    Emit8(0x0F);
+    Emit8(0x80 + static_cast<uint8_t>(condition));
+    Emit32(0);
+    return m_code.size() - 4;
+}
+
+void X86Emitter::Bind(const size_t jump)
+{
+    const uint32_t displacement = static_cast<uint32_t>(m_code.size() - (jump + 4));
+    for (size_t i = 0; i < 4; i++) {
+        m_code[jump + i] = static_cast<uint8_t>(displacement >> (i * 8));
+    }
+}
+
+void X86Emitter::Emit8(const uint8_t value) { m_code.push_back(value); }
+
+void X86Emitter::Emit32(const uint32_t value)
+{
+    for (size_t i = 0; i < 4; i++) {
+        m_code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void X86Emitter::EmitRex(const bool wide, const uint8_t reg, const uint8_t index, const uint8_t base)
+{
+    const uint8_t rex = 0x40 | (wide ? 0x08 : 0) | (reg & 8) >> 1 | (index & 8) >> 2 | (base & 8) >> 3;
+    if (rex != 0x40) {
+        Emit8(rex);
+    }
+}
+
+void X86Emitter::EmitModRM(const uint8_t mod, const uint8_t reg, const uint8_t rm)
+{
+    Emit8(static_cast<uint8_t>(mod << 6 | (reg & 7) << 3 | (rm & 7)));
+}
+
+void X86Emitter::EmitMemoryOperand(const uint8_t reg, const X86Register base, const int32_t disp)
+{
+    // rbp/r13 without displacement would mean rip relative
+    uint8_t mod = 2;
+    if (disp == 0 && (base & 7) != RBP) {
+        mod = 0;
+    }
+    else if (disp >= INT8_MIN && disp <= INT8_MAX) {
+        mod = 1;
+    }
+
+    EmitModRM(mod, reg, base);
+    // rsp/r12 as base always need a SIB byte
+    if ((base & 7) == RSP) {
+        Emit8(0x24);
+    }
+    if (mod == 1) {
+        Emit8(static_cast<uint8_t>(disp));
+    }
+    else if (mod == 2) {
+        Emit32(static_cast<uint32_t>(disp));
+    }
+}
+
+void X86Emitter::EmitIndexedOperand(const uint8_t reg, const X86Register base, const X86Register index,
+                                    const uint8_t scale)
+{
+    const uint8_t mod = (base & 7) == RBP ? 1 : 0;
+    uint8_t scaleBits = 0;
+    while ((1 << scaleBits) < scale) {
+        scaleBits++;
+    }
+
+    EmitModRM(mod, reg, RSP);
+    Emit8(static_cast<uint8_t>(scaleBits << 6 | (index & 7) << 3 | (base & 7)));
+    if (mod == 1) {
+        Emit8(0);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef X86EMITTER_H
+#define X86EMITTER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+enum X86Register : uint8_t
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R8 = 8,
+    R9 = 9,
+    R10 = 10,
+    R11 = 11,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15
+};
+
+// condition codes as encoded in Jcc/SETcc
+enum class X86Condition : uint8_t
+{
+    B = 0x2,
+    AE = 0x3,
+    E = 0x4,
+    NE = 0x5,
+    BE = 0x6,
+    A = 0x7,
+    L = 0xC,
+    GE = 0xD,
+    G = 0xF
+};
+
+// /digit of the 0x81 group and the matching register-register opcode
+enum class X86AluOperation : uint8_t
+{
+    ADD = 0,
+    OR = 1,
+    AND = 4,
+    SUB = 5,
+    XOR = 6,
+    CMP = 7
+};
+
+// /digit of the 0xC1/0xD3 group
+enum class X86ShiftOperation : uint8_t
+{
+    ROL = 0,
+    ROR = 1,
+    SHL = 4,
+    SHR = 5,
+    SAR = 7
+};
+
+enum class X86LoadType : uint8_t
+{
+    BYTE_SIGNED,
+    BYTE_UNSIGNED,
+    HALF_WORD_SIGNED,
+    HALF_WORD_UNSIGNED,
+    WORD
+};
+
+// Minimal x86-64 machine code emitter for the JIT, only covers the 32-bit
+// integer instructions it needs
+class X86Emitter
+{
+public:
+    const vector<uint8_t>& GetCode() const;
+    size_t GetPosition() const;
+
+    void Push(X86Register reg);
+    void Pop(X86Register reg);
+    void Ret();
+
+    // mov dst, [base + disp]
+    void Load32(X86Register dst, X86Register base, int32_t disp);
+    void Load64(X86Register dst, X86Register base, int32_t disp);
+    // mov [base + disp], src
+    void Store32(X86Register base, int32_t disp, X86Register src);
+    void Store32(X86Register base, int32_t disp, uint32_t imm);
+    // load from [base + index * scale], sign or zero extended to 32 bits
+    void LoadIndexed(X86LoadType type, X86Register dst, X86Register base, X86Register index, uint8_t scale);
+    // mov [base + index * scale], src with the low 1, 2 or 4 bytes of src, src has to be one of eax, ecx, edx, ebx
+    void StoreIndexed(uint8_t width, X86Register base, X86Register index, uint8_t scale, X86Register src);
+    // cmp dword [base + disp], imm
+    void Compare32(X86Register base, int32_t disp, int8_t imm);
+    // cmp byte [base + index * scale], imm
+    void CompareIndexed8(X86Register base, X86Register index, uint8_t scale, uint8_t imm);
+
+    void Move32(X86Register dst, X86Register src);
+    void Move64(X86Register dst, X86Register src);
+    void Move32(X86Register dst, uint32_t imm);
+    void Move64(X86Register dst, uint64_t imm);
+    void ZeroExtend8(X86Register dst, X86Register src);
+    void ZeroExtend16(X86Register dst, X86Register src);
+    void SignExtend8(X86Register dst, X86Register src);
+    void SignExtend16(X86Register dst, X86Register src);
+
+    void Alu32(X86AluOperation operation, X86Register dst, X86Register src);
+    void Alu32(X86AluOperation operation, X86Register dst, int32_t imm);
+    void Alu64(X86AluOperation operation, X86Register dst, int8_t imm);
+    void Test32(X86Register dst, uint32_t imm);
+    void Shift32(X86ShiftOperation operation, X86Register dst);
+    void Shift32(X86ShiftOperation operation, X86Register dst, uint8_t amount);
+    void IMul32(X86Register dst, X86Register src);
+    // edx:eax = eax * src
+    void Mul32(X86Register src);
+    // edx:eax = eax * src, signed
+    void IMul32(X86Register src);
+    void Not32(X86Register dst);
+    void ByteSwap32(X86Register dst);
+    // dst = src if the condition holds
+    void ConditionalMove32(X86Condition condition, X86Register dst, X86Register src);
+    // dst = condition ? 1 : 0, dst has to be one of eax, ecx, edx, ebx
+    void Set32(X86Condition condition, X86Register dst);
+
+    // call the address in target
+    void Call(X86Register target);
+    // jumps with a 32-bit displacement, returns the position to pass to Bind
+    size_t Jump();
+    size_t Jump(X86Condition condition);
+    // let the jump at position continue at the current position
+    void Bind(size_t jump);
+
+private:
+    void Emit8(uint8_t value);
+    void Emit32(uint32_t value);
+    void EmitRex(bool wide, uint8_t reg, uint8_t index, uint8_t base);
+    void EmitModRM(uint8_t mod, uint8_t reg, uint8_t rm);
+    void EmitMemoryOperand(uint8_t reg, X86Register base, int32_t disp);
+    void EmitIndexedOperand(uint8_t reg, X86Register base, X86Register index, uint8_t scale);
+
+    vector<uint8_t> m_code;
+};
+
+#endif // X86EMITTER_H
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "../batch/BatchRunner.h"
+#include "../batch/Coordinator.h"
+#include "../batch/WorkStealingQueue.h"
+
+TEST(BatchTestSuite, WorkStealingQueue)
+{
+    WorkStealingQueue queue(10, 3);
+    vector<size_t> taken;
+    size_t item;
+    // the first worker takes its own items in order, then steals from the back of the next workers
+    while (queue.Take(0, item)) {
+        taken.push_back(item);
+    }
+    EXPECT_EQ(taken, (vector<size_t>{0, 1, 2, 3, 6, 5, 4, 9, 8, 7}));
+    EXPECT_FALSE(queue.Take(2, item));
+
+    WorkStealingQueue empty(0, 4);
+    EXPECT_FALSE(empty.Take(3, item));
+}
+
+TEST(BatchTestSuite, Manifest)
+{
+    std::istringstream manifest("# comment\n\nsum.s\nloop.bin 100 0x1000\n  /abs/prog.s 5\nlong.s 1 0x1000 0\n");
+    vector<BatchJob> jobs;
+    size_t errorLine = 0;
+    ASSERT_TRUE(BatchRunner::ParseManifest(manifest, "jobs", jobs, errorLine));
+    ASSERT_EQ(jobs.size(), 4);
+    EXPECT_EQ(jobs[0].path, (std::filesystem::path("jobs") / "sum.s").string());
+    EXPECT_EQ(jobs[0].maxInstructions, DEFAULT_JOB_INSTRUCTIONS);
+    EXPECT_EQ(jobs[0].memorySize, DEFAULT_JOB_MEMORY);
+    EXPECT_EQ(jobs[0].maxTime, DEFAULT_JOB_TIME);
+    EXPECT_EQ(jobs[1].maxInstructions, 100);
+    EXPECT_EQ(jobs[1].memorySize, 0x1000);
+    EXPECT_EQ(jobs[2].path, std::filesystem::path("/abs/prog.s").string());
+    EXPECT_EQ(jobs[2].maxInstructions, 5);
+    EXPECT_EQ(jobs[3].maxTime, 0);
+
+    for (const char* invalid : {"a.s\nb.s x", "a.s 1 2 3 4", "a.s 1 0x100000001", "a.s 1 2 x"}) {
+        std::istringstream lines(invalid);
+        jobs.clear();
+        EXPECT_FALSE(BatchRunner::ParseManifest(lines, "", jobs, errorLine));
+    }
+    EXPECT_EQ(errorLine, 1);
+}
+
+TEST(BatchTestSuite, Run)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const string sum = (directory / "batch_test_sum.s").string();
+    const string loop = (directory / "batch_test_loop.bin").string();
+    const string invalid = (directory / "batch_test_invalid.s").string();
+    std::ofstream(sum) << "addi x1, x0, 10\nloop:\nadd x2, x2, x1\naddi x1, x1, -1\nbne x1, x0, loop\n";
+    // jal x0, 0
+    const uint32_t jump = 0x0000006f;
+    std::ofstream(loop, std::ios::binary).write(reinterpret_cast<const char*>(&jump), sizeof(jump));
+    std::ofstream(invalid) << "addi x1, x0\n";
+
+    vector<BatchJob> jobs;
+    for (int i = 0; i < 20; i++) {
+        jobs.push_back({i % 2 == 0 ? sum : loop, 1000, 4096});
+    }
+    jobs.push_back({invalid, 1000, 4096});
+    jobs.push_back({invalid + ".missing", 1000, 4096});
+    // would loop forever without its time limit
+    jobs.push_back({loop, UINT64_MAX, 4096, 20});
+
+    vector<BatchResult> results(jobs.size());
+    vector<int> reported(jobs.size(), 0);
+    BatchRunner::Run(jobs, 4, [&](const BatchResult& result) {
+        results[result.index] = result;
+        reported[result.index]++;
+    });
+    EXPECT_EQ(reported, vector<int>(jobs.size(), 1));
+    for (size_t i = 0; i < 20; i += 2) {
+        EXPECT_EQ(results[i].run.reason, StopReason::HALTED);
+        EXPECT_EQ(results[i].hart.registers[2], 55);
+        EXPECT_EQ(results[i].hart.retired, 31);
+        EXPECT_EQ(results[i + 1].run.reason, StopReason::LIMIT_REACHED);
+        EXPECT_EQ(results[i + 1].run.instructions, 1000);
+    }
+    EXPECT_FALSE(results[20].jobError.empty());
+    EXPECT_FALSE(results[21].jobError.empty());
+    EXPECT_EQ(results[22].run.reason, StopReason::LIMIT_REACHED);
+    EXPECT_EQ(results[22].run.error, ExecutionError::LIMIT_EXCEEDED);
+
+    const string json = BatchRunner::ToJson(jobs[0], results[0]);
+    EXPECT_NE(json.find("\"status\":\"Halted\""), string::npos);
+    EXPECT_NE(json.find("\"registers\":[0,0,55,"), string::npos);
+    const string csv = BatchRunner::ToCsv(jobs[21], results[21]);
+    EXPECT_TRUE(csv.starts_with("21,\"" + jobs[21].path + "\",Not run,"));
+    EXPECT_EQ(std::ranges::count(csv, ','), std::ranges::count(BatchRunner::GetCsvHeader(), ','));
+
+    std::filesystem::remove(sum);
+    std::filesystem::remove(loop);
+    std::filesystem::remove(invalid);
+}
+
+TEST(BatchTestSuite, Coordinator)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const string sum = (directory / "batch_test_sum.s").string();
+    const string hog = (directory / "batch_test_hog.s").string();
+    std::ofstream(sum) << "addi x1, x0, 10\nloop:\nadd x2, x2, x1\naddi x1, x1, -1\nbne x1, x0, loop\n";
+    // writes 512 MiB, one word per page
+    std::ofstream(hog) << "lui x1, 1\nlui x3, 0x20000\nloop:\nsw x1, 0(x2)\nadd x2, x2, x1\nbne x2, x3, loop\n";
+
+    vector<BatchJob> jobs;
+    for (int i = 0; i < 30; i++) {
+        jobs.push_back({sum, 1000, 4096});
+    }
+    jobs.push_back({hog, UINT64_MAX, 1ull << 30});
+
+    vector<BatchResult> results(jobs.size());
+    vector<int> reported(jobs.size(), 0);
+    Coordinator(3, 2, 256ull << 20, 2).Run(jobs, [&](const BatchResult& result) {
+        results[result.index] = result;
+        reported[result.index]++;
+    });
+    EXPECT_EQ(reported, vector<int>(jobs.size(), 1));
+    for (size_t i = 0; i < 30; i++) {
+        EXPECT_TRUE(results[i].jobError.empty());
+        EXPECT_EQ(results[i].hart.registers[2], 55);
+    }
+#ifdef COORDINATOR_PROCESSES
+    // the memory limit only holds the workers back
+    EXPECT_EQ(results[30].run.reason, StopReason::WORKER_CRASHED);
+    EXPECT_NE(BatchRunner::ToJson(jobs[30], results[30]).find("\"status\":\"Worker crashed\""), string::npos);
+    EXPECT_NE(BatchRunner::ToCsv(jobs[30], results[30]).find(",Worker crashed,"), string::npos);
+#endif
+
+    std::filesystem::remove(sum);
+    std::filesystem::remove(hog);
+}
@@ -82,3 +82,193 @@ TEST(CPUTestSuite, Registers)
         EXPECT_EQ(result.registerChange, expectedChange);
     }
 }
+
+TEST(CPUTestSuite, DecodeBranchTarget)
+{
+    vector<uint32_t> instructions = Parser::Parse({"addi x1, x0, 1", "loop:", "beq x0, x0, loop"}).instructions;
+    DecodedInstruction decoded = Decoder::Decode(instructions[1], 4);
+    EXPECT_EQ(decoded.operation, Operation::BEQ);
+    EXPECT_EQ(decoded.imm, 0);
+    EXPECT_EQ(decoded.target, 4);
+
+    decoded = Decoder::Decode(Parser::Parse({"bne x1, x2, -8"}).instructions[0], 12);
+    EXPECT_EQ(decoded.operation, Operation::BNE);
+    EXPECT_EQ(decoded.rs1, 1);
+    EXPECT_EQ(decoded.rs2, 2);
+    EXPECT_EQ(decoded.imm, -8);
+    EXPECT_EQ(decoded.target, 4);
+}
+
+TEST(CPUTestSuite, DecodeJALTarget)
+{
+    DecodedInstruction decoded = Decoder::Decode(Parser::Parse({"jal x1, -4"}).instructions[0], 8);
+    EXPECT_EQ(decoded.operation, Operation::JAL);
+    EXPECT_EQ(decoded.rd, 1);
+    EXPECT_EQ(decoded.imm, -4);
+    EXPECT_EQ(decoded.target, 4);
+}
+
+TEST(CPUTestSuite, DecodeFence)
+{
+    // fence iorw, iorw and fence.i
+    EXPECT_EQ(Decoder::Decode(0x0FF0000F, 0).operation, Operation::FENCE);
+    EXPECT_EQ(Decoder::Decode(0x0000100F, 0).operation, Operation::FENCE_I);
+    EXPECT_EQ(Decoder::Decode(0x0000200F, 0).operation, Operation::UNSUPPORTED);
+}
+
+TEST(CPUTestSuite, DecodeCompressed)
+{
+    // every one has a compressed form, which has to decode to the same instruction
+    const vector<string> program = {
+        "addi x8, x8, -3",   "addi x9, x0, 31",  "addi x2, x2, -64", "addi x10, x2, 1020", "lui x11, -32",
+        "slli x1, x1, 31",   "srli x8, x8, 3",   "srai x15, x15, 1", "andi x12, x12, -1",  "add x5, x0, x6",
+        "add x5, x5, x31",   "addi x0, x0, 0",   "xor x9, x9, x10",  "or x10, x10, x11",   "and x11, x11, x12",
+        "lw x8, 124(x9)",    "sw x15, 4(x8)",    "lw x1, 252(x2)",   "sw x31, 0(x2)",      "jal x0, -2048",
+        "jal x1, 2046",      "jalr x0, 0(x1)",   "jalr x1, 0(x5)",   "beq x8, x0, -256",   "bne x15, x0, 254"};
+    const vector<uint32_t> instructions = Parser::Parse(program).instructions;
+    const vector<uint32_t> compressed = Parser::Parse(program, true).instructions;
+    ASSERT_EQ(compressed.size() * 2, instructions.size() + 1);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const DecodedInstruction expected = Decoder::Decode(instructions[i], 512);
+        const DecodedInstruction decoded = Decoder::Decode(compressed[i / 2] >> (i % 2 * 16) & 0xFFFF, 512);
+        EXPECT_EQ(decoded.operation, expected.operation) << program[i];
+        EXPECT_EQ(decoded.rd, expected.rd) << program[i];
+        EXPECT_EQ(decoded.rs1, expected.rs1) << program[i];
+        EXPECT_EQ(decoded.rs2, expected.rs2) << program[i];
+        EXPECT_EQ(decoded.imm, expected.imm) << program[i];
+        EXPECT_EQ(decoded.target, expected.target) << program[i];
+        EXPECT_EQ(decoded.size, 2) << program[i];
+    }
+    // c.sub x8, x9
+    const DecodedInstruction sub = Decoder::Decode(0x8C05, 0);
+    EXPECT_EQ(sub.operation, Operation::SUB);
+    EXPECT_EQ(sub.rd, 8);
+    EXPECT_EQ(sub.rs1, 8);
+    EXPECT_EQ(sub.rs2, 9);
+    // reserved encodings
+    EXPECT_EQ(Decoder::Decode(0x8002, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x6101, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x9002, 0).operation, Operation::UNSUPPORTED);
+}
+
+TEST(CPUTestSuite, DecodeBitManipulation)
+{
+    const vector<string> program = {
+        "sub x1, x2, x3",     "sra x1, x2, x3",     "sh1add x1, x2, x3", "sh2add x1, x2, x3", "sh3add x1, x2, x3",
+        "andn x1, x2, x3",    "orn x1, x2, x3",     "xnor x1, x2, x3",   "min x1, x2, x3",    "minu x1, x2, x3",
+        "max x1, x2, x3",     "maxu x1, x2, x3",    "rol x1, x2, x3",    "ror x1, x2, x3",    "rori x1, x2, 31",
+        "clz x1, x2",         "ctz x1, x2",         "cpop x1, x2",       "sext.b x1, x2",     "sext.h x1, x2",
+        "zext.h x1, x2",      "orc.b x1, x2",       "rev8 x1, x2",       "srai x1, x2, 31"};
+    const vector<Operation> operations = {
+        Operation::SUB,    Operation::SRA,    Operation::SH1ADD, Operation::SH2ADD, Operation::SH3ADD,
+        Operation::ANDN,   Operation::ORN,    Operation::XNOR,   Operation::MIN,    Operation::MINU,
+        Operation::MAX,    Operation::MAXU,   Operation::ROL,    Operation::ROR,    Operation::RORI,
+        Operation::CLZ,    Operation::CTZ,    Operation::CPOP,   Operation::SEXT_B, Operation::SEXT_H,
+        Operation::ZEXT_H, Operation::ORC_B,  Operation::REV8,   Operation::SRAI};
+    const vector<uint32_t> instructions = Parser::Parse(program).instructions;
+    ASSERT_EQ(instructions.size(), operations.size());
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const DecodedInstruction decoded = Decoder::Decode(instructions[i], 512);
+        EXPECT_EQ(decoded.operation, operations[i]) << program[i];
+        EXPECT_EQ(decoded.rd, 1) << program[i];
+        EXPECT_EQ(decoded.rs1, 2) << program[i];
+    }
+    EXPECT_EQ(Decoder::Decode(instructions[14], 512).imm, 31);
+    // funct7 values of no extension, and the unary group with an rs2 that names no operation
+    EXPECT_EQ(Decoder::Decode(0x063100B3, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x60311093, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x083140B3, 0).operation, Operation::UNSUPPORTED);
+    // immediate shifts only take the funct7 of their own operation
+    EXPECT_EQ(Decoder::Decode(0x02311093, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x02315093, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x42315093, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0x40315093, 0).operation, Operation::SRAI);
+}
+
+TEST(CPUTestSuite, DecodeErrors)
+{
+    EXPECT_EQ(Decoder::Decode(0xFFFFFFFF, 0).operation, Operation::UNSUPPORTED);
+    // all zeros is illegal in 16 bits as well
+    EXPECT_EQ(Decoder::Decode(0, 0).operation, Operation::UNSUPPORTED);
+    EXPECT_EQ(Decoder::Decode(0, 0).size, 2);
+
+    CPU errorCpu(new Memory());
+    errorCpu.LoadInstructions({0xFFFFFFFF});
+    const ExecutionResult result = errorCpu.Step();
+    EXPECT_EQ(result.success, false);
+    EXPECT_EQ(result.error, ExecutionError::UNSUPPORTED_OPCODE);
+    EXPECT_EQ(result.errorPc, 0);
+}
+
+TEST(CPUTestSuite, Loop)
+{
+    cpu.Reset();
+    vector<uint32_t> instructions =
+        Parser::Parse({"addi x1, x0, 3", "loop:", "addi x1, x1, -1", "bne x1, x0, loop", "sw x1, 4(x0)"}).instructions;
+    cpu.LoadInstructions(instructions);
+
+    ExecutionResult result = cpu.Step();
+    for (int i = 0; i < 3; i++) {
+        result = cpu.Step();
+        EXPECT_EQ(result.registerChange, (RegisterChange{1, static_cast<uint32_t>(2 - i)}));
+        result = cpu.Step();
+        EXPECT_EQ(result.registerChanged, false);
+        EXPECT_EQ(result.pc, i < 2 ? 4 : 12);
+    }
+    result = cpu.Step();
+    EXPECT_EQ(result.memoryChanged, true);
+    EXPECT_EQ(result.memoryChange.address, 4);
+    EXPECT_EQ(result.pc, 16);
+    EXPECT_EQ(cpu.Step().error, ExecutionError::PC_OUT_OF_BOUNDS);
+}
+
+TEST(CPUTestSuite, ByteMemory)
+{
+    // the data goes after the code
+    Memory memory(128);
+    CPU byteCpu(&memory);
+    byteCpu.LoadInstructions(Parser::Parse({"addi x1, x0, -2", "addi x2, x0, 104", "sb x1, 67(x0)", "sh x1, -6(x2)",
+                                            "lw x3, 64(x0)", "lb x4, 67(x0)", "lbu x5, 67(x0)", "lh x6, 98(x0)",
+                                            "lhu x7, 98(x0)", "sw x1, 126(x0)"})
+                                 .instructions);
+
+    ExecutionResult result = byteCpu.Step();
+    result = byteCpu.Step();
+    result = byteCpu.Step();
+    EXPECT_EQ(result.memoryChange.address, 64);
+    EXPECT_EQ(result.memoryChange.value, 0xFE000000);
+    result = byteCpu.Step();
+    EXPECT_EQ(result.memoryChange.address, 96);
+    EXPECT_EQ(result.memoryChange.value, 0xFFFE0000);
+
+    EXPECT_EQ(byteCpu.Step().registerChange, (RegisterChange{3, 0xFE000000}));
+    EXPECT_EQ(byteCpu.Step().registerChange, (RegisterChange{4, 0xFFFFFFFE}));
+    EXPECT_EQ(byteCpu.Step().registerChange, (RegisterChange{5, 0xFE}));
+    EXPECT_EQ(byteCpu.Step().registerChange, (RegisterChange{6, 0xFFFFFFFE}));
+    EXPECT_EQ(byteCpu.Step().registerChange, (RegisterChange{7, 0xFFFE}));
+
+    // the word would end past the memory
+    result = byteCpu.Step();
+    EXPECT_EQ(result.error, ExecutionError::INVALID_MEMORY_ACCESS);
+    EXPECT_EQ(result.errorPc, 36);
+}
+
+TEST(CPUTestSuite, CodeChanges)
+{
+    // the program stays decoded, a write to the code is decoded again before it runs
+    Memory memory(64);
+    CPU codeCpu(&memory);
+    codeCpu.LoadInstructions(Parser::Parse({"addi x1, x0, 1", "addi x2, x0, 2"}).instructions);
+    uint64_t begin;
+    uint64_t end;
+    EXPECT_FALSE(codeCpu.CollectCodeChanges(begin, end));
+    memory.Write(4, Parser::Parse({"addi x2, x0, 5"}).instructions[0]);
+    codeCpu.Step();
+    EXPECT_EQ(codeCpu.Step().registerChange, (RegisterChange{2, 5}));
+
+    // and is still passed on to the engines once the CPU has caught up with it
+    ASSERT_TRUE(codeCpu.CollectCodeChanges(begin, end));
+    EXPECT_EQ(begin, 4);
+    EXPECT_EQ(end, 8);
+    EXPECT_FALSE(codeCpu.CollectCodeChanges(begin, end));
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <gtest/gtest.h>
 
 #include "../simulator/Memory.h"
@@ -13,3 +14,430 @@ TEST(MemoryTestSuite, Word)
 TEST(MemoryTestSuite, HalfWord) { EXPECT_EQ(memory.ReadHalfWord(0), 0x5678); }
 
 TEST(MemoryTestSuite, Byte) { EXPECT_EQ(memory.ReadByte(0), 0x78); }
+
+TEST(MemoryTestSuite, LittleEndian)
+{
+    Memory bytes(16);
+    EXPECT_TRUE(bytes.Store<uint32_t>(4, 0x11223344));
+    uint8_t byte = 0;
+    EXPECT_TRUE(bytes.Load(4, byte));
+    EXPECT_EQ(byte, 0x44);
+    EXPECT_TRUE(bytes.Load(7, byte));
+    EXPECT_EQ(byte, 0x11);
+
+    uint16_t halfWord = 0;
+    EXPECT_TRUE(bytes.Load(5, halfWord));
+    EXPECT_EQ(halfWord, 0x2233);
+    EXPECT_EQ(bytes.GetMemory()[1], 0x11223344);
+}
+
+TEST(MemoryTestSuite, Unaligned)
+{
+    Memory bytes(16);
+    EXPECT_TRUE(bytes.Store<uint32_t>(6, 0xAABBCCDD));
+    EXPECT_EQ(bytes.Read(6), 0xAABBCCDD);
+    EXPECT_EQ(bytes.GetMemory()[1], 0xCCDD0000);
+    EXPECT_EQ(bytes.GetMemory()[2], 0x0000AABB);
+}
+
+TEST(MemoryTestSuite, Bounds)
+{
+    Memory bytes(16);
+    uint32_t word = 1;
+    EXPECT_TRUE(bytes.Load(12, word));
+    EXPECT_FALSE(bytes.Load(13, word));
+    EXPECT_FALSE(bytes.Load(0xFFFFFFFE, word));
+    EXPECT_FALSE(bytes.Store<uint16_t>(15, 0xFFFF));
+    EXPECT_TRUE(bytes.Store<uint8_t>(15, 0xFF));
+    // failed accesses leave everything untouched
+    EXPECT_EQ(word, 0);
+    EXPECT_EQ(bytes.ReadByte(14), 0);
+}
+
+TEST(MemoryTestSuite, Range)
+{
+    Memory bytes(16);
+    const uint8_t data[] = {1, 2, 3, 4, 5};
+    EXPECT_TRUE(bytes.WriteRange(3, data));
+    EXPECT_FALSE(bytes.WriteRange(12, data));
+
+    uint8_t read[5] = {};
+    EXPECT_TRUE(bytes.ReadRange(3, read));
+    EXPECT_EQ(read[0], 1);
+    EXPECT_EQ(read[4], 5);
+    EXPECT_EQ(bytes.Read(4), 0x05040302);
+    EXPECT_FALSE(bytes.ReadRange(12, read));
+}
+
+TEST(MemoryTestSuite, Sparse)
+{
+    Memory full(ADDRESS_SPACE_SIZE);
+    EXPECT_EQ(full.GetSize(), ADDRESS_SPACE_SIZE);
+    EXPECT_EQ(full.Read(0x7FFFFFF0), 0);
+    // reading untouched memory does not allocate
+    EXPECT_EQ(full.GetPageCount(), 0);
+
+    EXPECT_TRUE(full.Store<uint32_t>(0x7FFFFFF0, 0xCAFEBABE));
+    EXPECT_TRUE(full.Store<uint32_t>(0xFFFFFFFC, 0x12345678));
+    EXPECT_EQ(full.Read(0x7FFFFFF0), 0xCAFEBABE);
+    EXPECT_EQ(full.Read(0xFFFFFFFC), 0x12345678);
+    EXPECT_EQ(full.GetPageCount(), 2);
+    EXPECT_FALSE(full.Store<uint32_t>(0xFFFFFFFE, 0));
+
+    full.Reset();
+    EXPECT_EQ(full.GetPageCount(), 0);
+    EXPECT_EQ(full.Read(0x7FFFFFF0), 0);
+}
+
+TEST(MemoryTestSuite, CrossPage)
+{
+    Memory bytes(3 * MEMORY_PAGE_SIZE);
+    EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE - 2, 0xAABBCCDD));
+    EXPECT_EQ(bytes.GetPageCount(), 2);
+    EXPECT_EQ(bytes.ReadHalfWord(MEMORY_PAGE_SIZE - 2), 0xCCDD);
+    EXPECT_EQ(bytes.ReadHalfWord(MEMORY_PAGE_SIZE), 0xAABB);
+    EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE - 2), 0xAABBCCDD);
+
+    vector<uint8_t> data(MEMORY_PAGE_SIZE + 4, 0x5A);
+    EXPECT_TRUE(bytes.WriteRange(2 * MEMORY_PAGE_SIZE - 4, data));
+    EXPECT_FALSE(bytes.WriteRange(2 * MEMORY_PAGE_SIZE + 4, data));
+    EXPECT_EQ(bytes.Read(3 * MEMORY_PAGE_SIZE - 4), 0x5A5A5A5A);
+    EXPECT_EQ(bytes.GetPageCount(), 3);
+}
+
+TEST(MemoryTestSuite, Shrink)
+{
+    Memory bytes(2 * MEMORY_PAGE_SIZE);
+    EXPECT_TRUE(bytes.Store<uint32_t>(16, 0xFFFFFFFF));
+    EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE, 0xFFFFFFFF));
+
+    bytes.Resize(18);
+    EXPECT_EQ(bytes.GetPageCount(), 1);
+    EXPECT_EQ(bytes.ReadHalfWord(16), 0xFFFF);
+    EXPECT_EQ(bytes.ReadHalfWord(18), 0);
+
+    // memory cut off by shrinking comes back zeroed
+    bytes.Resize(2 * MEMORY_PAGE_SIZE);
+    EXPECT_EQ(bytes.Read(16), 0x0000FFFF);
+    EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE), 0);
+}
+
+TEST(MemoryTestSuite, Reserved)
+{
+    Memory full(ADDRESS_SPACE_SIZE, MemoryBackend::RESERVED);
+    EXPECT_EQ(full.GetBackend(),
+              Memory::IsReservationSupported() ? MemoryBackend::RESERVED : MemoryBackend::PAGED);
+    EXPECT_TRUE(full.Store<uint32_t>(0xFFFFFFFC, 0x12345678));
+    EXPECT_EQ(full.Read(0xFFFFFFFC), 0x12345678);
+    EXPECT_FALSE(full.Store<uint32_t>(0xFFFFFFFE, 0));
+
+    full.Resize(MEMORY_PAGE_SIZE + 2);
+    EXPECT_TRUE(full.Store<uint32_t>(MEMORY_PAGE_SIZE - 2, 0xAABBCCDD));
+    EXPECT_FALSE(full.Store<uint32_t>(MEMORY_PAGE_SIZE - 1, 0));
+    full.Resize(MEMORY_PAGE_SIZE);
+    full.Resize(ADDRESS_SPACE_SIZE);
+    EXPECT_EQ(full.Read(MEMORY_PAGE_SIZE - 2), 0x0000CCDD);
+    EXPECT_EQ(full.Read(0xFFFFFFFC), 0);
+
+    full.Reset();
+    EXPECT_EQ(full.Read(MEMORY_PAGE_SIZE - 2), 0);
+}
+
+TEST(MemoryTestSuite, PageViews)
+{
+    Memory bytes(5 * MEMORY_PAGE_SIZE + 6);
+    EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE + 8, 0x11223344));
+    EXPECT_TRUE(bytes.Store<uint16_t>(5 * MEMORY_PAGE_SIZE + 4, 0xBEEF));
+
+    vector<uint32_t> addresses;
+    for (const MemoryPageView page : bytes.GetPages()) {
+        addresses.push_back(page.address);
+    }
+    EXPECT_EQ(addresses, (vector<uint32_t>{MEMORY_PAGE_SIZE, 5 * MEMORY_PAGE_SIZE}));
+    // looking at memory does not allocate it
+    EXPECT_EQ(bytes.GetPageCount(), 2);
+
+    const MemoryPageView written = bytes.ViewPage(MEMORY_PAGE_SIZE + 100);
+    EXPECT_EQ(written.address, MEMORY_PAGE_SIZE);
+    EXPECT_EQ(written.bytes.size(), MEMORY_PAGE_SIZE);
+    EXPECT_EQ(written.bytes[8], 0x44);
+    EXPECT_EQ(written.bytes[11], 0x11);
+
+    const MemoryPageView untouched = bytes.ViewPage(3 * MEMORY_PAGE_SIZE);
+    EXPECT_EQ(untouched.bytes.size(), MEMORY_PAGE_SIZE);
+    EXPECT_TRUE(std::ranges::all_of(untouched.bytes, [](const uint8_t byte) { return byte == 0; }));
+    EXPECT_EQ(bytes.GetPageCount(), 2);
+
+    // the last page is cut off at the end of the memory
+    const MemoryPageView last = bytes.ViewPage(5 * MEMORY_PAGE_SIZE);
+    EXPECT_EQ(last.bytes.size(), 6);
+    EXPECT_EQ(last.bytes[5], 0xBE);
+    EXPECT_TRUE(bytes.ViewPage(5 * MEMORY_PAGE_SIZE + 6).bytes.empty());
+}
+
+TEST(MemoryTestSuite, DirtyPages)
+{
+    Memory bytes(20 * MEMORY_PAGE_SIZE);
+    EXPECT_TRUE(bytes.CollectDirtyPages().empty());
+
+    EXPECT_TRUE(bytes.Store<uint8_t>(3 * MEMORY_PAGE_SIZE, 1));
+    EXPECT_TRUE(bytes.Store<uint32_t>(11 * MEMORY_PAGE_SIZE - 2, 0xFFFFFFFF));
+    bytes.ReadByte(15 * MEMORY_PAGE_SIZE);
+    const vector<MemoryPageView> dirty = bytes.CollectDirtyPages();
+    ASSERT_EQ(dirty.size(), 3);
+    EXPECT_EQ(dirty[0].address, 3 * MEMORY_PAGE_SIZE);
+    EXPECT_EQ(dirty[0].bytes[0], 1);
+    EXPECT_EQ(dirty[1].address, 10 * MEMORY_PAGE_SIZE);
+    EXPECT_EQ(dirty[2].address, 11 * MEMORY_PAGE_SIZE);
+    // collecting clears them
+    EXPECT_TRUE(bytes.CollectDirtyPages().empty());
+
+    const uint8_t data[] = {1, 2};
+    EXPECT_TRUE(bytes.WriteRange(19 * MEMORY_PAGE_SIZE, data));
+    bytes.Reset();
+    EXPECT_TRUE(bytes.CollectDirtyPages().empty());
+}
+
+TEST(MemoryTestSuite, Snapshot)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(16 * MEMORY_PAGE_SIZE, backend);
+        EXPECT_TRUE(bytes.Store<uint32_t>(2 * MEMORY_PAGE_SIZE, 0x12345678));
+        EXPECT_TRUE(bytes.Store<uint32_t>(9 * MEMORY_PAGE_SIZE - 2, 0xFFFFFFFF));
+        const MemorySnapshot snapshot = bytes.Snapshot();
+        EXPECT_EQ(snapshot.size, 16 * MEMORY_PAGE_SIZE);
+        ASSERT_EQ(snapshot.pages.size(), 3);
+        EXPECT_EQ(snapshot.pages[0].first, 2);
+
+        // writing copies the page instead of changing the snapshot
+        EXPECT_TRUE(bytes.Store<uint32_t>(2 * MEMORY_PAGE_SIZE, 1));
+        EXPECT_TRUE(bytes.Store<uint8_t>(12 * MEMORY_PAGE_SIZE, 1));
+        bytes.Resize(4 * MEMORY_PAGE_SIZE);
+        EXPECT_EQ(bytes.Read(2 * MEMORY_PAGE_SIZE), 1);
+        EXPECT_EQ(snapshot.pages[0].second[0], 0x78);
+
+        bytes.Restore(snapshot);
+        EXPECT_EQ(bytes.GetSize(), 16 * MEMORY_PAGE_SIZE);
+        EXPECT_EQ(bytes.Read(2 * MEMORY_PAGE_SIZE), 0x12345678);
+        EXPECT_EQ(bytes.Read(9 * MEMORY_PAGE_SIZE - 2), 0xFFFFFFFF);
+        EXPECT_EQ(bytes.ReadByte(12 * MEMORY_PAGE_SIZE), 0);
+        EXPECT_TRUE(bytes.CollectDirtyPages().empty());
+        if (bytes.GetBackend() == MemoryBackend::PAGED) {
+            EXPECT_EQ(bytes.GetPageCount(), 3);
+        }
+
+        // the snapshot survives being restored
+        EXPECT_TRUE(bytes.Store<uint32_t>(2 * MEMORY_PAGE_SIZE, 2));
+        bytes.Restore(snapshot);
+        EXPECT_EQ(bytes.Read(2 * MEMORY_PAGE_SIZE), 0x12345678);
+        // and a snapshot of a restored memory holds the same pages
+        EXPECT_EQ(bytes.Snapshot().pages.size(), 3);
+    }
+}
+
+TEST(MemoryTestSuite, ResetImage)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(16 * MEMORY_PAGE_SIZE, backend);
+        EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE, 0x12345678));
+        EXPECT_TRUE(bytes.Store<uint32_t>(3 * MEMORY_PAGE_SIZE, 0xABCDEF));
+        bytes.SetResetImage();
+
+        EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE, 1));
+        EXPECT_TRUE(bytes.Store<uint32_t>(9 * MEMORY_PAGE_SIZE - 2, 0xFFFFFFFF));
+        bytes.Reset();
+        EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE), 0x12345678);
+        EXPECT_EQ(bytes.Read(3 * MEMORY_PAGE_SIZE), 0xABCDEF);
+        EXPECT_EQ(bytes.Read(9 * MEMORY_PAGE_SIZE - 2), 0);
+        if (bytes.GetBackend() == MemoryBackend::PAGED) {
+            EXPECT_EQ(bytes.GetPageCount(), 2);
+        }
+
+        // restoring a snapshot keeps the image for later resets
+        const MemorySnapshot snapshot = bytes.Snapshot();
+        EXPECT_TRUE(bytes.Store<uint8_t>(5 * MEMORY_PAGE_SIZE, 1));
+        bytes.Restore({16 * MEMORY_PAGE_SIZE, {}});
+        EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE), 0);
+        bytes.Reset();
+        EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE), 0x12345678);
+        EXPECT_EQ(bytes.ReadByte(5 * MEMORY_PAGE_SIZE), 0);
+        bytes.Restore(snapshot);
+        EXPECT_EQ(bytes.Read(3 * MEMORY_PAGE_SIZE), 0xABCDEF);
+
+        bytes.ClearResetImage();
+        bytes.Reset();
+        EXPECT_EQ(bytes.Read(MEMORY_PAGE_SIZE), 0);
+        EXPECT_EQ(bytes.Read(3 * MEMORY_PAGE_SIZE), 0);
+        EXPECT_EQ(bytes.GetPageCount(), 0);
+    }
+}
+
+TEST(MemoryTestSuite, ResetWrittenPages)
+{
+    // resetting only visits written pages, the size does not matter
+    Memory bytes(ADDRESS_SPACE_SIZE);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(bytes.Store<uint32_t>(0xFFFFFF00, i));
+        bytes.Reset();
+    }
+    EXPECT_EQ(bytes.Read(0xFFFFFF00), 0);
+    EXPECT_EQ(bytes.GetPageCount(), 0);
+
+    // shrinking keeps what is left written, so the next reset still clears it
+    EXPECT_TRUE(bytes.Store<uint8_t>(MEMORY_PAGE_SIZE, 1));
+    bytes.SetResetImage();
+    EXPECT_TRUE(bytes.Store<uint8_t>(0, 1));
+    bytes.Resize(2 * MEMORY_PAGE_SIZE);
+    bytes.Reset();
+    EXPECT_EQ(bytes.ReadByte(0), 0);
+    EXPECT_EQ(bytes.ReadByte(MEMORY_PAGE_SIZE), 0);
+    EXPECT_EQ(bytes.GetPageCount(), 0);
+}
+
+TEST(MemoryTestSuite, Footprint)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(16 * MEMORY_PAGE_SIZE, backend);
+        EXPECT_EQ(bytes.GetFootprint(), 0);
+        EXPECT_TRUE(bytes.Store<uint32_t>(0, 1));
+        EXPECT_TRUE(bytes.Store<uint32_t>(4, 1));
+        EXPECT_TRUE(bytes.Store<uint32_t>(5 * MEMORY_PAGE_SIZE, 1));
+        EXPECT_EQ(bytes.GetFootprint(), 2 * MEMORY_PAGE_SIZE);
+        // reads do not count
+        EXPECT_EQ(bytes.Read(9 * MEMORY_PAGE_SIZE), 0);
+        EXPECT_EQ(bytes.GetFootprint(), 2 * MEMORY_PAGE_SIZE);
+        bytes.Reset();
+        EXPECT_EQ(bytes.GetFootprint(), 0);
+    }
+}
+
+TEST(MemoryTestSuite, Fetch)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(2 * MEMORY_PAGE_SIZE, backend);
+        uint32_t word = 1;
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE, word));
+        EXPECT_EQ(word, 0);
+
+        // stores show up in the page being fetched from, also once it has been shared with a snapshot
+        EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE, 0x12345678));
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE, word));
+        EXPECT_EQ(word, 0x12345678);
+        // from any even address, a compressed instruction only needs the low half
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE + 3, word));
+        EXPECT_EQ(word, 0x1234);
+        const MemorySnapshot snapshot = bytes.Snapshot();
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE, word));
+        EXPECT_TRUE(bytes.Store<uint8_t>(MEMORY_PAGE_SIZE, 0x99));
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE, word));
+        EXPECT_EQ(word, 0x12345699);
+        bytes.Reset();
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE, word));
+        EXPECT_EQ(word, 0);
+
+        EXPECT_FALSE(bytes.Fetch(2 * MEMORY_PAGE_SIZE, word));
+
+        // across a page boundary and up to the end of the memory
+        EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE - 2, 0x11223344));
+        EXPECT_TRUE(bytes.Fetch(MEMORY_PAGE_SIZE - 2, word));
+        EXPECT_EQ(word, 0x11223344);
+        EXPECT_TRUE(bytes.Store<uint16_t>(2 * MEMORY_PAGE_SIZE - 2, 0xABCD));
+        EXPECT_TRUE(bytes.Fetch(2 * MEMORY_PAGE_SIZE - 2, word));
+        EXPECT_EQ(word, 0xABCD);
+    }
+}
+
+TEST(MemoryTestSuite, AddToResetImage)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(2 * MEMORY_PAGE_SIZE, backend);
+        EXPECT_TRUE(bytes.Store<uint32_t>(0, 7));
+        bytes.SetResetImage();
+        EXPECT_TRUE(bytes.Store<uint32_t>(8, 9));
+
+        const uint8_t code[] = {1, 2, 3, 4};
+        EXPECT_TRUE(bytes.AddToResetImage(MEMORY_PAGE_SIZE - 2, code));
+        EXPECT_FALSE(bytes.AddToResetImage(2 * MEMORY_PAGE_SIZE - 2, code));
+        // only the image has it
+        EXPECT_EQ(bytes.ReadByte(MEMORY_PAGE_SIZE - 2), 0);
+        EXPECT_EQ(bytes.Read(8), 9);
+        uint8_t image[6] = {};
+        EXPECT_TRUE(bytes.ReadResetImage(MEMORY_PAGE_SIZE - 3, image));
+        EXPECT_TRUE(std::ranges::equal(image, (uint8_t[]){0, 1, 2, 3, 4, 0}));
+
+        bytes.Reset();
+        EXPECT_EQ(bytes.Read(0), 7);
+        EXPECT_EQ(bytes.Read(8), 0);
+        EXPECT_EQ(bytes.ReadByte(MEMORY_PAGE_SIZE + 1), 4);
+    }
+}
+
+TEST(MemoryTestSuite, CodeChanges)
+{
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Memory bytes(2 * MEMORY_PAGE_SIZE, backend);
+        bytes.Write(0, 1);
+        bytes.SetResetImage();
+        bytes.SetCodeRange(0, 64);
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        EXPECT_FALSE(bytes.CollectCodeChanges(begin, end));
+
+        // data after the code and in other pages does not count
+        EXPECT_TRUE(bytes.Store<uint32_t>(64, 2));
+        EXPECT_TRUE(bytes.Store<uint32_t>(MEMORY_PAGE_SIZE, 2));
+        EXPECT_FALSE(bytes.HasCodeChanges());
+        EXPECT_TRUE(bytes.Store<uint16_t>(62, 0xFFFF));
+        EXPECT_TRUE(bytes.Store<uint8_t>(8, 3));
+        EXPECT_TRUE(bytes.HasCodeChanges());
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        EXPECT_EQ(begin, 8);
+        EXPECT_EQ(end, 64);
+        EXPECT_FALSE(bytes.HasCodeChanges());
+
+        // going back changes the code, unless it ends up the same
+        const MemorySnapshot snapshot = bytes.Snapshot();
+        bytes.Reset();
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        EXPECT_EQ(begin, 0);
+        EXPECT_EQ(end, 64);
+        bytes.Store<uint32_t>(64, 5);
+        bytes.Reset();
+        EXPECT_FALSE(bytes.HasCodeChanges());
+        bytes.Restore(snapshot);
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        bytes.Restore(snapshot);
+        EXPECT_FALSE(bytes.HasCodeChanges());
+
+        // the dirty map still takes the direct path for other pages only
+        EXPECT_EQ(bytes.GetDirtyMap()[0] & CODE_PAGE, CODE_PAGE);
+        EXPECT_EQ(bytes.GetDirtyMap()[1] & CODE_PAGE, 0);
+        bytes.MarkDirtyRange(60, 8);
+        EXPECT_TRUE(bytes.HasCodeChanges());
+        bytes.InvalidateCode();
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        EXPECT_EQ(begin, 0);
+        EXPECT_EQ(end, 64);
+
+        bytes.SetCodeRange(0, 0);
+        bytes.Store<uint32_t>(0, 4);
+        EXPECT_FALSE(bytes.HasCodeChanges());
+        EXPECT_EQ(bytes.GetDirtyMap()[0] & CODE_PAGE, 0);
+
+        // code that does not start at 0 leaves what is in front of it alone
+        bytes.SetCodeRange(MEMORY_PAGE_SIZE + 16, MEMORY_PAGE_SIZE + 64);
+        EXPECT_EQ(bytes.GetDirtyMap()[0] & CODE_PAGE, 0);
+        EXPECT_EQ(bytes.GetDirtyMap()[1] & CODE_PAGE, CODE_PAGE);
+        bytes.Store<uint32_t>(MEMORY_PAGE_SIZE + 12, 6);
+        EXPECT_FALSE(bytes.HasCodeChanges());
+        bytes.Store<uint32_t>(MEMORY_PAGE_SIZE + 14, 0x06060606);
+        bytes.Reset();
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        EXPECT_EQ(begin, MEMORY_PAGE_SIZE + 16);
+        EXPECT_EQ(end, MEMORY_PAGE_SIZE + 64);
+        bytes.InvalidateCode();
+        EXPECT_TRUE(bytes.CollectCodeChanges(begin, end));
+        EXPECT_EQ(begin, MEMORY_PAGE_SIZE + 16);
+        EXPECT_EQ(end, MEMORY_PAGE_SIZE + 64);
+    }
+}
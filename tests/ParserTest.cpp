@@ -440,3 +440,64 @@ TEST(ParserTestSuite, REMU)
     EXPECT_EQ(result.instructions.size(), 1);
     EXPECT_EQ(std::bitset<32>(result.instructions[0]), std::bitset<32>(0b00000011001010001111011110110011));
 }
+
+TEST(ParserTestSuite, CompressedMnemonics)
+{
+    ParsingResult result = Parser::Parse({"c.li x8, 5", "loop:", "c.addi x8, -1", "c.bnez x8, loop", "c.nop"});
+    EXPECT_EQ(result.success, true);
+    EXPECT_EQ(result.instructionAddresses, vector<uint32_t>({0, 2, 4, 6}));
+    EXPECT_EQ(result.instructions, vector<uint32_t>({0x147D4415, 0x0001FC7D}));
+
+    // padded with c.nop
+    result = Parser::Parse({"c.mv x1, x2", "c.jr x1", "c.lwsp x3, 8(x2)"});
+    EXPECT_EQ(result.instructions, vector<uint32_t>({0x8082808A, 0x000141A2}));
+
+    result = Parser::Parse({"add x1, x1, x1", "c.lw x1, 0(x8)"});
+    EXPECT_EQ(result.success, false);
+    EXPECT_EQ(result.errorType, ParsingError::NOT_COMPRESSIBLE);
+    EXPECT_EQ(result.errorLine, 2);
+    EXPECT_EQ(result.errorPart, "c.lw");
+
+    result = Parser::Parse({"c.li x8"});
+    EXPECT_EQ(result.success, false);
+    EXPECT_EQ(result.errorType, ParsingError::INVALID_OPERAND_COUNT);
+}
+
+TEST(ParserTestSuite, Compress)
+{
+    const uint32_t load = Parser::Parse({"lw x1, 0(x20)"}).instructions[0];
+    ParsingResult result = Parser::Parse({"addi x8, x0, 5", "add x9, x9, x10", "lw x1, 0(x20)"});
+    EXPECT_EQ(result.instructionAddresses, vector<uint32_t>({0, 4, 8}));
+    result = Parser::Parse({"addi x8, x0, 5", "add x9, x9, x10", "lw x1, 0(x20)"}, true);
+    EXPECT_EQ(result.success, true);
+    EXPECT_EQ(result.instructionAddresses, vector<uint32_t>({0, 2, 4}));
+    EXPECT_EQ(result.instructions, vector<uint32_t>({0x94AA4415, load}));
+
+    // the branch only reaches the label once the instructions in between are compressed
+    vector<string> program = {"beq x8, x0, end"};
+    program.insert(program.end(), 70, "addi x8, x8, 1");
+    program.push_back("end:");
+    program.push_back("jal x0, -4");
+    result = Parser::Parse(program, true);
+    EXPECT_EQ(result.success, true);
+    EXPECT_EQ(result.instructionAddresses[1], 2);
+    EXPECT_EQ(result.instructionAddresses.back(), 142);
+    EXPECT_EQ(result.instructions.size(), 36);
+}
+
+TEST(ParserTestSuite, BitManipulation)
+{
+    const ParsingResult result =
+        Parser::Parse({"sh1add x1, x2, x3", "andn x5, x6, x7", "max x5, x6, x7", "rol x5, x6, x7", "rori x10, x10, 3",
+                       "clz x10, x10", "cpop x5, x6", "sext.b x5, x6", "zext.h x10, x10", "orc.b x10, x10",
+                       "rev8 x10, x10"});
+    EXPECT_EQ(result.success, true);
+    EXPECT_EQ(result.instructions, vector<uint32_t>({0x203120B3, 0x407372B3, 0x0A7362B3, 0x607312B3, 0x60355513,
+                                                     0x60051513, 0x60231293, 0x60431293, 0x08054533, 0x28755513,
+                                                     0x69855513}));
+
+    // the unary ones take no rs2
+    const ParsingResult error = Parser::Parse({"clz x10, x10, x11"});
+    EXPECT_EQ(error.success, false);
+    EXPECT_EQ(error.errorType, ParsingError::INVALID_OPERAND_COUNT);
+}
@@ -0,0 +1,1074 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "../parser/Parser.h"
+#include "../simulator/ElfFile.h"
+#include "../simulator/ForkServer.h"
+#include "../simulator/Lockstep.h"
+#include "../simulator/Simulator.h"
+#include "../simulator/SnapshotFile.h"
+
+static const vector<string> sumProgram = {"addi x1, x0, 10", "addi x2, x0, 0", "loop:",  "add x2, x2, x1",
+                                          "addi x1, x1, -1", "bne x1, x0, loop", "sw x2, 64(x0)", "lw x3, 64(x0)",
+                                          "jal x4, end",     "addi x5, x0, 1",   "end:",    "mul x6, x3, x3"};
+
+// an executable with the code at codeAddress and a page of data followed by a page of zeros at 0x20000
+static void WriteElf(const string& path, const vector<uint32_t>& code, const uint32_t value,
+                     const uint32_t codeAddress = 0x10000)
+{
+    constexpr uint32_t codeOffset = 0x1000;
+    constexpr uint32_t dataOffset = 0x2000;
+    constexpr uint32_t symbolOffset = dataOffset + MEMORY_PAGE_SIZE;
+    const char strings[] = "\0main\0value\0undefined";
+    const uint32_t codeSize = static_cast<uint32_t>(code.size() * 4);
+    const ElfSymbolEntry symbols[] = {{0, 0, 0, 0, 0, 0},
+                                      {1, codeAddress, codeSize, ELF_SYMBOL_FUNCTION, 0, 1},
+                                      {6, 0x20000, 4, ELF_SYMBOL_OBJECT, 0, 2},
+                                      {12, 0, 0, ELF_SYMBOL_FUNCTION, 0, 0}};
+    const uint32_t stringOffset = symbolOffset + sizeof(symbols);
+    const uint32_t sectionOffset = stringOffset + sizeof(strings);
+    const ElfSectionHeader sections[] = {
+        {},
+        {0, ELF_SECTION_SYMBOL_TABLE, 0, 0, symbolOffset, sizeof(symbols), 2, 1, 4, sizeof(ElfSymbolEntry)},
+        {0, 3, 0, 0, stringOffset, sizeof(strings), 0, 0, 1, 0}};
+    ElfHeader header{{0x7F, 'E', 'L', 'F', 1, 1, 1},
+                     ELF_TYPE_EXECUTABLE,
+                     ELF_MACHINE_RISCV,
+                     1,
+                     codeAddress,
+                     sizeof(ElfHeader),
+                     sectionOffset,
+                     0,
+                     sizeof(ElfHeader),
+                     sizeof(ElfProgramHeader),
+                     2,
+                     sizeof(ElfSectionHeader),
+                     3,
+                     0};
+    const ElfProgramHeader segments[] = {
+        {ELF_SEGMENT_LOAD, codeOffset, codeAddress, codeAddress, codeSize, codeSize, 5, MEMORY_PAGE_SIZE},
+        {ELF_SEGMENT_LOAD, dataOffset, 0x20000, 0x20000, MEMORY_PAGE_SIZE, 2 * MEMORY_PAGE_SIZE, 6, MEMORY_PAGE_SIZE}};
+    vector<uint8_t> data(MEMORY_PAGE_SIZE, 0xAB);
+    std::copy_n(reinterpret_cast<const uint8_t*>(&value), 4, data.begin());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(segments), sizeof(segments));
+    file.seekp(codeOffset);
+    file.write(reinterpret_cast<const char*>(code.data()), codeSize);
+    file.seekp(dataOffset);
+    file.write(reinterpret_cast<const char*>(data.data()), MEMORY_PAGE_SIZE);
+    file.write(reinterpret_cast<const char*>(symbols), sizeof(symbols));
+    file.write(strings, sizeof(strings));
+    file.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+}
+
+static void ExpectSameResult(const ExecutionResult& expected, const ExecutionResult& actual)
+{
+    EXPECT_EQ(expected.success, actual.success);
+    EXPECT_EQ(expected.error, actual.error);
+    EXPECT_EQ(expected.memoryChanged, actual.memoryChanged);
+    EXPECT_EQ(expected.memoryChange.address, actual.memoryChange.address);
+    EXPECT_EQ(expected.memoryChange.value, actual.memoryChange.value);
+    EXPECT_EQ(expected.registerChanged, actual.registerChanged);
+    EXPECT_EQ(expected.registerChange, actual.registerChange);
+    EXPECT_EQ(expected.pc, actual.pc);
+    EXPECT_EQ(expected.errorPc, actual.errorPc);
+}
+
+static void ExpectSameSteps(const vector<string>& program, const ExecutionEngine engine)
+{
+    const vector<uint32_t> instructions = Parser::Parse(program).instructions;
+    Simulator reference(256);
+    Simulator simulator(256, engine);
+    reference.SetInstructions(instructions);
+    simulator.SetInstructions(instructions);
+
+    for (int i = 0; i < 100; i++) {
+        const ExecutionResult expected = reference.Step();
+        ExpectSameResult(expected, simulator.Step());
+        if (!expected.success) {
+            break;
+        }
+    }
+    EXPECT_TRUE(std::ranges::equal(reference.GetCpuStatus().registers, simulator.GetCpuStatus().registers));
+    EXPECT_EQ(reference.GetCpuStatus().retired, simulator.GetCpuStatus().retired);
+    EXPECT_EQ(reference.GetMemory(), simulator.GetMemory());
+}
+
+// runs the program to its end on every engine and memory backend
+static void ExpectRegisters(const vector<string>& program, const vector<std::pair<uint8_t, uint32_t>>& expected)
+{
+    const vector<uint32_t> instructions = Parser::Parse(program).instructions;
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                             ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+            Simulator simulator(MEMORY_PAGE_SIZE, engine, backend);
+            simulator.SetInstructions(instructions);
+            EXPECT_EQ(simulator.RunUntilHalt().reason, StopReason::HALTED);
+            const CpuStatus status = simulator.GetCpuStatus();
+            for (const auto& [reg, value] : expected) {
+                EXPECT_EQ(status.registers[reg], value) << static_cast<int>(reg);
+            }
+        }
+    }
+}
+
+TEST(SimulatorTestSuite, ShiftCounts)
+{
+    // only the low 5 bits of the count are used
+    ExpectRegisters({"addi x1, x0, -8", "addi x2, x0, 33", "addi x3, x0, -1", "sll x4, x1, x2", "srl x5, x1, x2",
+                     "sra x6, x1, x2", "sll x7, x1, x3", "srl x8, x1, x3"},
+                    {{4, 0xFFFFFFF0}, {5, 0x7FFFFFFC}, {6, 0xFFFFFFFC}, {7, 0}, {8, 1}});
+}
+
+TEST(SimulatorTestSuite, MultiplyHigh)
+{
+    ExpectRegisters({"addi x1, x0, -1", "addi x2, x0, 3", "lui x3, 0x80000", "mulh x4, x1, x1", "mulh x5, x1, x2",
+                     "mulhsu x6, x1, x1", "mulhsu x7, x2, x1", "mulhu x8, x1, x1", "mulh x9, x3, x3",
+                     "mulhsu x10, x3, x1"},
+                    {{4, 0}, {5, 0xFFFFFFFF}, {6, 0xFFFFFFFF}, {7, 2}, {8, 0xFFFFFFFE}, {9, 0x40000000},
+                     {10, 0x80000000}});
+}
+
+TEST(SimulatorTestSuite, DivisionOverflow)
+{
+    // INT_MIN / -1 would trap on the host
+    ExpectRegisters({"lui x1, 0x80000", "addi x2, x0, -1", "div x3, x1, x2", "rem x4, x1, x2", "addi x5, x0, 7",
+                     "div x6, x5, x2", "rem x7, x5, x2", "addi x4, x4, 1"},
+                    {{3, 0x80000000}, {4, 1}, {6, 0xFFFFFFF9}, {7, 0}});
+}
+
+TEST(SimulatorTestSuite, JumpThroughReturnAddress)
+{
+    // call with a pc relative target, jalr reads x1 before it overwrites it
+    const vector<string> program = {"addi x5, x0, 1", "auipc x1, 0", "jalr x1, 12(x1)", "addi x5, x0, 99",
+                                    "addi x6, x1, 0"};
+    ExpectRegisters(program, {{1, 12}, {5, 1}, {6, 12}});
+
+    Lockstep lockstep(1, MEMORY_PAGE_SIZE);
+    lockstep.SetInstructions(Parser::Parse(program).instructions);
+    EXPECT_EQ(lockstep.Run(UINT64_MAX)[0].reason, StopReason::HALTED);
+    EXPECT_EQ(lockstep.GetRegister(0, 5), 1);
+    EXPECT_EQ(lockstep.GetRegister(0, 6), 12);
+}
+
+TEST(SimulatorTestSuite, ThreadedStep)
+{
+    ExpectSameSteps(sumProgram, ExecutionEngine::THREADED);
+    ExpectSameSteps({"addi x1, x0, 1", "div x2, x1, x0"}, ExecutionEngine::THREADED);
+    ExpectSameSteps({"addi x1, x0, 2047", "lw x2, 0(x1)"}, ExecutionEngine::THREADED);
+    ExpectSameSteps({"addi x1, x0, 6", "jalr x2, 0(x1)"}, ExecutionEngine::THREADED);
+    ExpectSameSteps({"jal x1, 400"}, ExecutionEngine::THREADED);
+}
+
+TEST(SimulatorTestSuite, ThreadedRun)
+{
+    Memory memory;
+    CPU cpu(&memory);
+    cpu.LoadInstructions(Parser::Parse(sumProgram).instructions);
+    ThreadedInterpreter interpreter(&cpu);
+    interpreter.Load();
+
+    RunResult result = interpreter.Run(5);
+    EXPECT_EQ(result.instructions, 5);
+    EXPECT_EQ(result.error, ExecutionError::NONE);
+    EXPECT_EQ(result.pc, 8);
+
+    result = interpreter.Run(1000);
+    EXPECT_EQ(result.instructions, 31);
+    EXPECT_EQ(result.error, ExecutionError::PC_OUT_OF_BOUNDS);
+    EXPECT_EQ(result.pc, 40);
+    EXPECT_EQ(cpu.GetStatus().registers[2], 55);
+    EXPECT_EQ(cpu.GetStatus().registers[4], 32);
+    EXPECT_EQ(cpu.GetStatus().registers[5], 0);
+    EXPECT_EQ(cpu.GetStatus().registers[6], 55 * 55);
+    EXPECT_EQ(memory.Read(64), 55);
+
+    cpu.Reset();
+    cpu.LoadInstructions(Parser::Parse({"addi x1, x0, 1", "addi x2, x0, 1", "div x3, x1, x0"}).instructions);
+    interpreter.Load();
+    result = interpreter.Run(1000);
+    EXPECT_EQ(result.instructions, 2);
+    EXPECT_EQ(result.error, ExecutionError::DIVISION_BY_ZERO);
+    EXPECT_EQ(result.errorPc, 8);
+    EXPECT_EQ(cpu.GetStatus().registers[1], 0);
+}
+
+TEST(SimulatorTestSuite, BlockCacheStep) { ExpectSameSteps(sumProgram, ExecutionEngine::BLOCK_CACHE); }
+
+TEST(SimulatorTestSuite, BlockCacheRun)
+{
+    const vector<vector<string>> programs = {
+        sumProgram,
+        {"addi x1, x0, 1", "addi x2, x0, 1", "div x3, x1, x0", "addi x4, x0, 1"},
+        {"addi x1, x0, 3", "loop:", "addi x1, x1, -1", "addi x2, x1, 8", "lw x3, 0(x2)", "bne x1, x0, loop",
+         "jalr x0, 400(x0)"},
+        {"addi x1, x0, 12", "jalr x2, 0(x1)", "addi x3, x0, 1", "addi x4, x0, 2", "jal x0, -8"}};
+
+    for (const auto& program : programs) {
+        for (const uint64_t budget : {1, 2, 3, 5, 7, 1000}) {
+            Memory threadedMemory;
+            CPU threadedCpu(&threadedMemory);
+            threadedCpu.LoadInstructions(Parser::Parse(program).instructions);
+            ThreadedInterpreter threaded(&threadedCpu);
+            threaded.Load();
+
+            Memory blockMemory;
+            CPU blockCpu(&blockMemory);
+            blockCpu.LoadInstructions(Parser::Parse(program).instructions);
+            BlockCache blockCache(&blockCpu);
+            blockCache.Load();
+
+            for (int i = 0; i < 4; i++) {
+                const RunResult expected = threaded.Run(budget);
+                const RunResult actual = blockCache.Run(budget);
+                EXPECT_EQ(expected.instructions, actual.instructions);
+                EXPECT_EQ(expected.error, actual.error);
+                EXPECT_EQ(expected.pc, actual.pc);
+                EXPECT_EQ(expected.errorPc, actual.errorPc);
+                EXPECT_TRUE(std::ranges::equal(threadedCpu.GetStatus().registers, blockCpu.GetStatus().registers));
+            }
+        }
+    }
+}
+
+TEST(SimulatorTestSuite, JitRun)
+{
+    const vector<vector<string>> programs = {
+        sumProgram,
+        {"addi x1, x0, 7", "addi x2, x0, 1", "loop:", "div x3, x1, x2", "rem x4, x1, x2", "addi x2, x2, 1",
+         "blt x2, x1, loop", "divu x5, x1, x0"},
+        {"addi x1, x0, -2", "slti x2, x1, 1", "sltiu x3, x1, 1", "srai x4, x1, 1", "srli x5, x1, 28", "sb x1, 8(x0)",
+         "sh x1, 9(x0)", "lb x6, 8(x0)", "lhu x7, 9(x0)", "mulhu x8, x1, x1", "lw x9, 300(x0)"},
+        {"addi x1, x0, 12", "jalr x2, 0(x1)", "addi x3, x0, 1", "addi x4, x0, 2", "jalr x0, 2(x2)"}};
+
+    for (const auto& program : programs) {
+        for (const uint64_t budget : {1, 3, 1000}) {
+            Memory threadedMemory;
+            CPU threadedCpu(&threadedMemory);
+            threadedCpu.LoadInstructions(Parser::Parse(program).instructions);
+            ThreadedInterpreter threaded(&threadedCpu);
+            threaded.Load();
+
+            Memory jitMemory;
+            CPU jitCpu(&jitMemory);
+            jitCpu.LoadInstructions(Parser::Parse(program).instructions);
+            Jit jit(&jitCpu, 1);
+            jit.Load();
+
+            for (int i = 0; i < 4; i++) {
+                const RunResult expected = threaded.Run(budget);
+                const RunResult actual = jit.Run(budget);
+                EXPECT_EQ(expected.instructions, actual.instructions);
+                EXPECT_EQ(expected.error, actual.error);
+                EXPECT_EQ(expected.pc, actual.pc);
+                EXPECT_EQ(expected.errorPc, actual.errorPc);
+                EXPECT_TRUE(std::ranges::equal(threadedCpu.GetStatus().registers, jitCpu.GetStatus().registers));
+                EXPECT_EQ(threadedMemory.GetMemory(), jitMemory.GetMemory());
+            }
+            if (Jit::IsSupported() && budget == 1000) {
+                EXPECT_GT(jit.GetCompiledBlockCount(), 0);
+            }
+        }
+    }
+}
+
+TEST(SimulatorTestSuite, JitHotBlock)
+{
+    Memory memory;
+    CPU cpu(&memory);
+    cpu.LoadInstructions(Parser::Parse(sumProgram).instructions);
+    Jit jit(&cpu, 4);
+    jit.Load();
+
+    const RunResult result = jit.Run(1000);
+    EXPECT_EQ(result.instructions, 36);
+    EXPECT_EQ(result.error, ExecutionError::PC_OUT_OF_BOUNDS);
+    EXPECT_EQ(cpu.GetStatus().registers[6], 3025);
+    // only the loop body runs often enough to be compiled
+    EXPECT_EQ(jit.GetCompiledBlockCount(), Jit::IsSupported() ? 1 : 0);
+}
+
+TEST(SimulatorTestSuite, JitReservedMemory)
+{
+    Memory memory(2 * MEMORY_PAGE_SIZE, MemoryBackend::RESERVED);
+    CPU cpu(&memory);
+    cpu.LoadInstructions(Parser::Parse({"addi x1, x0, 7", "addi x2, x0, 0", "loop:", "sw x1, 0(x2)",
+                                        "addi x2, x2, 1024", "beq x0, x0, loop"})
+                             .instructions);
+    Jit jit(&cpu, 2);
+    jit.Load();
+
+    // the ninth store runs off the end of the memory
+    const RunResult result = jit.Run(1000);
+    EXPECT_EQ(result.instructions, 26);
+    EXPECT_EQ(result.error, ExecutionError::INVALID_MEMORY_ACCESS);
+    EXPECT_EQ(result.errorPc, 8);
+    EXPECT_EQ(memory.Read(7 * 1024), 7);
+    EXPECT_EQ(jit.GetCompiledBlockCount(), Jit::IsSupported() ? 1 : 0);
+    // stores of the compiled block mark their pages as well
+    EXPECT_EQ(memory.CollectDirtyPages().size(), 2);
+}
+
+TEST(SimulatorTestSuite, JitDirtyPages)
+{
+    Memory memory(2 * MEMORY_PAGE_SIZE, MemoryBackend::RESERVED);
+    CPU cpu(&memory);
+    cpu.LoadInstructions(
+        Parser::Parse({"addi x1, x0, 2047", "addi x1, x1, 2047", "addi x2, x0, -1", "sw x2, 0(x1)"}).instructions);
+    Jit jit(&cpu, 1);
+    jit.Load();
+    jit.Run(100);
+
+    // the word straddles both pages
+    const vector<MemoryPageView> dirty = memory.CollectDirtyPages();
+    ASSERT_EQ(dirty.size(), 2);
+    EXPECT_EQ(dirty[1].address, MEMORY_PAGE_SIZE);
+    EXPECT_EQ(memory.Read(MEMORY_PAGE_SIZE - 2), 0xFFFFFFFF);
+
+    // the pages are written ones as well
+    memory.Reset();
+    EXPECT_EQ(memory.Read(MEMORY_PAGE_SIZE - 2), 0);
+}
+
+TEST(SimulatorTestSuite, Run)
+{
+    const vector<uint32_t> instructions = Parser::Parse(sumProgram).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(instructions);
+
+        RunResult result = simulator.Run(5);
+        EXPECT_EQ(result.instructions, 5);
+        EXPECT_EQ(result.reason, StopReason::LIMIT_REACHED);
+        EXPECT_EQ(result.error, ExecutionError::NONE);
+        EXPECT_EQ(result.pc, 8);
+
+        result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.instructions, 31);
+        EXPECT_EQ(result.reason, StopReason::HALTED);
+        EXPECT_EQ(result.error, ExecutionError::PC_OUT_OF_BOUNDS);
+        EXPECT_EQ(result.pc, 40);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 3025);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 36);
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+        const vector<MemoryPageView> diff = simulator.CollectMemoryDiff();
+        ASSERT_EQ(diff.size(), 1);
+        EXPECT_EQ(diff[0].address, 0);
+        EXPECT_EQ(diff[0].bytes.size(), 256);
+
+        result = simulator.Run(5);
+        EXPECT_EQ(result.instructions, 0);
+        EXPECT_EQ(result.reason, StopReason::HALTED);
+    }
+}
+
+TEST(SimulatorTestSuite, Snapshot)
+{
+    const vector<uint32_t> instructions = Parser::Parse(sumProgram).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(instructions);
+        simulator.Run(30);
+        const SimulatorSnapshot snapshot = simulator.Snapshot();
+
+        RunResult result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.instructions, 6);
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+
+        simulator.Restore(snapshot);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, snapshot.hart.registers[PC]);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 30);
+        EXPECT_EQ(simulator.GetMemory()[16], 0);
+        result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.instructions, 6);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 3025);
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+
+        // a snapshot of another size keeps the code for the next reset
+        simulator.ResizeMemory(8192);
+        simulator.Restore(snapshot);
+        EXPECT_EQ(simulator.GetMemorySize(), 256);
+        simulator.Reset();
+        result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.reason, StopReason::HALTED);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 3025);
+    }
+}
+
+TEST(SimulatorTestSuite, ReverseStep)
+{
+    const vector<uint32_t> instructions = Parser::Parse(sumProgram).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(instructions);
+        simulator.EnableHistory(UINT64_MAX, 4);
+        EXPECT_EQ(simulator.ReverseStep(), 0);
+
+        // stepped instructions are undone, run ones replayed from a checkpoint
+        for (int i = 0; i < 34; i++) {
+            simulator.Step();
+        }
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+        EXPECT_EQ(simulator.ReverseStep(2), 2);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 20);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 32);
+        EXPECT_EQ(simulator.GetMemory()[16], 0);
+        EXPECT_EQ(simulator.ReverseStep(), 1);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 16);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], 0);
+
+        simulator.RunUntilHalt();
+        EXPECT_EQ(simulator.ReverseStep(33), 33);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 12);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], 10);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[2], 10);
+        EXPECT_EQ(simulator.RunUntilHalt().instructions, 33);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 3025);
+
+        EXPECT_EQ(simulator.ReverseStep(100), 36);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 0);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], 0);
+    }
+}
+
+TEST(SimulatorTestSuite, ReverseFailure)
+{
+    const vector<uint32_t> instructions =
+        Parser::Parse({"addi x1, x0, 1", "addi x2, x0, 2", "div x3, x1, x0", "addi x4, x0, 1"}).instructions;
+    Simulator simulator(256, ExecutionEngine::THREADED);
+    simulator.SetInstructions(instructions);
+    simulator.EnableHistory(UINT64_MAX);
+
+    // the failure reset the CPU, going back brings its registers back
+    EXPECT_EQ(simulator.RunUntilHalt().reason, StopReason::INSTRUCTION_FAILED);
+    EXPECT_EQ(simulator.ReverseStep(), 1);
+    EXPECT_EQ(simulator.GetCpuStatus().pc, 8);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[2], 2);
+
+    EXPECT_FALSE(simulator.Step().success);
+    EXPECT_EQ(simulator.ReverseStep(2), 2);
+    EXPECT_EQ(simulator.GetCpuStatus().pc, 4);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[1], 1);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[2], 0);
+}
+
+TEST(SimulatorTestSuite, ReverseContinue)
+{
+    Simulator simulator(256, ExecutionEngine::BLOCK_CACHE);
+    simulator.SetInstructions(Parser::Parse(sumProgram).instructions);
+    simulator.EnableHistory(UINT64_MAX, 8);
+    simulator.RunUntilHalt();
+    for (int i = 0; i < 3; i++) {
+        simulator.Step();
+    }
+
+    // back to the last iteration of the loop
+    EXPECT_EQ(simulator.ReverseContinue(12), 6);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[1], 1);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[2], 55);
+    EXPECT_EQ(simulator.ReverseContinue(12), 3);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[1], 2);
+    // pc 0 only comes up at the start
+    EXPECT_EQ(simulator.ReverseContinue(0), 27);
+    EXPECT_EQ(simulator.GetCpuStatus().retired, 0);
+}
+
+TEST(SimulatorTestSuite, HistoryBudget)
+{
+    Simulator simulator(256);
+    simulator.SetInstructions(Parser::Parse(sumProgram).instructions);
+    simulator.EnableHistory(10 * sizeof(UndoRecord), 1000);
+    for (int i = 0; i < 30; i++) {
+        simulator.Step();
+    }
+    // the checkpoint and the oldest records did not fit
+    EXPECT_EQ(simulator.ReverseStep(30), 10);
+    EXPECT_EQ(simulator.GetCpuStatus().retired, 20);
+
+    simulator.Reset();
+    EXPECT_EQ(simulator.ReverseStep(), 0);
+}
+
+TEST(SimulatorTestSuite, ResetImage)
+{
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(
+            Parser::Parse({"addi x1, x0, 64", "lw x2, 0(x1)", "addi x2, x2, 1", "sw x2, 0(x1)"}).instructions);
+        const uint8_t data[] = {41, 0, 0, 0};
+        EXPECT_TRUE(simulator.WriteMemory(64, data));
+        EXPECT_FALSE(simulator.WriteMemory(254, data));
+        simulator.Step();
+        simulator.SetResetImage();
+
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(simulator.RunUntilHalt().instructions, 3);
+            EXPECT_EQ(simulator.GetMemory()[16], 42);
+            // back to after the first instruction and the data it was loaded with
+            simulator.Reset();
+            EXPECT_EQ(simulator.GetCpuStatus().pc, 4);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[1], 64);
+            EXPECT_EQ(simulator.GetCpuStatus().retired, 0);
+            EXPECT_EQ(simulator.GetMemory()[16], 41);
+        }
+
+        simulator.ClearResetImage();
+        simulator.Reset();
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 0);
+        EXPECT_EQ(simulator.GetMemory()[16], 0);
+    }
+}
+
+TEST(SimulatorTestSuite, CodeInMemory)
+{
+    const vector<uint32_t> instructions = Parser::Parse({"lw x1, 0(x0)", "lw x2, 4(x0)", "sw x0, 0(x0)"}).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        // grows to hold the code
+        Simulator simulator(4, engine);
+        simulator.SetInstructions(instructions);
+        EXPECT_EQ(simulator.GetMemorySize(), 12);
+        EXPECT_EQ(simulator.RunUntilHalt().reason, StopReason::HALTED);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], instructions[0]);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[2], instructions[1]);
+        EXPECT_EQ(simulator.GetMemory()[0], 0);
+
+        // the code comes back with a reset, whatever happens to the rest of the memory
+        simulator.ResizeMemory(0);
+        EXPECT_EQ(simulator.GetMemorySize(), 12);
+        simulator.ResizeMemory(256);
+        simulator.ClearResetImage();
+        simulator.Reset();
+        EXPECT_EQ(simulator.GetMemory()[0], instructions[0]);
+        EXPECT_EQ(simulator.RunUntilHalt().instructions, 3);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], instructions[0]);
+
+        // a shorter program leaves nothing of the previous one behind
+        simulator.SetInstructions({instructions[0]});
+        simulator.Reset();
+        EXPECT_EQ(simulator.GetMemory()[1], 0);
+        EXPECT_EQ(simulator.GetMemory()[2], 0);
+    }
+}
+
+TEST(SimulatorTestSuite, SelfModifyingCode)
+{
+    // stores the instruction word at 256 over the instruction right after the store
+    const vector<uint32_t> patchNext = Parser::Parse({"lw x5, 256(x0)", "sw x5, 8(x0)", "addi x6, x0, 1"}).instructions;
+    // a hot loop that replaces its first instruction halfway through, 20 + 20 * 100 in x3
+    vector<uint32_t> patchLoop = Parser::Parse({"addi x1, x0, 0", "addi x2, x0, 40", "lw x5, 256(x0)", "loop:",
+                                                "addi x3, x3, 1", "addi x1, x1, 1", "addi x4, x0, 20",
+                                                "bne x1, x4, skip", "sw x5, 12(x0)", "skip:", "blt x1, x2, loop"})
+                                     .instructions;
+    // fence.i after the store
+    patchLoop.insert(patchLoop.begin() + 8, 0x0000100F);
+    patchLoop[6] = Parser::Parse({"bne x1, x4, 12"}).instructions[0];
+    patchLoop[9] = Parser::Parse({"blt x1, x2, -24"}).instructions[0];
+    const uint32_t add42 = Parser::Parse({"addi x6, x0, 42"}).instructions[0];
+    const uint32_t add100 = Parser::Parse({"addi x3, x3, 100"}).instructions[0];
+
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                             ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+            Simulator simulator(MEMORY_PAGE_SIZE, engine, backend);
+            simulator.SetInstructions(patchNext);
+            simulator.WriteMemory(256, span(reinterpret_cast<const uint8_t*>(&add42), 4));
+            simulator.SetResetImage();
+            while (simulator.Step().error != ExecutionError::PC_OUT_OF_BOUNDS) {
+            }
+            EXPECT_EQ(simulator.GetCpuStatus().registers[6], 42);
+            simulator.Reset();
+            EXPECT_EQ(simulator.GetMemory()[2], patchNext[2]);
+            EXPECT_EQ(simulator.RunUntilHalt().instructions, 3);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[6], 42);
+
+            simulator.Reset();
+            simulator.SetInstructions(patchLoop);
+            simulator.WriteMemory(256, span(reinterpret_cast<const uint8_t*>(&add100), 4));
+            simulator.SetResetImage();
+            // twice, the second run starts over with the original code
+            for (int run = 0; run < 2; run++) {
+                const RunResult result = simulator.RunUntilHalt();
+                EXPECT_EQ(result.reason, StopReason::HALTED);
+                EXPECT_EQ(result.instructions, 3 + 40 * 5 + 2);
+                EXPECT_EQ(simulator.GetCpuStatus().registers[3], 2020);
+                simulator.Reset();
+            }
+        }
+    }
+}
+
+TEST(SimulatorTestSuite, Compressed)
+{
+    const vector<string> program = {
+        "addi x8, x0, 10",   "addi x9, x0, 0",     "addi x2, x0, 256",   "loop:",           "add x9, x9, x8",
+        "addi x8, x8, -1",   "bne x8, x0, loop",   "sw x9, 4(x2)",       "lw x10, 4(x2)",   "slli x10, x10, 2",
+        "srai x10, x10, 1",  "andi x10, x10, 31",  "lui x11, 3",         "addi x2, x2, -16", "addi x12, x2, 8",
+        "xor x12, x12, x9",  "xor x13, x12, x10",  "or x14, x13, x8",    "and x15, x14, x10", "jal x1, func",
+        "jal x0, end",       "func:",              "addi x5, x0, 7",     "jalr x0, 0(x1)",  "end:",
+        "mul x6, x10, x10"};
+    const ParsingResult full = Parser::Parse(program);
+    const ParsingResult compressed = Parser::Parse(program, true);
+    ASSERT_LT(compressed.instructions.size(), full.instructions.size());
+    // the function returns into the middle of a word
+    EXPECT_EQ(compressed.instructionAddresses[19] % 4, 2);
+
+    Simulator reference(MEMORY_PAGE_SIZE);
+    reference.SetInstructions(full.instructions);
+    const RunResult expected = reference.RunUntilHalt();
+    const CpuStatus expectedStatus = reference.GetCpuStatus();
+    EXPECT_EQ(expectedStatus.registers[6], 196);
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                             ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+            Simulator simulator(MEMORY_PAGE_SIZE, engine, backend);
+            simulator.SetInstructions(compressed.instructions);
+            const RunResult result = simulator.RunUntilHalt();
+            EXPECT_EQ(result.instructions, expected.instructions);
+            EXPECT_EQ(result.error, ExecutionError::PC_OUT_OF_BOUNDS);
+            EXPECT_EQ(result.pc, compressed.instructions.size() * 4);
+            const CpuStatus status = simulator.GetCpuStatus();
+            // x1 holds a return address, which moved
+            for (uint8_t reg = 2; reg < 32; reg++) {
+                EXPECT_EQ(status.registers[reg], expectedStatus.registers[reg]) << static_cast<int>(reg);
+            }
+            EXPECT_EQ(status.registers[1], compressed.instructionAddresses[19]);
+            EXPECT_EQ(status.retired, expectedStatus.retired);
+        }
+    }
+
+    Lockstep lockstep(1, MEMORY_PAGE_SIZE);
+    lockstep.SetInstructions(compressed.instructions);
+    EXPECT_EQ(lockstep.Run(UINT64_MAX)[0].instructions, expected.instructions);
+    EXPECT_EQ(lockstep.GetRegister(0, 6), 196);
+}
+
+TEST(SimulatorTestSuite, BitManipulation)
+{
+    const vector<uint32_t> instructions =
+        Parser::Parse({"addi x1, x0, -100",   "lui x2, 0x12345",     "addi x2, x2, 0x678",  "sh3add x3, x1, x2",
+                       "andn x4, x2, x1",     "orn x5, x1, x2",      "xnor x6, x1, x2",     "min x7, x1, x2",
+                       "minu x8, x1, x2",     "max x9, x1, x2",      "maxu x10, x1, x2",    "rol x11, x2, x1",
+                       "ror x12, x2, x1",     "rori x13, x2, 8",     "clz x14, x2",         "ctz x15, x3",
+                       "cpop x16, x1",        "sext.b x17, x12",     "sext.h x18, x1",      "zext.h x19, x1",
+                       "lui x21, 0x100",      "orc.b x20, x21",      "orc.b x22, x11",      "rev8 x23, x2",
+                       "clz x24, x0",         "ctz x25, x0",         "sh1add x26, x14, x16", "sh2add x27, x14, x16",
+                       "sra x28, x1, x14",    "sub x29, x2, x1"})
+            .instructions;
+    const vector<uint32_t> expected = {
+        0,          0xFFFFFF9C, 0x12345678, 0x12345358, 0x60,       0xFFFFFF9F, 0x1234561B, 0xFFFFFF9C,
+        0x12345678, 0x12345678, 0xFFFFFF9C, 0x81234567, 0x23456781, 0x78123456, 3,          3,
+        28,         0xFFFFFF81, 0xFFFFFF9C, 0xFF9C,     0x00FF0000, 0x00100000, 0xFFFFFFFF, 0x78563412,
+        32,         32,         34,         40,         0xFFFFFFF3, 0x123456DC, 0,          0};
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                             ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+            Simulator simulator(MEMORY_PAGE_SIZE, engine, backend);
+            simulator.SetInstructions(instructions);
+            EXPECT_EQ(simulator.RunUntilHalt().instructions, instructions.size());
+            const CpuStatus status = simulator.GetCpuStatus();
+            for (uint8_t reg = 0; reg < 32; reg++) {
+                EXPECT_EQ(status.registers[reg], expected[reg]) << static_cast<int>(reg);
+            }
+        }
+    }
+
+    Lockstep lockstep(1, MEMORY_PAGE_SIZE);
+    lockstep.SetInstructions(instructions);
+    lockstep.Run(UINT64_MAX);
+    for (uint8_t reg = 0; reg < 32; reg++) {
+        EXPECT_EQ(lockstep.GetRegister(0, reg), expected[reg]) << static_cast<int>(reg);
+    }
+}
+
+TEST(SimulatorTestSuite, SnapshotFile)
+{
+    const string path = (std::filesystem::temp_directory_path() / "simulator_snapshot_test.bin").string();
+    const vector<uint32_t> instructions = Parser::Parse(sumProgram).instructions;
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Simulator simulator(3 * MEMORY_PAGE_SIZE, ExecutionEngine::JIT, backend);
+        simulator.SetInstructions(instructions);
+        const uint8_t data[] = {1, 2, 3};
+        EXPECT_TRUE(simulator.WriteMemory(2 * MEMORY_PAGE_SIZE + 5, data));
+        simulator.Run(33);
+        ASSERT_TRUE(simulator.SaveSnapshot(path));
+
+        simulator.RunUntilHalt();
+        simulator.Reset();
+        ASSERT_TRUE(simulator.LoadSnapshot(path));
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 33);
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+        EXPECT_EQ(simulator.GetMemory()[2 * MEMORY_PAGE_SIZE / 4 + 1], 0x03020100);
+        EXPECT_EQ(simulator.RunUntilHalt().instructions, 3);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 3025);
+
+        // writing the restored memory leaves the file alone
+        ASSERT_TRUE(simulator.LoadSnapshot(path));
+        EXPECT_EQ(simulator.GetMemory()[16], 55);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[6], 0);
+
+        SimulatorSnapshot snapshot;
+        ASSERT_TRUE(SnapshotFile::Read(path, snapshot));
+        EXPECT_EQ(snapshot.memory.size, 3 * MEMORY_PAGE_SIZE);
+        ASSERT_EQ(snapshot.memory.pages.size(), 2);
+        EXPECT_EQ(snapshot.memory.pages[1].first, 2);
+        EXPECT_EQ(snapshot.memory.pages[1].second[6], 2);
+
+        // as does a file of another size
+        Simulator larger(8 * MEMORY_PAGE_SIZE, ExecutionEngine::JIT, backend);
+        larger.SetInstructions(instructions);
+        ASSERT_TRUE(larger.LoadSnapshot(path));
+        EXPECT_EQ(larger.GetMemorySize(), 3 * MEMORY_PAGE_SIZE);
+        larger.Reset();
+        EXPECT_EQ(larger.RunUntilHalt().reason, StopReason::HALTED);
+        EXPECT_EQ(larger.GetCpuStatus().registers[6], 3025);
+    }
+
+    // anything else is rejected without touching the simulator
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a snapshot";
+    }
+    Simulator simulator(256);
+    simulator.SetInstructions(instructions);
+    simulator.Step();
+    EXPECT_FALSE(simulator.LoadSnapshot(path));
+    EXPECT_FALSE(simulator.LoadSnapshot(path + ".missing"));
+    EXPECT_EQ(simulator.GetCpuStatus().registers[1], 10);
+    std::filesystem::remove(path);
+}
+
+TEST(SimulatorTestSuite, LoadElf)
+{
+    const string path = (std::filesystem::temp_directory_path() / "simulator_elf_test").string();
+    // increments the data word into the next one, reads the zeroed part, pushes it and stops at the end of the code
+    const vector<uint32_t> code = Parser::Parse({"auipc x5, 0x10", "lw x6, 0(x5)", "addi x6, x6, 1", "sw x6, 4(x5)",
+                                                 "lui x9, 0x21", "lw x7, 0(x9)", "addi x8, x2, 0", "addi x2, x2, -4",
+                                                 "sw x6, 0(x2)"})
+                                      .instructions;
+    WriteElf(path, code, 41);
+
+    ElfProgram program;
+    ASSERT_EQ(ElfFile::Read(path, program), ElfError::NONE);
+    EXPECT_EQ(program.entry, 0x10000);
+    ASSERT_EQ(program.segments.size(), 2);
+    EXPECT_TRUE(program.segments[0].executable);
+    EXPECT_FALSE(program.segments[1].executable);
+    EXPECT_EQ(program.memoryEnd, 0x20000 + 2 * MEMORY_PAGE_SIZE);
+
+    for (const MemoryBackend backend : {MemoryBackend::PAGED, MemoryBackend::RESERVED}) {
+        Simulator simulator(256, ExecutionEngine::JIT, backend);
+        ASSERT_EQ(simulator.LoadElf(path), ElfError::NONE);
+        EXPECT_EQ(simulator.GetMemorySize(), program.memoryEnd + ELF_DEFAULT_STACK_SIZE);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 0x10000);
+        ASSERT_EQ(simulator.GetSymbols().size(), 2);
+        EXPECT_EQ(simulator.GetSymbols()[0].name, "main");
+        EXPECT_TRUE(simulator.GetSymbols()[0].function);
+        EXPECT_EQ(simulator.GetSymbols()[1].name, "value");
+        EXPECT_EQ(simulator.GetSymbols()[1].address, 0x20000);
+
+        for (int run = 0; run < 2; run++) {
+            const RunResult result = simulator.RunUntilHalt();
+            EXPECT_EQ(result.reason, StopReason::HALTED);
+            EXPECT_EQ(result.instructions, code.size());
+            EXPECT_EQ(simulator.GetCpuStatus().registers[6], 42);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[7], 0);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[8], program.memoryEnd + ELF_DEFAULT_STACK_SIZE);
+            EXPECT_EQ(simulator.GetMemory()[0x20004 / 4], 42);
+            // the push went above the segments, the end of the zeroed part is untouched
+            EXPECT_EQ(simulator.GetMemory()[(program.memoryEnd - 4) / 4], 0);
+            EXPECT_EQ(simulator.GetMemory()[(program.memoryEnd + ELF_DEFAULT_STACK_SIZE - 4) / 4], 42);
+            // the executable is loaded again by a reset
+            simulator.Reset();
+            EXPECT_EQ(simulator.GetMemory()[0x20004 / 4], 0xABABABAB);
+        }
+
+        simulator.SetInstructions(code);
+        EXPECT_TRUE(simulator.GetSymbols().empty());
+    }
+
+    Simulator small(256);
+    ASSERT_EQ(small.LoadElf(path, MEMORY_PAGE_SIZE), ElfError::NONE);
+    EXPECT_EQ(small.GetMemorySize(), program.memoryEnd + MEMORY_PAGE_SIZE);
+    EXPECT_EQ(small.GetCpuStatus().registers[2], program.memoryEnd + MEMORY_PAGE_SIZE);
+
+    // anything else is rejected without touching the simulator
+    Simulator simulator(256);
+    simulator.SetInstructions(code);
+    simulator.Step();
+    // magic, class and machine
+    for (const std::streamoff offset : {0, 4, 18}) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offset);
+        file.put(0x7E);
+        file.close();
+        EXPECT_EQ(simulator.LoadElf(path), ElfError::NOT_RV32_EXECUTABLE);
+        WriteElf(path, code, 41);
+    }
+    // code spread over more than the engines translate
+    {
+        const uint32_t address = 0x20000 + ELF_MAX_CODE_SIZE;
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(sizeof(ElfHeader) + sizeof(ElfProgramHeader) + offsetof(ElfProgramHeader, address));
+        file.write(reinterpret_cast<const char*>(&address), sizeof(address));
+        const uint32_t flags = 5;
+        file.seekp(sizeof(ElfHeader) + sizeof(ElfProgramHeader) + offsetof(ElfProgramHeader, flags));
+        file.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    }
+    EXPECT_EQ(simulator.LoadElf(path), ElfError::CODE_TOO_LARGE);
+    EXPECT_EQ(simulator.LoadElf(path + ".missing"), ElfError::UNREADABLE);
+    EXPECT_EQ(simulator.GetCpuStatus().registers[5], 0x10000);
+    EXPECT_EQ(simulator.GetMemorySize(), 256);
+    std::filesystem::remove(path);
+}
+
+TEST(SimulatorTestSuite, LoadElfHighAddress)
+{
+    const string path = (std::filesystem::temp_directory_path() / "simulator_elf_high_test").string();
+    // linked at the usual bare-metal address, loops often enough to be compiled and jumps through a register
+    const vector<uint32_t> code = Parser::Parse({"lui x9, 0x20", "lw x6, 0(x9)", "addi x8, x0, 100", "loop:",
+                                                 "addi x6, x6, 1", "addi x8, x8, -1", "bne x8, x0, loop",
+                                                 "addi x6, x6, -99", "auipc x7, 0", "jalr x1, 12(x7)",
+                                                 "addi x6, x0, 0", "sw x6, 4(x9)"})
+                                      .instructions;
+    constexpr uint32_t address = 0x80000000;
+    WriteElf(path, code, 41, address);
+
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        ASSERT_EQ(simulator.LoadElf(path), ElfError::NONE);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, address);
+        for (int run = 0; run < 2; run++) {
+            const RunResult result = simulator.RunUntilHalt();
+            EXPECT_EQ(result.reason, StopReason::HALTED);
+            EXPECT_EQ(result.instructions, 307);
+            EXPECT_EQ(simulator.GetCpuStatus().pc, address + code.size() * 4);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[1], address + 36);
+            EXPECT_EQ(simulator.GetCpuStatus().registers[7], address + 28);
+            EXPECT_EQ(simulator.ViewMemoryPage(0x20000).bytes[4], 42);
+            simulator.Reset();
+        }
+
+        // a jump in front of the code leaves the program like one behind it
+        EXPECT_EQ(simulator.Step().error, ExecutionError::NONE);
+        const vector<uint32_t> jump = Parser::Parse({"jalr x0, 0(x9)"}).instructions;
+        simulator.WriteMemory(address + 4, span(reinterpret_cast<const uint8_t*>(jump.data()), 4));
+        const RunResult result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.reason, StopReason::HALTED);
+        EXPECT_EQ(result.instructions, 1);
+        EXPECT_EQ(simulator.GetCpuStatus().pc, 0x20000);
+    }
+    std::filesystem::remove(path);
+}
+
+#ifdef FORK_SERVER_SUPPORTED
+TEST(SimulatorTestSuite, ForkServer)
+{
+    Simulator simulator(256, ExecutionEngine::JIT);
+    simulator.SetInstructions(Parser::Parse({"addi x1, x0, 64", "addi x3, x0, 1", "lw x10, 0(x1)", "add x10, x10, x3",
+                                             "sw x10, 0(x1)"})
+                                  .instructions);
+    ForkServer server(&simulator);
+    EXPECT_FALSE(ForkServer(&simulator).Initialize(8, 1));
+    simulator.Reset();
+    ASSERT_TRUE(server.Initialize(8, 100));
+
+    for (uint8_t value = 0; value < 3; value++) {
+        const uint8_t input[] = {value, 1};
+        ForkRunResult result;
+        ASSERT_TRUE(server.Run(64, input, 100, result));
+        EXPECT_EQ(result.run.reason, StopReason::HALTED);
+        EXPECT_EQ(result.run.instructions, 3);
+        EXPECT_EQ(result.hart.registers[10], value + 257);
+        EXPECT_EQ(result.hart.retired, 5);
+    }
+    ForkRunResult result;
+    ASSERT_TRUE(server.Run(64, {}, 1, result));
+    EXPECT_EQ(result.run.reason, StopReason::LIMIT_REACHED);
+    EXPECT_EQ(result.hart.registers[PC], 12);
+    const uint8_t input[] = {1, 2};
+    EXPECT_FALSE(server.Run(255, input, 100, result));
+
+    // the runs leave the initialized state alone
+    EXPECT_EQ(simulator.GetCpuStatus().pc, 8);
+    EXPECT_EQ(simulator.GetMemory()[16], 0);
+}
+#endif
+
+TEST(SimulatorTestSuite, Lockstep)
+{
+    // Collatz steps of the input, so the lanes branch differently, then a division that fails for some of them
+    // and products and quotients of negative operands, the byte input is negative for some lanes
+    const vector<uint32_t> instructions =
+        Parser::Parse({"lw x10, 128(x0)",    "lb x11, 128(x0)",    "addi x5, x0, 0",     "loop:",
+                       "addi x6, x0, 1",     "beq x10, x6, done",  "andi x7, x10, 1",    "beq x7, x0, even",
+                       "slli x8, x10, 1",    "add x10, x10, x8",   "addi x10, x10, 1",   "jal x1, next",
+                       "even:",              "srli x10, x10, 1",   "next:",              "addi x5, x5, 1",
+                       "jal x0, loop",       "done:",              "sh x5, 134(x0)",     "lhu x12, 134(x0)",
+                       "addi x13, x0, 3",    "remu x14, x12, x13", "div x15, x11, x14",  "mulh x16, x11, x11",
+                       "mulh x17, x11, x12", "mulhsu x18, x11, x12", "lui x19, 0x80000", "addi x20, x0, -1",
+                       "div x21, x19, x20",  "rem x22, x19, x20"})
+            .instructions;
+    constexpr size_t lanes = 37;
+    for (const uint64_t maxInstructions : {UINT64_MAX, uint64_t{50}}) {
+        Lockstep lockstep(lanes, 256);
+        lockstep.SetInstructions(instructions);
+        vector<Simulator*> references;
+        for (size_t lane = 0; lane < lanes; lane++) {
+            references.push_back(new Simulator(256));
+            references[lane]->SetInstructions(instructions);
+            const uint32_t input = lane * 7 + 120;
+            const span data(reinterpret_cast<const uint8_t*>(&input), sizeof(input));
+            references[lane]->WriteMemory(128, data);
+            lockstep.GetMemory(lane).WriteRange(128, data);
+        }
+
+        const vector<RunResult> results = lockstep.Run(maxInstructions);
+        int failed = 0;
+        for (size_t lane = 0; lane < lanes; lane++) {
+            const RunResult expected = references[lane]->Run(maxInstructions);
+            EXPECT_EQ(results[lane].instructions, expected.instructions);
+            EXPECT_EQ(results[lane].error, expected.error);
+            EXPECT_EQ(results[lane].pc, expected.pc);
+            EXPECT_EQ(results[lane].errorPc, expected.errorPc);
+            EXPECT_EQ(results[lane].reason, expected.reason);
+            const CpuStatus status = references[lane]->GetCpuStatus();
+            for (uint8_t reg = 0; reg < 32; reg++) {
+                EXPECT_EQ(lockstep.GetRegister(lane, reg), status.registers[reg]);
+            }
+            EXPECT_EQ(lockstep.GetRegister(lane, PC), status.pc);
+            EXPECT_EQ(lockstep.GetRetired(lane), status.retired);
+            EXPECT_EQ(lockstep.GetMemory(lane).GetMemory(), references[lane]->GetMemory());
+            if (results[lane].reason == StopReason::HALTED) {
+                const uint32_t product = static_cast<int8_t>(lane * 7 + 120) < 0 ? 0xFFFFFFFF : 0;
+                EXPECT_EQ(lockstep.GetRegister(lane, 17), product);
+                EXPECT_EQ(lockstep.GetRegister(lane, 18), product);
+                EXPECT_EQ(lockstep.GetRegister(lane, 21), 0x80000000);
+                EXPECT_EQ(lockstep.GetRegister(lane, 22), 0);
+            }
+            failed += results[lane].reason == StopReason::INSTRUCTION_FAILED;
+            delete references[lane];
+        }
+        EXPECT_EQ(failed > 0, maxInstructions == UINT64_MAX);
+    }
+}
+
+TEST(SimulatorTestSuite, RunError)
+{
+    const vector<uint32_t> instructions =
+        Parser::Parse({"addi x1, x0, 1", "addi x2, x0, 2", "div x3, x1, x0", "addi x4, x0, 1"}).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(instructions);
+
+        const RunResult result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.instructions, 2);
+        EXPECT_EQ(result.reason, StopReason::INSTRUCTION_FAILED);
+        EXPECT_EQ(result.error, ExecutionError::DIVISION_BY_ZERO);
+        EXPECT_EQ(result.errorPc, 8);
+        EXPECT_EQ(result.pc, 0);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], 0);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 0);
+    }
+
+    // reported by address, the division after three compressed instructions starts at byte 6
+    const vector<uint32_t> compressed =
+        Parser::Parse({"c.li x1, 1", "c.li x2, 2", "c.li x3, 3", "div x4, x1, x0"}).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(compressed);
+        const RunResult result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.instructions, 3);
+        EXPECT_EQ(result.error, ExecutionError::DIVISION_BY_ZERO);
+        EXPECT_EQ(result.errorPc, 6);
+
+        for (int i = 0; i < 3; i++) {
+            EXPECT_TRUE(simulator.Step().success);
+        }
+        const ExecutionResult step = simulator.Step();
+        EXPECT_EQ(step.error, ExecutionError::DIVISION_BY_ZERO);
+        EXPECT_EQ(step.errorPc, 6);
+    }
+}
+
+TEST(SimulatorTestSuite, Limits)
+{
+    const vector<uint32_t> loop = Parser::Parse({"addi x1, x1, 1", "jal x0, -4"}).instructions;
+    for (const ExecutionEngine engine : {ExecutionEngine::INTERPRETER, ExecutionEngine::THREADED,
+                                         ExecutionEngine::BLOCK_CACHE, ExecutionEngine::JIT}) {
+        Simulator simulator(256, engine);
+        simulator.SetInstructions(loop);
+        simulator.SetLimits({1000, 0, 0});
+        RunResult result = simulator.RunUntilHalt();
+        EXPECT_EQ(result.reason, StopReason::LIMIT_REACHED);
+        EXPECT_EQ(result.error, ExecutionError::LIMIT_EXCEEDED);
+        EXPECT_EQ(result.instructions, 1000);
+        EXPECT_EQ(simulator.GetCpuStatus().registers[1], 500);
+
+        // stays exceeded without executing anything until a reset
+        const ExecutionResult step = simulator.Step();
+        EXPECT_FALSE(step.success);
+        EXPECT_EQ(step.error, ExecutionError::LIMIT_EXCEEDED);
+        EXPECT_EQ(step.errorPc, 0);
+        EXPECT_EQ(simulator.GetCpuStatus().retired, 1000);
+        simulator.Reset();
+        result = simulator.Run(600);
+        EXPECT_EQ(result.error, ExecutionError::NONE);
+        EXPECT_EQ(result.instructions, 600);
+        for (int i = 0; i < 400; i++) {
+            EXPECT_TRUE(simulator.Step().success);
+        }
+        EXPECT_EQ(simulator.Step().error, ExecutionError::LIMIT_EXCEEDED);
+    }
+
+    Simulator timed(256, ExecutionEngine::JIT);
+    timed.SetInstructions(loop);
+    timed.SetLimits({0, 20'000'000, 0});
+    const RunResult result = timed.RunUntilHalt();
+    EXPECT_EQ(result.error, ExecutionError::LIMIT_EXCEEDED);
+    EXPECT_GT(result.instructions, 0);
+
+    // stores one word per page, the limit is checked between slices so it can go over by one
+    Simulator growing(1 << 30);
+    growing.SetInstructions(
+        Parser::Parse({"lui x1, 1", "loop:", "sw x1, 0(x2)", "add x2, x2, x1", "jal x0, loop"}).instructions);
+    growing.SetLimits({0, 0, 1 << 20});
+    EXPECT_EQ(growing.RunUntilHalt().error, ExecutionError::LIMIT_EXCEEDED);
+    EXPECT_GT(growing.GetCpuStatus().registers[2], 1u << 20);
+    EXPECT_LE(growing.GetCpuStatus().registers[2], (1u << 20) + LIMIT_CHECK_INTERVAL * MEMORY_PAGE_SIZE);
+
+    // no limits
+    EXPECT_EQ(growing.GetLimits().maxInstructions, 0);
+    growing.SetLimits({});
+    EXPECT_EQ(growing.Run(1000).error, ExecutionError::NONE);
+}
+
+TEST(SimulatorTestSuite, StatusView)
+{
+    Simulator simulator(256);
+    simulator.SetInstructions(Parser::Parse({"addi x1, x0, 5", "addi x2, x1, 1"}).instructions);
+    const CpuStatus status = simulator.GetCpuStatus();
+
+    simulator.Step();
+    simulator.Step();
+    // the registers are a view, so they follow the CPU
+    EXPECT_EQ(status.registers[1], 5);
+    EXPECT_EQ(status.registers[2], 6);
+    EXPECT_EQ(simulator.GetCpuStatus().pc, 8);
+    EXPECT_EQ(simulator.GetCpuStatus().retired, 2);
+
+    simulator.Reset();
+    EXPECT_EQ(status.registers[1], 0);
+    EXPECT_EQ(simulator.GetCpuStatus().retired, 0);
+}
@@ -16,13 +16,13 @@ string ErrorParser::ParseError(const ExecutionError error, const uint32_t instru
     case ExecutionError::INVALID_REGISTER:
         return line + "Invalid register. The register number must be between 0 and 31.";
     case ExecutionError::INVALID_MEMORY_ACCESS:
-        return line + "Invalid memory access. The memory address must be a multiple of 4 and within the memory bounds.";
+        return line + "Invalid memory access. The accessed bytes must be within the memory bounds.";
     case ExecutionError::DIVISION_BY_ZERO:
         return line + "Division by zero.";
     case ExecutionError::PC_OUT_OF_BOUNDS:
         return line + "Program counter out of bounds.";
-    case ExecutionError::OFFSET_NOT_32_BIT_ALIGNED:
-        return line + "Offset not 32-bit aligned. The offset must be a multiple of 4.";
+    case ExecutionError::LIMIT_EXCEEDED:
+        return line + "Execution limit exceeded. The program may be stuck in an infinite loop.";
     default:
         return line + "Unknown error.";
     }
@@ -61,6 +61,10 @@ string ErrorParser::ParseError(const ParsingError error, const uint32_t lineNumb
         return line + "Empty input.";
     case ParsingError::DUPLICATE_LABEL_DEFINITION:
         return line + "Duplicate label definition. A label with the same name has already been defined.";
+    case ParsingError::NOT_COMPRESSIBLE:
+        return line +
+            "Instruction not compressible. The registers or the immediate do not fit the 16-bit encoding, e.g., "
+            "c.lw and c.sw only take x8 to x15.";
     default:
         return "Unknown error";
     }
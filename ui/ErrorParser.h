@@ -62,6 +62,53 @@ static const map<string, string> InstructionFormats = {
     {OpCodes::DIV, "div rd, rs1, rs2 # rd = rs1 / rs2"},
     {OpCodes::DIVU, "divu rd, rs1, rs2 # rd = (usigned)rs1 / (usigned)rs2"},
     {OpCodes::REM, "rem rd, rs1, rs2 # rd = rs1 % rs2"},
-    {OpCodes::REMU, "remu rd, rs1, rs2 # rd = (usigned)rs1 % (usigned)rs2"}};
+    {OpCodes::REMU, "remu rd, rs1, rs2 # rd = (usigned)rs1 % (usigned)rs2"},
+    {OpCodes::SH1ADD, "sh1add rd, rs1, rs2 # rd = (rs1 << 1) + rs2"},
+    {OpCodes::SH2ADD, "sh2add rd, rs1, rs2 # rd = (rs1 << 2) + rs2"},
+    {OpCodes::SH3ADD, "sh3add rd, rs1, rs2 # rd = (rs1 << 3) + rs2"},
+    {OpCodes::ANDN, "andn rd, rs1, rs2 # rd = rs1 & ~rs2"},
+    {OpCodes::ORN, "orn rd, rs1, rs2 # rd = rs1 | ~rs2"},
+    {OpCodes::XNOR, "xnor rd, rs1, rs2 # rd = ~(rs1 ^ rs2)"},
+    {OpCodes::MIN, "min rd, rs1, rs2 # rd = (rs1 < rs2) ? rs1 : rs2"},
+    {OpCodes::MINU, "minu rd, rs1, rs2 # rd = ((usigned)rs1 < (usigned)rs2) ? rs1 : rs2"},
+    {OpCodes::MAX, "max rd, rs1, rs2 # rd = (rs1 < rs2) ? rs2 : rs1"},
+    {OpCodes::MAXU, "maxu rd, rs1, rs2 # rd = ((usigned)rs1 < (usigned)rs2) ? rs2 : rs1"},
+    {OpCodes::ROL, "rol rd, rs1, rs2 # rd = rs1 rotated left by rs2"},
+    {OpCodes::ROR, "ror rd, rs1, rs2 # rd = rs1 rotated right by rs2"},
+    {OpCodes::RORI, "rori rd, rs1, shamt # rd = rs1 rotated right by shamt"},
+    {OpCodes::CLZ, "clz rd, rs1 # rd = number of leading zero bits of rs1"},
+    {OpCodes::CTZ, "ctz rd, rs1 # rd = number of trailing zero bits of rs1"},
+    {OpCodes::CPOP, "cpop rd, rs1 # rd = number of set bits of rs1"},
+    {OpCodes::SEXT_B, "sext.b rd, rs1 # rd = rs1[0:7] sign-extended"},
+    {OpCodes::SEXT_H, "sext.h rd, rs1 # rd = rs1[0:15] sign-extended"},
+    {OpCodes::ZEXT_H, "zext.h rd, rs1 # rd = rs1[0:15]"},
+    {OpCodes::ORC_B, "orc.b rd, rs1 # each byte of rd = (byte of rs1 != 0) ? 0xFF : 0"},
+    {OpCodes::REV8, "rev8 rd, rs1 # rd = rs1 with its bytes reversed"},
+    {OpCodes::C_ADDI, "c.addi rd, imm # rd = rd + imm, imm in [-32, 31]"},
+    {OpCodes::C_LI, "c.li rd, imm # rd = imm, imm in [-32, 31]"},
+    {OpCodes::C_ADDI16SP, "c.addi16sp x2, imm # x2 = x2 + imm, imm a multiple of 16"},
+    {OpCodes::C_ADDI4SPN, "c.addi4spn rd', x2, imm # rd' = x2 + imm, imm a positive multiple of 4"},
+    {OpCodes::C_LUI, "c.lui rd, imm # rd = imm << 12, imm in [-32, 31]"},
+    {OpCodes::C_SLLI, "c.slli rd, shamt # rd = rd << shamt"},
+    {OpCodes::C_SRLI, "c.srli rd', shamt # rd' = (usigned)rd' >> shamt"},
+    {OpCodes::C_SRAI, "c.srai rd', shamt # rd' = rd' >> shamt"},
+    {OpCodes::C_ANDI, "c.andi rd', imm # rd' = rd' & imm"},
+    {OpCodes::C_MV, "c.mv rd, rs2 # rd = rs2"},
+    {OpCodes::C_ADD, "c.add rd, rs2 # rd = rd + rs2"},
+    {OpCodes::C_SUB, "c.sub rd', rs2' # rd' = rd' - rs2'"},
+    {OpCodes::C_XOR, "c.xor rd', rs2' # rd' = rd' ^ rs2'"},
+    {OpCodes::C_OR, "c.or rd', rs2' # rd' = rd' | rs2'"},
+    {OpCodes::C_AND, "c.and rd', rs2' # rd' = rd' & rs2'"},
+    {OpCodes::C_LW, "c.lw rd', offset(rs1') # rd' = M[rs1' + offset][0:31]"},
+    {OpCodes::C_SW, "c.sw rs2', offset(rs1') # M[rs1' + offset][0:31] = rs2'"},
+    {OpCodes::C_LWSP, "c.lwsp rd, offset(x2) # rd = M[x2 + offset][0:31]"},
+    {OpCodes::C_SWSP, "c.swsp rs2, offset(x2) # M[x2 + offset][0:31] = rs2"},
+    {OpCodes::C_J, "c.j offset # pc += offset"},
+    {OpCodes::C_JAL, "c.jal offset # x1 = pc + 2; pc += offset"},
+    {OpCodes::C_JR, "c.jr rs1 # pc = rs1"},
+    {OpCodes::C_JALR, "c.jalr rs1 # x1 = pc + 2; pc = rs1"},
+    {OpCodes::C_BEQZ, "c.beqz rs1', offset # if (rs1' == 0) pc += offset"},
+    {OpCodes::C_BNEZ, "c.bnez rs1', offset # if (rs1' != 0) pc += offset"},
+    {OpCodes::C_NOP, "c.nop # does nothing"}};
 
 #endif // ERRORPARSER_H
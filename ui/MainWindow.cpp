@@ -16,6 +16,8 @@
 #include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "../parser/Parser.h"
@@ -26,6 +28,8 @@
 #include "completers/QRiscvAsmCompleter.h"
 #include "highlighters/QRiscvAsmHighlighter.h"
 
+// a program that loops forever stops with an error instead of stepping until it is stopped by hand
+static constexpr uint64_t UI_INSTRUCTION_LIMIT = 1'000'000;
 
 MainWindow::MainWindow(QWidget* parent) :
     QMainWindow(parent), m_setupLayout(nullptr), m_themeCombobox(nullptr), m_codeEditor(nullptr), m_completer(nullptr),
@@ -55,6 +59,7 @@ void MainWindow::initData()
     m_memoryLayout = new QVBoxLayout;
     m_spacer = new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding);
     m_simulator = new Simulator;
+    m_simulator->SetLimits({UI_INSTRUCTION_LIMIT, 0, 0});
     m_registerData = vector<int32_t>(32);
     m_configData = new ConfigData(Config::deserialize());
 
@@ -320,7 +325,7 @@ QWidget* MainWindow::createMemoryPanel()
     const auto memContentWidget = new QWidget;
     memContentWidget->setProperty("cssClass", "themedBackground");
 
-    m_memoryData = m_simulator->GetMemory();
+    loadMemoryData();
 
     // Set up scrollable content for memory
     memContentWidget->setLayout(m_memoryLayout);
@@ -613,8 +618,8 @@ void MainWindow::step()
         }
         return;
     }
-    m_highlighter->highlightError(calculateErrorLine(result.errorInstruction));
-    errorPopup(ErrorParser::ParseError(result.error, calculateErrorLine(result.errorInstruction)));
+    m_highlighter->highlightError(calculateErrorLine(result.errorPc));
+    errorPopup(ErrorParser::ParseError(result.error, calculateErrorLine(result.errorPc)));
 }
 
 void MainWindow::stop()
@@ -634,7 +639,7 @@ void MainWindow::reset()
     m_simulator->Reset();
     m_pcData = 0;
     m_registerData = std::vector<int32_t>(32);
-    m_memoryData = m_simulator->GetMemory();
+    loadMemoryData();
     updateMemoryWithFormat(m_memoryFormatComboBox->currentText());
     updateRegisterWithFormat(m_registerFormatComboBox->currentText());
     m_highlighter->highlightLine(-1);
@@ -643,7 +648,7 @@ void MainWindow::reset()
 
 void MainWindow::executionError(const ExecutionResult& error)
 {
-    errorPopup(ErrorParser::ParseError(error.error, calculateErrorLine(error.errorInstruction)));
+    errorPopup(ErrorParser::ParseError(error.error, calculateErrorLine(error.errorPc)));
     m_simulationThread = nullptr;
     m_stepButton->setEnabled(true);
     m_runButton->setEnabled(true);
@@ -657,16 +662,19 @@ void MainWindow::setResult(const ExecutionResult& result)
         highlightRegisterLineEdit(m_registerMap[result.registerChange.reg]);
     }
     else if (result.memoryChanged) {
-        m_memoryData[result.memoryChange.address] = result.memoryChange.value;
-        updateMemoryWithFormat(m_memoryFormatComboBox->currentText());
-        highlightMemoryLabel(m_memoryMap[result.memoryChange.address]);
+        // one row per word, the change reports the word holding the first stored byte
+        const uint32_t row = result.memoryChange.address / 4;
+        m_memoryData[row] = result.memoryChange.value;
+        updateMemoryRow(static_cast<int>(row), m_memoryFormatComboBox->currentText() == "Hexadecimal");
+        highlightMemoryLabel(m_memoryMap[row]);
     }
     m_pcData = result.pc;
     updateRegisterWithFormat(m_registerFormatComboBox->currentText());
     highlightRegisterLineEdit(m_pcValue);
 
-    if (m_instructionMap->size() > result.pc / 4) {
-        m_highlighter->highlightLine(m_instructionMap->at(result.pc / 4));
+    const int instruction = findInstruction(result.pc);
+    if (instruction >= 0 && m_instructionAddresses[instruction] == result.pc) {
+        m_highlighter->highlightLine(m_instructionMap->at(instruction));
     }
     else {
         m_highlighter->highlightLine(-1);
@@ -706,25 +714,40 @@ void MainWindow::updateMemoryWithFormat(const QString& format)
     const bool toHex = (format == "Hexadecimal");
 
     for (int i = 0; i < m_memoryData.size(); i++) {
-        // Get the memory address as a hexadecimal string
-        QString addressText = QString("%1:").arg(i * 4, 8, 16, QChar('0')); // i * 4 for byte addressing
-
-        const uint32_t value = m_memoryData[i];
-        QString memoryRowText = addressText + "  ";
-
-        // Group the bytes (4 bytes = 32 bits)
-        for (int j = 0; j < 4; j++) {
-            const uint8_t byteValue = (value >> (8 * j)) & 0xFF;
-            memoryRowText += (toHex ? QString("%1 ").arg(byteValue, 2, 16, QChar('0'))
-                                    : QString("%1 ").arg(byteValue, 3, 10, QChar('0')));
-        }
-        m_memoryMap[i]->setText(memoryRowText);
+        updateMemoryRow(i, toHex);
     }
 
     m_configData->memFormat = format;
     saveConfig();
 }
 
+void MainWindow::updateMemoryRow(const int row, const bool toHex) const
+{
+    // Get the memory address as a hexadecimal string
+    QString addressText = QString("%1:").arg(row * 4, 8, 16, QChar('0')); // row * 4 for byte addressing
+
+    const uint32_t value = m_memoryData[row];
+    QString memoryRowText = addressText + "  ";
+
+    // Group the bytes (4 bytes = 32 bits)
+    for (int j = 0; j < 4; j++) {
+        const uint8_t byteValue = (value >> (8 * j)) & 0xFF;
+        memoryRowText += (toHex ? QString("%1 ").arg(byteValue, 2, 16, QChar('0'))
+                                : QString("%1 ").arg(byteValue, 3, 10, QChar('0')));
+    }
+    m_memoryMap[row]->setText(memoryRowText);
+}
+
+void MainWindow::loadMemoryData()
+{
+    // The panel keeps its own words since the simulation thread writes memory while it runs.
+    // Only pages that hold data are copied, the rest stays zero
+    m_memoryData.assign((m_simulator->GetMemorySize() + 3) / 4, 0);
+    for (const MemoryPageView page : m_simulator->GetMemoryPages()) {
+        std::memcpy(m_memoryData.data() + page.address / 4, page.bytes.data(), page.bytes.size());
+    }
+}
+
 void MainWindow::ensureMemoryMapCapacity()
 {
     const int sizeDiff = m_memoryMap.size() - m_memoryData.size();
@@ -818,6 +841,7 @@ bool MainWindow::parseAndSetInstructions()
         m_instructionMap = nullptr;
     }
     m_instructionMap = new vector(result.instructionMap);
+    m_instructionAddresses = result.instructionAddresses;
 
     if (result.success) {
         return true;
@@ -842,12 +866,20 @@ void MainWindow::highlightRegisterLineEdit(QLineEdit* lineEdit) const
     QTimer::singleShot(300, [lineEdit]() { lineEdit->setStyleSheet(""); });
 }
 
-uint32_t MainWindow::calculateErrorLine(const int instruction) const
+uint32_t MainWindow::calculateErrorLine(const uint32_t errorPc) const
 {
-    if (m_instructionMap->size() < instruction) {
+    const int index = findInstruction(errorPc);
+    if (index < 0) {
         return 0;
     }
-    return m_instructionMap->at(instruction - 1) + 1;
+    return m_instructionMap->at(index) + 1;
+}
+
+// index of the instruction the byte at the address belongs to, -1 if there is none
+int MainWindow::findInstruction(const uint32_t address) const
+{
+    const auto next = std::ranges::upper_bound(m_instructionAddresses, address);
+    return static_cast<int>(next - m_instructionAddresses.begin()) - 1;
 }
 
 void MainWindow::saveConfig() const { Config::serialize(*m_configData); }
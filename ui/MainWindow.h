@@ -50,6 +50,8 @@ private:
     void createToolbar();
     void updateRegisterWithFormat(const QString& format) const;
     void updateMemoryWithFormat(const QString& format);
+    void updateMemoryRow(int row, bool toHex) const;
+    void loadMemoryData();
     void setupWidgets();
     void performConnections();
     void setRegisterPanelShown(bool shown) const;
@@ -67,7 +69,8 @@ private:
     void executionFinished();
     void highlightMemoryLabel(QLabel* label) const;
     void highlightRegisterLineEdit(QLineEdit* lineEdit) const;
-    uint32_t calculateErrorLine(int instruction) const;
+    uint32_t calculateErrorLine(uint32_t errorPc) const;
+    int findInstruction(uint32_t address) const;
     void saveConfig() const;
     void closeEvent(QCloseEvent* event) override;
 
@@ -105,6 +108,7 @@ private:
     QWidget* m_memoryPanel;
 
     vector<uint32_t>* m_instructionMap;
+    vector<uint32_t> m_instructionAddresses;
     bool m_hasStarted;
     Simulator* m_simulator;
     int m_speed;